@@ -16,7 +16,6 @@ using namespace Noxa::Emulation::Psp::CodeGen;
 
 #define DEFAULTMAXIMUMSIZE			512 * 5
 #define DEFAULTSTORAGEBLOCKSIZE		1024 * 1024 * 8
-#define STORAGETABLESIZE			64
 
 CodeGenerator::CodeGenerator( int maximumCodeSize, int storageBlockSize )
 {
@@ -31,6 +30,9 @@ CodeGenerator::CodeGenerator( int maximumCodeSize, int storageBlockSize )
 	_storage = new byte*[ STORAGETABLESIZE ];
 	memset( _storage, 0, sizeof( byte* ) * STORAGETABLESIZE );
 	_storageIndex = 0;
+	_storageCount = 0;
+	_storageBudget = 0;
+	memset( _storagePinned, 0, sizeof( _storagePinned ) );
 	_currentStoragePointer = NULL;
 
 	// Initialize the first block
@@ -41,31 +43,43 @@ CodeGenerator::CodeGenerator( int maximumCodeSize, int storageBlockSize )
 	delete is;
 
 	_offset = 0;
-	_buffer = ( byte* )calloc( 1, _maximumCodeSize );
+	_privateBuffer = ( byte* )calloc( 1, _maximumCodeSize );
+	_buffer = _privateBuffer;
+	_direct = false;
+	_overflowed = false;
 
 	_labelIndex = 0;
 	_labelTable = ( Label* )calloc( sizeof( Label ), _maximumCodeSize / 10 );
 	_referenceIndex = 0;
 	_referenceTable = ( Reference* )calloc( sizeof( Reference ), _maximumCodeSize / 10 );
 
+	// Fields are 4 bytes and never overlap, so this can't fill up
+	_recordRelocations = false;
+	_pointerNext = false;
+	_relocationIndex = 0;
+	_relocationTable = ( Relocation* )calloc( sizeof( Relocation ), _maximumCodeSize / 4 );
+
 	_synth = new Synthesizer();
 }
 
 CodeGenerator::~CodeGenerator()
 {
-	for( int n = 0; n <= _storageIndex; n++ )
+	for( int n = 0; n < STORAGETABLESIZE; n++ )
 	{
-		VirtualFree( _storage[ _storageIndex ], 0, MEM_RELEASE );
-		_storage[ _storageIndex ] = 0;
+		if( _storage[ n ] != NULL )
+			VirtualFree( _storage[ n ], 0, MEM_RELEASE );
+		_storage[ n ] = 0;
 	}
 	if( _storage != NULL )
 		delete[] _storage;
 	_storage = NULL;
 
 	SAFEDELETE( _synth );
-	SAFEFREE( _buffer );
+	SAFEFREE( _privateBuffer );
+	_buffer = NULL;
 	SAFEFREE( _labelTable );
 	SAFEFREE( _referenceTable );
+	SAFEFREE( _relocationTable );
 }
 
 byte* CodeGenerator::CommitStorageSpace( int size )
@@ -79,6 +93,7 @@ byte* CodeGenerator::CommitStorageSpace( int size )
 		DWORD allocType = MEM_COMMIT;
 #endif
 		_storage[ 0 ] = ( byte* )VirtualAlloc( NULL, _storageBlockSize, allocType, PAGE_EXECUTE_READWRITE );
+		_storageCount = 1;
 		_currentStoragePointer = _storage[ 0 ];
 		return NULL;
 	}
@@ -86,28 +101,93 @@ byte* CodeGenerator::CommitStorageSpace( int size )
 	{
 		assert( size > 0 );
 
-		byte* block = _storage[ _storageIndex ];
-		int remaining = _storageBlockSize - ( _currentStoragePointer - block );
-		if( remaining < size )
-		{
+		byte* start = EnsureStorageSpace( size );
+		_currentStoragePointer += size;
+		return start;
+	}
+}
+
+// Moves to a new block if the current one can't fit size more bytes, and returns where they would go
+byte* CodeGenerator::EnsureStorageSpace( int size )
+{
+	byte* block = _storage[ _storageIndex ];
+	int remaining = _storageBlockSize - ( _currentStoragePointer - block );
+	if( remaining < size )
+	{
+		// Take the first free slot - released blocks leave holes
+		_storageIndex = 0;
+		while( ( _storageIndex < STORAGETABLESIZE ) &&
+			( _storage[ _storageIndex ] != NULL ) )
 			_storageIndex++;
+		assert( _storageIndex < STORAGETABLESIZE );
+		_storageCount++;
 #ifdef RESERVEANDCOMMITMEMORY
 		DWORD allocType = MEM_RESERVE;
 #else
 		DWORD allocType = MEM_COMMIT;
 #endif
-			_storage[ _storageIndex ] = ( byte* )VirtualAlloc( NULL, _storageBlockSize, allocType, PAGE_EXECUTE_READWRITE );
-			_currentStoragePointer = _storage[ _storageIndex ];
-		}
+		_storage[ _storageIndex ] = ( byte* )VirtualAlloc( NULL, _storageBlockSize, allocType, PAGE_EXECUTE_READWRITE );
+		_currentStoragePointer = _storage[ _storageIndex ];
+	}
 
-		// Commit the block
-		byte* start = _currentStoragePointer;
-		_currentStoragePointer += size;
 #ifdef RESERVEANDCOMMITMEMORY
-		VirtualAlloc( start, size, MEM_COMMIT, PAGE_EXECUTE_READWRITE );
+	VirtualAlloc( _currentStoragePointer, size, MEM_COMMIT, PAGE_EXECUTE_READWRITE );
 #endif
-		return start;
+	return _currentStoragePointer;
+}
+
+// Points _buffer at the end of storage, with room for the largest block we could generate
+void CodeGenerator::ReserveDirectSpace()
+{
+	assert( _offset == 0 );
+	_buffer = EnsureStorageSpace( _maximumCodeSize );
+}
+
+void CodeGenerator::SetDirect( bool enabled )
+{
+	assert( _offset == 0 );
+	assert( _storageBlockSize >= _maximumCodeSize );
+
+	_direct = enabled;
+	if( _direct == true )
+		ReserveDirectSpace();
+	else
+		_buffer = _privateBuffer;
+}
+
+int CodeGenerator::FindStorage( void* pointer )
+{
+	for( int n = 0; n < STORAGETABLESIZE; n++ )
+	{
+		byte* block = _storage[ n ];
+		if( ( block != NULL ) &&
+			( ( byte* )pointer >= block ) &&
+			( ( byte* )pointer < block + _storageBlockSize ) )
+			return n;
 	}
+	return -1;
+}
+
+void CodeGenerator::ReleaseStorage( int index )
+{
+	// Can't release the block we are allocating out of
+	assert( index != _storageIndex );
+	assert( _storagePinned[ index ] == false );
+	if( ( index == _storageIndex ) ||
+		( _storagePinned[ index ] == true ) ||
+		( _storage[ index ] == NULL ) )
+		return;
+
+	VirtualFree( _storage[ index ], 0, MEM_RELEASE );
+	_storage[ index ] = NULL;
+	_storageCount--;
+}
+
+void CodeGenerator::PinStorage( void* pointer )
+{
+	int index = FindStorage( pointer );
+	if( index >= 0 )
+		_storagePinned[ index ] = true;
 }
 
 FunctionPointer CodeGenerator::GenerateCode()
@@ -117,10 +197,30 @@ FunctionPointer CodeGenerator::GenerateCode()
 
 	if( _offset == 0 )
 		return 0;
+	assert( _overflowed == false );
 
-	// Allocate the target buffer (with execute privs) and copy over the code
-	void* ptr = ( void* )CommitStorageSpace( _offset );
-	memcpy( ptr, _buffer, _offset );
+	void* ptr;
+	if( _direct == true )
+	{
+		// Already in storage - take what was used and leave the rest for the next block
+		ptr = ( void* )_buffer;
+		assert( ( byte* )ptr == _currentStoragePointer );
+		_currentStoragePointer += _offset;
+	}
+	else
+	{
+		// Allocate the target buffer (with execute privs) and copy over the code
+		ptr = ( void* )CommitStorageSpace( _offset );
+	}
+	this->FinishCode( ( byte* )ptr );
+
+	return ( FunctionPointer )ptr;
+}
+
+void CodeGenerator::FinishCode( byte* ptr )
+{
+	if( ptr != _buffer )
+		memcpy( ptr, _buffer, _offset );
 
 	// Perform fixups
 	for( int n = 0; n < _referenceIndex; n++ )
@@ -147,6 +247,21 @@ FunctionPointer CodeGenerator::GenerateCode()
 			break;
 		}
 	}
+}
+
+FunctionPointer CodeGenerator::CopyCode( const byte* code, int length )
+{
+	if( length == 0 )
+		return 0;
+
+	// Would land on top of whatever is being generated
+	assert( ( _direct == false ) || ( _offset == 0 ) );
+
+	void* ptr = ( void* )CommitStorageSpace( length );
+	memcpy( ptr, code, length );
+
+	if( _direct == true )
+		ReserveDirectSpace();
 
 	return ( FunctionPointer )ptr;
 }
@@ -154,12 +269,17 @@ FunctionPointer CodeGenerator::GenerateCode()
 void CodeGenerator::Reset()
 {
 	_offset = 0;
+	_overflowed = false;
+	if( _direct == true )
+		ReserveDirectSpace();
 #ifdef SAFE
 	memset( _buffer, 0, _maximumSize );
 #endif
 
 	_labelIndex = 0;
 	_referenceIndex = 0;
+	_relocationIndex = 0;
+	_pointerNext = false;
 #ifdef SAFE
 	// Clearing is done by DefineLabel/AddReference to speed things up
 	memset( _labelTable, 0, sizeof( Label ) * _maximumSize );
@@ -193,6 +313,13 @@ Reference* CodeGenerator::ReferenceLabel( enum ReferenceType type, Label* label,
 	return r;
 }
 
+void CodeGenerator::AddRelocation( enum RelocationType type, int offset )
+{
+	Relocation* r = &_relocationTable[ _relocationIndex++ ];
+	r->Offset = offset;
+	r->Type = type;
+}
+
 byte* CodeGenerator::ResolveReference( Reference* reference )
 {
 	return 0;
@@ -200,6 +327,13 @@ byte* CodeGenerator::ResolveReference( Reference* reference )
 
 void CodeGenerator::Encode( const int instructionId, const Operand& op1, const Operand& op2, const Operand& op3 )
 {
+	// Nothing more is kept once we've run out of room
+	if( _overflowed == true )
+	{
+		_pointerNext = false;
+		return;
+	}
+
 	Instruction* instruction = &InstructionSet::Table[ instructionId ];
 
 	_synth->Reset();
@@ -273,7 +407,55 @@ void CodeGenerator::Encode( const int instructionId, const Operand& op1, const O
 		encoding.setDisplacement(displacement);
 	}*/
 
-	_offset += _synth->Commit( _buffer + _offset );
+	// Past the end - the builder has to start over with less code
+	if( _offset + _synth->GetLength() > _maximumCodeSize )
+	{
+		_overflowed = true;
+		_pointerNext = false;
+		return;
+	}
+
+	int length = _synth->Commit( _buffer + _offset );
+
+	if( _recordRelocations == true )
+	{
+		// Immediates always come last, right after the displacement
+		int immediateOffset = _offset + length - _synth->GetImmediateSize();
+		int displacementOffset = immediateOffset - _synth->GetDisplacementSize();
+
+		if( _synth->IsConstant() == true )
+		{
+			if( ( _synth->GetImmediateSize() == 4 ) &&
+				( _pointerNext == true ) )
+				this->AddRelocation( RelocAbsolute, immediateOffset );
+		}
+		else if( _synth->IsPseudoInstruction() == false )
+		{
+			// Label displacements are relative to the code and don't move
+			if( ( _synth->GetDisplacementSize() == 4 ) &&
+				( ( target == NULL ) || ( target->Type != RefAbsoluteDisplacement ) ) )
+				this->AddRelocation( RelocAbsolute, displacementOffset );
+
+			if( _synth->GetImmediateSize() == 4 )
+			{
+				if( target == NULL )
+				{
+					if( _pointerNext == true )
+						this->AddRelocation( RelocAbsolute, immediateOffset );
+				}
+				else if( target->Type == RefCall )
+					this->AddRelocation( RelocCall, immediateOffset );
+				else if( target->Type == RefAbsoluteImmediate )
+					this->AddRelocation( RelocCode, immediateOffset );
+				else if( ( target->Type == RefAbsoluteDisplacement ) &&
+					( _pointerNext == true ) )
+					this->AddRelocation( RelocAbsolute, immediateOffset );
+			}
+		}
+	}
+	_pointerNext = false;
+
+	_offset += length;
 }
 
 const OperandAL CodeGenerator::al;
@@ -9,6 +9,9 @@
 #include "Label.h"
 #include "Operand.h"
 
+// Maximum number of storage blocks that can be allocated at once
+#define STORAGETABLESIZE			64
+
 namespace Noxa {
 	namespace Emulation {
 		namespace Psp {
@@ -27,16 +30,27 @@ namespace Noxa {
 
 					byte**			_storage;
 					int				_storageIndex;
+					int				_storageCount;
+					int				_storageBudget;
+					bool			_storagePinned[ STORAGETABLESIZE ];
 					byte*			_currentStoragePointer;
 
-					byte*			_buffer;
+					byte*			_buffer;			// Where code is assembled - in storage when direct
+					byte*			_privateBuffer;
 					int				_offset;
+					bool			_direct;
+					bool			_overflowed;
 
 					int				_labelIndex;
 					Label*			_labelTable;
 					int				_referenceIndex;
 					Reference*		_referenceTable;
 
+					bool			_recordRelocations;
+					bool			_pointerNext;
+					int				_relocationIndex;
+					Relocation*		_relocationTable;
+
 					Synthesizer*	_synth;
 
 				public:
@@ -47,13 +61,57 @@ namespace Noxa {
 					void Reset();
 					int GetLength(){ return _offset; }
 
+					// When direct, code is assembled straight in to the end of the current storage block and
+					// GenerateCode does the fixups where it is and takes only the bytes used. Nothing else may take
+					// storage while code is being generated, and the storage block size has to be at least the
+					// maximum code size
+					void SetDirect( bool enabled );
+					bool IsDirect(){ return _direct; }
+
+					// Set when an instruction would have gone past the maximum code size - nothing past it is
+					// written, so the code has to be thrown away with Reset
+					bool HasOverflowed(){ return _overflowed; }
+
+					// Storage is handed out in blocks of _storageBlockSize bytes. If a budget is set, new blocks
+					// are still allocated past it, but IsOverBudget will return true until the owner releases
+					// enough of them with ReleaseStorage - code in a released block must never be run again
+					void SetStorageBudget( int bytes ){ _storageBudget = bytes; }
+					bool IsOverBudget(){ return ( _storageBudget > 0 ) && ( _storageCount * _storageBlockSize > _storageBudget ); }
+					int GetStorageBlockSize(){ return _storageBlockSize; }
+					int GetCurrentStorage(){ return _storageIndex; }
+					byte* GetStorage( int index ){ return _storage[ index ]; }
+					int FindStorage( void* pointer );
+					void ReleaseStorage( int index );
+
+					// Pinned blocks hold code that must live forever and are never released
+					void PinStorage( void* pointer );
+					bool IsStoragePinned( int index ){ return _storagePinned[ index ]; }
+
+					// Copies the code to ptr (GetLength bytes) and does all of the fixups for it running there - it does
+					// not have to be storage, but if it is moved the RelocCall/RelocCode fields have to be adjusted
+					void FinishCode( byte* ptr );
+
+					// Places code that was generated elsewhere (with all fixups done) in to storage
+					FunctionPointer CopyCode( const byte* code, int length );
+
+					// When recording, the 32-bit fields holding host addresses are noted so the code can be moved
+					// later - calls, label references and 32-bit memory displacements always are, and an immediate is
+					// only if Pointer was called right before the instruction that has it
+					void RecordRelocations( bool enabled ){ _recordRelocations = enabled; }
+					void Pointer(){ _pointerNext = true; }
+					int GetRelocationCount(){ return _relocationIndex; }
+					const Relocation* GetRelocations(){ return _relocationTable; }
+
 					Label* DefineLabel();
 					void MarkLabel( Label* label );
 
 				protected:
+					byte* EnsureStorageSpace( int size );
 					byte* CommitStorageSpace( int size );
+					void ReserveDirectSpace();
 
 					Reference* ReferenceLabel( enum ReferenceType type, Label* label, int offset );
+					void AddRelocation( enum RelocationType type, int offset );
 					byte* ResolveReference( Reference* reference );
 					void Encode( const int instructionId,
 						const Operand& op1 = OperandVOID(),
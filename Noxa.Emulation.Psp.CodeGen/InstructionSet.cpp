@@ -8,6 +8,7 @@
 #include "InstructionSet.h"
 #include <malloc.h>
 #include <string.h>
+#include <stdlib.h>
 
 using namespace Noxa::Emulation::Psp::CodeGen;
 
@@ -74,6 +75,140 @@ InstructionSet::InstructionSet()
 		Table[ n ].Op1 = op1;
 		Table[ n ].Op2 = op2;
 		Table[ n ].Op3 = op3;
+
+		ParseEncoding( &Table[ n ] );
+	}
+}
+
+void InstructionSet::ParseEncoding( Instruction* instruction )
+{
+	InstructionEncoding* encoding = &instruction->Encoding;
+	encoding->Operation = ENCODE_NONE;
+
+	const char* formats = instruction->Syntax->Encoding;
+	assert( formats != 0 );
+
+	while( *formats )
+	{
+		byte prefix = 0;
+		switch( ( formats[ 0 ] << 8 ) | formats[ 1 ] )
+		{
+		case LOCK_PRE:
+			prefix = 0xF0;
+			break;
+		case CONST_PRE:
+			prefix = 0xF1;
+			break;
+		case REPNE_PRE:
+			prefix = 0xF2;
+			break;
+		case REP_PRE:
+			prefix = 0xF3;
+			break;
+		case OFF_PRE:
+			if( IS32BIT( instruction ) == false )
+				prefix = 0x66;
+			break;
+		case ADDR_PRE:
+			if( IS32BIT( instruction ) == false )
+				prefix = 0x67;
+			break;
+		case ADD_REG:
+			// '+r' needs first opcode byte
+			assert( encoding->HasO1 == true );
+			encoding->Operation = ENCODE_ADD_REG;
+			break;
+		case EFF_ADDR:
+			encoding->Operation = ENCODE_EFF_ADDR;
+			break;
+		case MOD_RM_0:
+		case MOD_RM_1:
+		case MOD_RM_2:
+		case MOD_RM_3:
+		case MOD_RM_4:
+		case MOD_RM_5:
+		case MOD_RM_6:
+		case MOD_RM_7:
+			encoding->Operation = ENCODE_MOD_RM;
+			encoding->ModRMReg = formats[ 1 ] - '0';
+			break;
+		case QWORD_IMM:
+			// Not implemented
+			assert( false );
+			break;
+		case DWORD_IMM:
+			encoding->ImmediateSize = 4;
+			break;
+		case WORD_IMM:
+			encoding->ImmediateSize = 2;
+			break;
+		case BYTE_IMM:
+			encoding->ImmediateSize = 1;
+			break;
+		case BYTE_REL:
+			encoding->ImmediateSize = 1;
+			encoding->Relative = true;
+			break;
+		case DWORD_REL:
+			encoding->ImmediateSize = 4;
+			encoding->Relative = true;
+			break;
+		default:
+			unsigned int opcode = strtoul( formats, 0, 16 );
+			assert( opcode <= 0xFF );
+
+			if( !encoding->HasO1 )
+			{
+				encoding->O1 = ( byte )opcode;
+				encoding->HasO1 = true;
+			}
+			else if( !encoding->HasO2 &&
+					( encoding->O1 == 0x0F ||
+					  ( encoding->O1 >= 0xD8 && encoding->O1 <= 0xDF ) ) )
+			{
+				encoding->O2 = encoding->O1;
+				encoding->O1 = ( byte )opcode;
+				encoding->HasO2 = true;
+			}
+			else if( encoding->O1 == 0x66 )   // Operand size prefix for SSE2
+			{
+				prefix = 0x66;   // HACK: Might not be valid for later instruction sets
+				encoding->O1 = ( byte )opcode;
+			}
+			else if( encoding->O1 == 0x9B )   // FWAIT
+			{
+				prefix = 0x9B;   // HACK: Might not be valid for later instruction sets
+				encoding->O1 = ( byte )opcode;
+			}
+			else   // 3DNow!, SSE or SSE2 instruction, opcode as immediate
+			{
+				if( encoding->ImmediateSize == 0 )
+					encoding->ImmediateSize = 1;
+				encoding->HasOpcodeImmediate = true;
+				encoding->I1 = ( byte )opcode;
+			}
+		}
+
+		if( prefix != 0 )
+		{
+			// Too many prefixes in opcode
+			assert( encoding->PrefixCount < 4 );
+			encoding->Prefixes[ encoding->PrefixCount++ ] = prefix;
+		}
+
+		formats += 2;
+		if( *formats == ' ' )
+		{
+			formats++;
+		}
+		else if( *formats == '\0' )
+		{
+			break;
+		}
+		else
+		{
+			assert( false );
+		}
 	}
 }
 
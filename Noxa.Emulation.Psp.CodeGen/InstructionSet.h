@@ -99,6 +99,32 @@ namespace Noxa {
 					int		Flags;
 				} InstructionSyntax;
 
+				enum EncodingOperation
+				{
+					ENCODE_NONE,
+					ENCODE_ADD_REG,		// +r
+					ENCODE_EFF_ADDR,	// /r
+					ENCODE_MOD_RM,		// /#, with # in ModRMReg
+				};
+
+				// Syntax->Encoding as InstructionSet parsed it - everything but the operation only depends on
+				// the string, so the synthesizer just copies it in
+				typedef struct InstructionEncoding_t
+				{
+					byte				Prefixes[ 4 ];
+					byte				PrefixCount;
+					byte				O1;
+					byte				O2;
+					byte				I1;				// Trailing opcode byte of 3DNow! and SSE compares
+					bool				HasO1 : 1;
+					bool				HasO2 : 1;
+					bool				HasOpcodeImmediate : 1;
+					bool				Relative : 1;
+					byte				ImmediateSize;	// 0, 1, 2 or 4
+					byte				Operation;		// EncodingOperation
+					byte				ModRMReg;
+				} InstructionEncoding;
+
 				typedef struct Instruction_t
 				{
 					InstructionSyntax*	Syntax;
@@ -107,6 +133,8 @@ namespace Noxa {
 					Operand::Type		Op2;
 					Operand::Type		Op3;
 
+					InstructionEncoding	Encoding;
+
 				} Instruction;
 
 				#define IS32BIT( instr ) ( ( instr->Syntax->Flags & CPU_386 ) == CPU_386 )
@@ -126,6 +154,8 @@ namespace Noxa {
 				private:
 					static bool Ready;
 
+					static void ParseEncoding( Instruction* instruction );
+
 				};
 
 			}
@@ -36,6 +36,20 @@ namespace Noxa {
 					byte*				CodePointer;
 				} Reference;
 
+				enum RelocationType
+				{
+					RelocAbsolute,		// 32-bit address used as-is (immediates, displacements, dd)
+					RelocCall,			// rel32 to something outside of the code
+					RelocCode,			// Absolute address inside of the code itself
+				};
+
+				// A 32-bit field in generated code that has to be fixed up if the code, or what it points at, moves
+				typedef struct Relocation_t
+				{
+					int					Offset;
+					enum RelocationType	Type;
+				} Relocation;
+
 			}
 		}
 	}
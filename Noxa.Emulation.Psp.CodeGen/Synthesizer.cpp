@@ -6,7 +6,6 @@
 
 #include "Stdafx.h"
 #include "Synthesizer.h"
-#include <stdlib.h>
 
 using namespace Noxa::Emulation::Psp;
 using namespace Noxa::Emulation::Psp::CodeGen;
@@ -201,173 +200,78 @@ void Synthesizer::EncodeInstruction( const Instruction* instruction )
 	if( instruction == 0 )
 		return;
 
-	const char* formats = instruction->Syntax->Encoding;
-	assert( formats != 0 );
+	// Everything that only depends on the encoding string was worked out by InstructionSet
+	const InstructionEncoding* encoding = &instruction->Encoding;
 
-	while( *formats )
+	for( int n = 0; n < encoding->PrefixCount; n++ )
+		AddPrefix( encoding->Prefixes[ n ] );
+	if( encoding->HasO1 )
 	{
-		switch( ( formats[ 0 ] << 8 ) | formats[ 1 ] )
+		O1 = encoding->O1;
+		format.O1 = true;
+	}
+	if( encoding->HasO2 )
+	{
+		O2 = encoding->O2;
+		format.O2 = true;
+	}
+	switch( encoding->ImmediateSize )
+	{
+	case 4:
+		format.I3 = true;
+		format.I4 = true;
+	case 2:
+		format.I2 = true;
+	case 1:
+		format.I1 = true;
+		break;
+	}
+	if( encoding->HasOpcodeImmediate )
+		I1 = encoding->I1;
+	if( encoding->Relative )
+		relative = true;
+
+	switch( encoding->Operation )
+	{
+	case ENCODE_ADD_REG:
+		EncodeRexByte( instruction );
+		if( Operand::IsReg( _op1Type ) &&
+			_op1Type != Operand::OPERAND_ST0 )
 		{
-		case LOCK_PRE:
-			AddPrefix( 0xF0 );
-			break;
-		case CONST_PRE:
-			AddPrefix( 0xF1 );
-			break;
-		case REPNE_PRE:
-			AddPrefix( 0xF2 );
-			break;
-		case REP_PRE:
-			AddPrefix( 0xF3 );
-			break;
-		case OFF_PRE:
-			if( IS32BIT( instruction ) == false )
-			{
-				AddPrefix( 0x66 );
-			}
-			break;
-		case ADDR_PRE:
-			if( IS32BIT( instruction ) == false )
-			{
-				AddPrefix( 0x67 );
-			}
-			break;
-		case ADD_REG:
-			EncodeRexByte( instruction );
-			if( format.O1 )
-			{
-				if( Operand::IsReg( _op1Type ) &&
-					_op1Type != Operand::OPERAND_ST0 )
-				{
-					O1 += _op1Reg & 0x7;
-					REX.B = (_op1Reg & 0x8) >> 3;
-				}
-				else if( Operand::IsReg( _op2Type ) )
-				{
-					O1 += _op2Reg & 0x7;
-					REX.B = (_op2Reg & 0x8) >> 3;
-				}
-				else if( Operand::IsReg( _op1Type ) &&
-					_op1Type == Operand::OPERAND_ST0 )
-				{
-					O1 += _op1Reg & 0x7;
-					REX.B = (_op1Reg & 0x8) >> 3;
-				}
-				else
-				{
-					// '+r' not compatible with operands
-					assert( false );
-				}
-			}
-			else
-			{
-				// '+r' needs first opcode byte
-				assert( false );
-			}
-			break;
-		case EFF_ADDR:
-			EncodeRexByte( instruction );
-			EncodeModField();
-			EncodeRegField( instruction );
-			EncodeRMField( instruction );
-			EncodeSibByte( instruction );
-			break;
-		case MOD_RM_0:
-		case MOD_RM_1:
-		case MOD_RM_2:
-		case MOD_RM_3:
-		case MOD_RM_4:
-		case MOD_RM_5:
-		case MOD_RM_6:
-		case MOD_RM_7:
-			EncodeRexByte( instruction );
-			EncodeModField();
-			modRM.reg = formats[ 1 ] - '0';
-			EncodeRMField( instruction );
-			EncodeSibByte( instruction );
-			break;
-		case QWORD_IMM:
-			// Not implemented
-			assert( false );
-			break;
-		case DWORD_IMM:
-			format.I1 = true;
-			format.I2 = true;
-			format.I3 = true;
-			format.I4 = true;
-			break;
-		case WORD_IMM:
-			format.I1 = true;
-			format.I2 = true;
-			break;
-		case BYTE_IMM:
-			format.I1 = true;
-			break;
-		case BYTE_REL:
-			format.I1 = true;
-			relative = true;
-			break;
-		case DWORD_REL:
-			format.I1 = true;
-			format.I2 = true;
-			format.I3 = true;
-			format.I4 = true;
-			relative = true;
-			break;
-		default:
-			unsigned int opcode = strtoul( formats, 0, 16 );
-			assert( opcode <= 0xFF );
-
-			if( !format.O1 )
-			{
-				O1 = (unsigned char)opcode;
-				format.O1 = true;
-			}
-			else if( !format.O2 &&
-					( O1 == 0x0F ||
-					  O1 == 0xD8 ||
-					  O1 == 0xD9 ||
-					  O1 == 0xDA ||
-					  O1 == 0xDB ||
-					  O1 == 0xDC ||
-					  O1 == 0xDD ||
-					  O1 == 0xDE ||
-					  O1 == 0xDF ) )
-			{
-				O2 = O1;
-				O1 = opcode;
-				format.O2 = true;
-			}
-			else if( O1 == 0x66 )   // Operand size prefix for SSE2
-			{
-				AddPrefix(0x66);   // HACK: Might not be valid for later instruction sets
-				O1 = opcode;
-			}
-			else if( O1 == 0x9B )   // FWAIT
-			{
-				AddPrefix( 0x9B );   // HACK: Might not be valid for later instruction sets
-				O1 = opcode;
-			}
-			else   // 3DNow!, SSE or SSE2 instruction, opcode as immediate
-			{
-				format.I1 = true;
-				I1 = opcode;
-			}
+			O1 += _op1Reg & 0x7;
+			REX.B = (_op1Reg & 0x8) >> 3;
 		}
-
-		formats += 2;
-		if( *formats == ' ' )	
+		else if( Operand::IsReg( _op2Type ) )
 		{
-			formats++;
+			O1 += _op2Reg & 0x7;
+			REX.B = (_op2Reg & 0x8) >> 3;
 		}
-		else if( *formats == '\0' )
+		else if( Operand::IsReg( _op1Type ) &&
+			_op1Type == Operand::OPERAND_ST0 )
 		{
-			break;
+			O1 += _op1Reg & 0x7;
+			REX.B = (_op1Reg & 0x8) >> 3;
 		}
 		else
 		{
+			// '+r' not compatible with operands
 			assert( false );
 		}
+		break;
+	case ENCODE_EFF_ADDR:
+		EncodeRexByte( instruction );
+		EncodeModField();
+		EncodeRegField( instruction );
+		EncodeRMField( instruction );
+		EncodeSibByte( instruction );
+		break;
+	case ENCODE_MOD_RM:
+		EncodeRexByte( instruction );
+		EncodeModField();
+		modRM.reg = encoding->ModRMReg;
+		EncodeRMField( instruction );
+		EncodeSibByte( instruction );
+		break;
 	}
 }
 
@@ -777,6 +681,18 @@ int Synthesizer::Align( byte* buffer, int alignment, bool write )
 	return padding;
 }
 
+bool Synthesizer::IsConstant() const
+{
+	// Same tests as Commit - ALIGN and arrays don't have any fields
+	if( IsPseudoInstruction() == false )
+		return false;
+	if( ( O1 == 0x90 ) && immediate )
+		return false;
+	if( ( O1 == 0x01 || O1 == 0x02 || O1 == 0x04 ) && displacement )
+		return false;
+	return true;
+}
+
 int Synthesizer::GetImmediate() const
 {
 	return immediate;
@@ -38,6 +38,10 @@ namespace Noxa {
 					bool HasDisplacement() const { return format.D1 || format.D2 || format.D3 || format.D4; }
 					bool HasImmediate() const { return format.I1 || format.I2 || format.I3 || format.I4; }
 					bool IsRipRelative() const { return modRM.mod == 0 && modRM.r_m == 5; }
+					int GetDisplacementSize() const { return format.D1 + format.D2 + format.D3 + format.D4; }
+					int GetImmediateSize() const { return format.I1 + format.I2 + format.I3 + format.I4; }
+					bool IsPseudoInstruction() const { return P1 == 0xF1; }
+					bool IsConstant() const;
 
 					int GetImmediate() const;
 					void SetImmediate( int imm );
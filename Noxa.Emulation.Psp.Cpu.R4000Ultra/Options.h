@@ -25,6 +25,89 @@
 // Define to support the native video interface
 #define NATIVEVIDEOINTERFACE
 
+// When defined, generated blocks will keep hot GPRs in ESI/EDI between instructions
+// instead of going back to the ctx every time (see R4000RegisterCache)
+#define REGISTERCACHING
+
+// When defined, generated blocks will keep COP1 registers in XMM2-XMM7 between instructions
+// instead of going back to the ctx every time (see R4000FpuCache)
+#define FPUCACHING
+
+// When defined, each block is analyzed before emission so that instructions with constant
+// results can be folded, results that are never read are dropped, and loads/stores from
+// known addresses skip the address range checks
+#define CONSTANTPROPAGATION
+
+// When defined, guest memory is laid out in one host reservation (see R4000FastMemory) so that
+// loads and stores are a mask and a single access - bad addresses are caught by a fault handler
+#define FASTMEMORY
+
+// When defined, JAL/JALR push their return address on to a small prediction stack and JR $ra
+// jumps straight to the predicted block when it matches instead of doing a full lookup
+#define RETURNSTACK
+
+// When defined, QuickPointerLookup uses a flat table (one entry per word of main memory) instead of
+// walking the three level table - the tiered table is still used for everything outside main memory
+#define FLATCODELOOKUP
+
+// When defined, the code cache tracks which pages have compiled code in them and stores to those pages
+// (and memory writes from the BIOS) drop any blocks they overlap, unlinking jumps in to them
+#define SMCDETECTION
+
+// When defined, generated code is kept under CODECACHEBUDGET bytes - once over, the coldest storage block
+// (by the ExecutionCount of the blocks in it) is thrown away, along with every block built in to it
+#define CODECACHEEVICTION
+#define CODECACHEBUDGET		( 1024 * 1024 * 64 )
+
+// When defined, generated blocks are written (with relocations for the host addresses in them) to a file
+// per boot module under PERSISTENTCACHEPATH and loaded back on later runs if their guest code is unchanged
+//#define PERSISTENTCACHE
+#define PERSISTENTCACHEPATH		"JitCache"
+
+// When defined, a worker thread compiles the blocks a newly built block can branch to (up to BACKGROUNDDEPTH
+// branches away) so that they are usually ready by the time the emulation thread gets to them
+#define BACKGROUNDCOMPILE
+#define BACKGROUNDQUEUESIZE		256
+#define BACKGROUNDDEPTH			3
+
+// When defined, blocks are first built without the analysis pass or the register cache and count their runs in
+// TierUpCount - once one has run HOTBLOCKTHRESHOLD times it is rebuilt in place with everything turned on
+#define TIEREDCOMPILE
+#define HOTBLOCKTHRESHOLD		64
+
+// When defined, the common VFPU vector and matrix ops are generated inline as SSE instead of calling their
+// VfpuImpl* helpers - prefixes set earlier in the block are folded in, others are checked at runtime
+#define VFPUSSE
+
+// When defined, blocks are assembled straight in to code storage instead of a private buffer that is copied
+// in to it once they are finished (the background compiler still uses a buffer)
+#define DIRECTCODEGEN
+
+// When defined, optimized blocks that would end on a J keep going at its target (if it is a little further on) instead
+// of leaving through a jump block, so the register caches and the analysis carry across it - with TIEREDCOMPILE this
+// only happens to hot blocks. A trace covers everything from its first instruction to its last, jumped over or not
+#define SUPERBLOCKS
+
+// When defined, optimized blocks take a backward branch over a short loop that only reads memory (or calls the
+// sceDisplayGetVcount stub) by leaving with CtxIdle set, so the execution loop can give the host thread away instead
+// of spinning until a timer or another thread changes what the loop is waiting on. After IDLESLEEPTHRESHOLD idle
+// exits in a row it sleeps instead of just yielding
+#define IDLELOOPS
+#define IDLELOOPLENGTH			8
+#define IDLESLEEPTHRESHOLD		64
+
+// When defined, every block takes its length out of the ctx Budget when it starts (and loops inside of a block take
+// theirs each time around), and blocks go back to the execution loop instead of on to the next one once it goes
+// negative - each NativeExecute gets EXECUTIONBUDGET instructions and reports how many it used
+#define INSTRUCTIONBUDGET
+#define EXECUTIONBUDGET			10000
+
+// Dropping blocks out from under patched jumps requires tracking the jumps, and blocks built off-thread
+// can't look at the cache to link directly
+#if defined( SMCDETECTION ) || defined( CODECACHEEVICTION ) || defined( BACKGROUNDCOMPILE ) || defined( TIEREDCOMPILE )
+#define BLOCKLINKS
+#endif
+
 // -- TRACE -- Options live in TraceOptions.h
 
 // ---------------------- Debug options -------------------------------------
@@ -5,6 +5,10 @@
 // ----------------------------------------------------------------------------
 
 #include "StdAfx.h"
+#pragma unmanaged
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#pragma managed
 #include "DebugOptions.h"
 #include "TraceOptions.h"
 #include "R4000BlockBuilder.h"
@@ -50,12 +54,19 @@ extern uint _instructionsExecuted;
 extern uint _codeBlocksExecuted;
 extern uint _jumpBlockInlineHits;
 extern uint _jumpBlockInlineMisses;
+extern uint _returnPredictionHits;
+extern uint _returnPredictionMisses;
 
 extern uint _jumpBlockInlineCount;
 extern uint _jumpBlockThunkCount;
 extern uint _jumpBlockLookupCount;
 extern uint _codeBlockRetCount;
 
+#ifdef RETURNSTACK
+extern ReturnLink* _returnStack[ RETURNSTACKSIZE ];
+extern int _returnStackTop;
+#endif
+
 void __flushTrace();
 
 #ifdef DEBUGGING
@@ -64,18 +75,40 @@ void SetBreakpoint( Breakpoint^ breakpoint );
 void SetBreakpoint( Breakpoint^ breakpoint, CodeBlock* block );
 #endif
 
-#define ENDADDRESS ( startAddress + ( maxCodeLength << 2 ) )
-
 R4000AdvancedBlockBuilder::R4000AdvancedBlockBuilder( R4000Cpu^ cpu, R4000Core^ core )
 	: R4000BlockBuilder( cpu, core )
 {
 }
 
+R4000AdvancedBlockBuilder::R4000AdvancedBlockBuilder( R4000Cpu^ cpu, R4000Core^ core, R4000GenContext^ context )
+	: R4000BlockBuilder( cpu, core, context )
+{
+}
+
 R4000AdvancedBlockBuilder::~R4000AdvancedBlockBuilder()
 {
 }
 
 int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block )
+{
+	// Only a long run of instructions that generate a lot of code can fill the generator - if one does,
+	// it becomes a shorter block and the rest goes in the next one
+	int maxCodeLength = MAXCODELENGTH;
+	while( true )
+	{
+		int count = this->InternalBuild( startAddress, block, maxCodeLength );
+		if( count >= 0 )
+			return count;
+
+		Debug::Assert( maxCodeLength > 1 );
+#ifdef GENDEBUG
+		Debug::WriteLine( String::Format( "InternalBuild(0x{0:X8}): out of code space at {1} instructions, retrying", startAddress, maxCodeLength ) );
+#endif
+		maxCodeLength /= 2;
+	}
+}
+
+int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block, int maxCodeLength )
 {
 	int count = 0;
 	int endAddress = startAddress;
@@ -100,16 +133,55 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 	List<Breakpoint^>^ breakpoints = gcnew List<Breakpoint^>();
 #endif
 
-	int maxCodeLength = MAXCODELENGTH;
+	// The debugger reads registers straight out of the ctx, so nothing gets optimized if it's attached
+	bool optimize = ( _cpu->_hook == nullptr );
+#ifdef TIEREDCOMPILE
+	// Quick builds leave it all for Recompile, if the block turns out to be worth it
+	if( block->Tier == 0 )
+		optimize = false;
+#endif
+
+	bool followJumps = false;
+#ifdef SUPERBLOCKS
+	followJumps = optimize;
+#endif
+
 	for( int pass = 0; pass <= 1; pass++ )
 	{
 		if( pass == 1 )
 		{
-			GeneratePreamble();
+#ifdef CONSTANTPROPAGATION
+			// We need to see the whole block (and all of its labels) before we can analyze it
+			if( ( optimize == true ) &&
+				( count <= MAXANALYSISLENGTH ) )
+				this->AnalyzeBlock( startAddress, count );
+#endif
+
+			// Only the first run - the rest are paid for as they are entered, so a trace costs the same as
+			// the blocks it was made from
+			GeneratePreamble( block, _ctx->SegmentLength( 0 ) );
+#ifdef TIEREDCOMPILE
+			if( block->Tier == 0 )
+				this->EmitHotnessCheck( block );
+#endif
+
+			bool cacheRegisters = false;
+#ifdef REGISTERCACHING
+			cacheRegisters = optimize;
+#endif
+			_ctx->Registers->Reset( _ctx->CtxPointer, cacheRegisters );
+
+			bool cacheFpu = false;
+#if defined( FPUCACHING ) && !defined( TRACE )
+			// Traces call out (and read the FPRs from the ctx) between instructions
+			cacheFpu = optimize;
+#endif
+			_ctx->FpuRegisters->Reset( _ctx->CtxPointer, cacheFpu );
 
 #ifdef DEBUGGING
-			// We know the length, so allocate the size buffer
-			block->InstructionSizes = ( ushort* )malloc( sizeof( ushort ) * count );
+			// We know the length, so allocate the size buffer - indexed by address, so anything a trace jumped
+			// over stays 0, and the tail goes after the last instruction
+			block->InstructionSizes = ( ushort* )calloc( ( ( _ctx->EndAddress - startAddress ) >> 2 ) + 2, sizeof( ushort ) );
 #endif
 		}
 
@@ -124,10 +196,12 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 		bool maxLengthHit = false;
 		bool checkNullDelay = false;
 		int address = startAddress;
+		int segment = 0;
 		
 #ifdef DEBUGGING
 		// Used for sizing - we get the length now because the preamble has stuff
 		int lastOffset = 0;
+		int lastIndex = 0;
 		if( pass == 1 )
 		{
 			lastOffset = _gen->GetLength();
@@ -144,6 +218,9 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 
 			bool inDelay = _ctx->InDelay;
 			uint code = *( ( uint* )( mainMemory + ( address - MainMemoryBase ) ) );
+#ifdef DEBUGGING
+			int index = ( address - startAddress ) >> 2;
+#endif
 
 #if _DEBUG
 			bool needsFixup = false;
@@ -177,10 +254,10 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 					block->PreambleSize += ( _gen->GetLength() - lastOffset );
 				else
 				{
-					int lastSize = block->InstructionSizes[ n - 1 ];
+					int lastSize = block->InstructionSizes[ lastIndex ];
 					lastSize += ( _gen->GetLength() - lastOffset );
 					Debug::Assert( lastSize < ushort::MaxValue );
-					block->InstructionSizes[ n - 1 ] = lastSize;
+					block->InstructionSizes[ lastIndex ] = lastSize;
 				}
 				lastOffset = newOffset;
 			}
@@ -188,6 +265,9 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 
 			if( ( pass == 1 ) && ( checkNullDelay == true ) )
 			{
+				_ctx->Registers->Flush();
+				_ctx->FpuRegisters->Flush();
+				EmitVfpuPrefixStores( _ctx, false );
 				nullDelayLabel = g->DefineLabel();
 				g->mov( EAX, MNULLDELAY( CTXP( _ctx->CtxPointer ) ) );
 				g->cmp( EAX, 1 );
@@ -199,10 +279,10 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 					block->PreambleSize += ( _gen->GetLength() - lastOffset );
 				else
 				{
-					int lastSize = block->InstructionSizes[ n - 1 ];
+					int lastSize = block->InstructionSizes[ lastIndex ];
 					lastSize += ( _gen->GetLength() - lastOffset );
 					Debug::Assert( lastSize < ushort::MaxValue );
-					block->InstructionSizes[ n - 1 ] = lastSize;
+					block->InstructionSizes[ lastIndex ] = lastSize;
 				}
 				lastOffset = newOffset;
 			}
@@ -228,6 +308,12 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 #ifdef VERBOSEBUILD
 					Debug::WriteLine( String::Format( "Marking label for branch target {0:X8}", address ) );
 #endif
+					// Control flow merges here, so nothing can be cached across the label
+					_ctx->Registers->Flush();
+					_ctx->FpuRegisters->Flush();
+					EmitVfpuPrefixStores( _ctx, false );
+					_ctx->VfpuPrefixesKnown = 0;
+					_ctx->Cp1ConditionAddress = 0;
 					_gen->MarkLabel( lm->Label );
 				}
 			}
@@ -270,10 +356,10 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 
 					// Need to fixup offsets
 					int newOffset = _gen->GetLength();
-					int lastSize = block->InstructionSizes[ n - 1 ];
+					int lastSize = block->InstructionSizes[ lastIndex ];
 					lastSize += ( _gen->GetLength() - lastOffset );
 					Debug::Assert( lastSize < ushort::MaxValue );
-					block->InstructionSizes[ n - 1 ] = lastSize;
+					block->InstructionSizes[ lastIndex ] = lastSize;
 					lastOffset = newOffset;
 				}
 
@@ -315,7 +401,7 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 			}
 #endif
 
-#ifdef STATISTICS
+#if defined( STATISTICS ) && !defined( INSTRUCTIONBUDGET )
 			if( pass == 1 )
 			{
 				// Instruction counter increment - note that it has to be here cause
@@ -328,7 +414,51 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 				this->EmitTrace( address, code );
 #endif
 
-			if( code != 0 )
+			// Anything that goes to the ctx directly needs the cache written back first
+			if( ( pass == 1 ) &&
+				( R4000Generator::UsesRegisterCache( code ) == false ) )
+				_ctx->Registers->Flush();
+			// XMM registers don't survive calls, and some instructions go to the COP1 registers in the ctx
+			if( ( pass == 1 ) &&
+				( R4000Generator::KeepsFpuCache( code ) == false ) )
+				_ctx->FpuRegisters->Flush();
+
+			// Instructions that the analysis pass fully resolved don't need their emitter
+			bool folded = false;
+			_ctx->CurrentInfo = NULL;
+			if( ( pass == 1 ) &&
+				( _ctx->AnalysisValid == true ) &&
+				( n < count ) )
+			{
+				InstructionInfo* info = &_ctx->Analysis[ n ];
+				_ctx->CurrentInfo = info;
+
+				if( ( code != 0 ) &&
+					( R4000Generator::UsesRegisterCache( code ) == true ) )
+				{
+					int dest = GetDestinationRegister( code );
+					if( dest > 0 )
+					{
+						if( info->Dead == true )
+							folded = true;
+						else if( info->ResultKnown == true )
+						{
+							g->mov( _ctx->Registers->Write( dest ), ( uint )info->Result );
+							folded = true;
+						}
+					}
+				}
+			}
+
+			if( folded == true )
+			{
+				result = GenerationResult::Success;
+#ifdef EMITDEBUG
+				sprintf_s( codeString, 150, "folded (%s)", ( _ctx->CurrentInfo->Dead == true ) ? "dead" : "constant" );
+				this->EmitDebug( address, code, codeString );
+#endif
+			}
+			else if( code != 0 )
 			{
 				uint opcode = ( code >> 26 ) & 0x3F;
 				bool isCop = ( opcode == 0x10 ) || ( opcode == 0x11 ) || ( opcode == 0x12 );
@@ -562,10 +692,21 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 				}
 			}
 
+			if( pass == 1 )
+			{
+				_ctx->Registers->Unlock();
+				_ctx->FpuRegisters->Unlock();
+				_ctx->CurrentInfo = NULL;
+			}
+
 			if( ( pass == 1 ) && ( checkNullDelay == true ) )
 			{
 				Label* nullDelaySkipLabel = g->DefineLabel();
 
+				_ctx->Registers->Flush();
+				_ctx->FpuRegisters->Flush();
+				EmitVfpuPrefixStores( _ctx, false );
+
 				g->jmp( nullDelaySkipLabel );
 
 				g->MarkLabel( nullDelayLabel );
@@ -573,6 +714,11 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 
 				g->MarkLabel( nullDelaySkipLabel );
 
+				// The delay slot may not have run, so any prefix it consumed may still be set (and EBX may
+				// not have what a c.cond in it left)
+				_ctx->VfpuPrefixesKnown = 0;
+				_ctx->Cp1ConditionAddress = 0;
+
 				checkNullDelay = false;
 			}
 
@@ -614,6 +760,14 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 
 			if( pass == 1 )
 			{
+				// Both of these leave the block or jump to a label
+				if( ( jumpDelay == true ) || ( inDelay == true ) )
+				{
+					_ctx->Registers->Flush();
+					_ctx->FpuRegisters->Flush();
+					EmitVfpuPrefixStores( _ctx, false );
+				}
+
 				// Have to use local inDelay because the last instruction could have been the one to set it
 				// Could also be in a jump delay, which only happens on non-breakout jumps
 				if( jumpDelay == true )
@@ -650,8 +804,54 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 					LabelMarker^ lm = _ctx->BranchTarget;
 					Debug::Assert( lm != nullptr );
 
-					if( ( _ctx->IsBranchLocal( lm->Address ) == true ) &&
-						( lm->Address <= ENDADDRESS ) )
+					// Loops have to stay in one run - going back in to an earlier one would pay for the runs
+					// after it again on the way through
+					bool local = _ctx->IsBranchLocal( lm->Address );
+#ifdef INSTRUCTIONBUDGET
+					if( ( local == true ) &&
+						( lm->Address < address ) &&
+						( lm->Address < _ctx->SegmentStart( segment ) ) )
+						local = false;
+#endif
+
+					bool idle = false;
+#ifdef IDLELOOPS
+					idle = ( optimize == true ) && ( this->IsIdleBranch( address - 8, lm->Address ) == true );
+#endif
+					if( idle == true )
+					{
+						// Going around again can't change anything until something else runs, so leave and let the
+						// execution loop give the time away - the loop starts over when we get back
+						Label* noBranch = g->DefineLabel();
+
+						g->cmp( MPCVALID( CTXP( _ctx->CtxPointer ) ), 1 );
+						g->jne( noBranch );
+						g->mov( MPC( CTXP( _ctx->CtxPointer ) ), lm->Address );
+						g->or( MSTOPFLAG( CTXP( _ctx->CtxPointer ) ), ( uint )CtxIdle );
+						GenerateTail( address - 4, false, 0 );
+
+						g->MarkLabel( noBranch );
+					}
+#ifdef INSTRUCTIONBUDGET
+					else if( ( local == true ) &&
+						( lm->Address < address ) )
+					{
+						// Going back around doesn't pass through the preamble, so loops pay for themselves here, and
+						// leave to the execution loop once the budget is gone
+						Label* noBranch = g->DefineLabel();
+
+						g->cmp( MPCVALID( CTXP( _ctx->CtxPointer ) ), 1 );
+						g->mov( MPCVALID( CTXP( _ctx->CtxPointer ) ), 0 );
+						g->jne( noBranch );
+						g->sub( MBUDGET( CTXP( _ctx->CtxPointer ) ), ( uint )( ( address - lm->Address ) >> 2 ) );
+						g->jns( lm->Label );
+						g->mov( MPC( CTXP( _ctx->CtxPointer ) ), lm->Address );
+						GenerateTail( address - 4, false, 0 );
+
+						g->MarkLabel( noBranch );
+					}
+#endif
+					else if( local == true )
 					{
 						g->cmp( MPCVALID( CTXP( _ctx->CtxPointer ) ), 1 );
 						g->mov( MPCVALID( CTXP( _ctx->CtxPointer ) ), 0 );
@@ -689,8 +889,9 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 				int newOffset = _gen->GetLength();
 				int lastSize = ( newOffset - lastOffset );
 				Debug::Assert( lastSize < ushort::MaxValue );
-				block->InstructionSizes[ n ] = lastSize;
+				block->InstructionSizes[ index ] = lastSize;
 				lastOffset = newOffset;
+				lastIndex = index;
 			}
 #endif
 
@@ -703,7 +904,29 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 
 			// For delay slots
 			if( breakOut == true )
+			{
+#ifdef SUPERBLOCKS
+				// The end of a run in a trace - keep going at the jump target with everything still cached
+				if( ( segment < _ctx->SegmentCount ) &&
+					( address - 4 == _ctx->SegmentEnds[ segment ] ) )
+				{
+					address = _ctx->NextAddress( address - 4, &segment );
+					if( pass == 1 )
+					{
+						// Same as the preamble would have done (J already set the PC)
+						g->mov( MPCVALID( CTXP( _ctx->CtxPointer ) ), 0 );
+#ifdef INSTRUCTIONBUDGET
+						g->sub( MBUDGET( CTXP( _ctx->CtxPointer ) ), ( uint )_ctx->SegmentLength( segment ) );
+#endif
+					}
+					_ctx->JumpTarget = NULL;
+					breakOut = false;
+					lastResult = GenerationResult::Success;
+					continue;
+				}
+#endif
 				break;
+			}
 
 			switch( result )
 			{
@@ -712,6 +935,17 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 				lastResult = result;
 				break;
 			case GenerationResult::Jump:
+#ifdef SUPERBLOCKS
+				if( ( ( pass == 0 ) && ( followJumps == true ) && ( this->FollowJump( startAddress, address, count, maxCodeLength ) == true ) ) ||
+					( ( pass == 1 ) && ( segment < _ctx->SegmentCount ) && ( address == _ctx->SegmentEnds[ segment ] ) ) )
+				{
+					// Ends the run after the delay slot (see below) - pass 1 has to do the same thing even though
+					// LastBranchTarget now includes the targets after it
+					breakOut = true;
+					lastResult = result;
+					break;
+				}
+#endif
 				// This is tricky - if lastTargetPc > currentPc, don't break out
 				if( ( _ctx->LastBranchTarget != 0x0 ) &&
 					( _ctx->LastBranchTarget <= address ) )
@@ -761,6 +995,9 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 
 		if( pass == 1 )
 		{
+			_ctx->Registers->Flush();
+			_ctx->FpuRegisters->Flush();
+
 			if( ( lastResult == GenerationResult::Syscall ) &&
 				( _ctx->LastSyscallStateless == false ) )
 			{
@@ -798,17 +1035,43 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 			int newOffset = _gen->GetLength();
 			int lastSize = ( newOffset - lastOffset );
 			Debug::Assert( lastSize < ushort::MaxValue );
-			block->InstructionSizes[ count ] = lastSize;
+			block->InstructionSizes[ ( ( _ctx->EndAddress - startAddress ) >> 2 ) + 1 ] = lastSize;
 			lastOffset = newOffset;
 #endif
 		}
 	}
 
+	if( _gen->HasOverflowed() == true )
+	{
+#ifdef DEBUGGING
+		SAFEFREE( block->InstructionSizes );
+#endif
+		_gen->Reset();
+		return -1;
+	}
+
 	block->EndsOnSyscall = ( lastResult == GenerationResult::Syscall );
 
 	// Must be set for breakpoint searching
 	block->Size = _gen->GetLength();
-	block->InstructionCount = count;
+
+	// Traces cover the code they jumped over too, so writes to it drop them - a block being rebuilt in place
+	// has its pages marked already, and they have to follow it if it grew
+	int length = ( ( _ctx->EndAddress - startAddress ) >> 2 ) + 1;
+	if( ( _detached == false ) &&
+		( block->Pointer != NULL ) )
+		_codeCache->UpdateLength( block, length );
+	else
+		block->InstructionCount = length;
+
+	if( _detached == true )
+	{
+		// Off of the emulation thread we can't touch storage or the cache - the code goes in a private
+		// buffer and the background compiler moves it in to storage when it publishes the block
+		block->Pointer = malloc( block->Size );
+		_gen->FinishCode( ( byte* )block->Pointer );
+		return count;
+	}
 
 	FunctionPointer ptr = _gen->GenerateCode();
 	_cpu->_codeCache->UpdatePointer( block, ptr );
@@ -835,6 +1098,185 @@ int R4000AdvancedBlockBuilder::InternalBuild( int startAddress, CodeBlock* block
 	return count;
 }
 
+#ifdef SUPERBLOCKS
+bool R4000AdvancedBlockBuilder::FollowJump( int startAddress, int address, int count, int maxCodeLength )
+{
+	// Only Js that would end the block anyway - anything still waiting on a label after it has to fall through to it,
+	// and jumping backwards would mean covering the same code twice
+	int target = _ctx->JumpTarget;
+	if( ( target == NULL ) ||
+		( _ctx->LastBranchTarget > address ) ||
+		( target <= address ) ||
+		( target >= MainMemoryBound ) ||
+		( _ctx->SegmentCount >= MAXSEGMENTS ) )
+		return false;
+
+	// Whatever is left of the block has to fit in MAXBLOCKSPAN, or invalidation won't find it
+	if( ( maxCodeLength - count <= 2 ) ||
+		( ( target - startAddress ) + ( ( maxCodeLength - count + 2 ) << 2 ) > MAXBLOCKSPAN ) )
+		return false;
+
+	_ctx->SegmentStarts[ _ctx->SegmentCount ] = _ctx->SegmentAddress;
+	_ctx->SegmentEnds[ _ctx->SegmentCount ] = address;
+	_ctx->SegmentCount++;
+	_ctx->SegmentAddress = target;
+
+	return true;
+}
+#endif
+
+#ifdef IDLELOOPS
+bool R4000AdvancedBlockBuilder::IsIdleBranch( int address, int target )
+{
+	// Only short loops that are still all there in memory - the loop doesn't have to be in this block
+	int count = ( ( address - target ) >> 2 ) + 2;
+	if( ( target > address ) ||
+		( target < MainMemoryBase ) ||
+		( count > IDLELOOPLENGTH ) )
+		return false;
+
+	const uint* codes = ( const uint* )( _memory->MainMemory + ( target - MainMemoryBase ) );
+	uint calls = 0;
+	for( int n = 0; n < count - 3; n++ )
+	{
+		int callTarget;
+		if( ( ( codes[ n ] >> 26 ) == 3 ) &&
+			( GetStaticTarget( codes[ n ], target + ( n << 2 ), &callTarget ) == true ) &&
+			( this->IsIdleCall( callTarget ) == true ) )
+			calls |= ( 1 << n );
+	}
+
+	return IsIdleLoop( codes, target, count, calls );
+}
+
+bool R4000AdvancedBlockBuilder::IsIdleCall( int target )
+{
+	// Import stubs are a JR $ra with the syscall in its delay slot
+	if( ( target < MainMemoryBase ) ||
+		( target + 8 > MainMemoryBound ) )
+		return false;
+	const uint* stub = ( const uint* )( _memory->MainMemory + ( target - MainMemoryBase ) );
+	if( ( stub[ 0 ] != 0x03E00008 ) ||
+		( ( stub[ 1 ] & 0xFC00003F ) != 0x0000000C ) )
+		return false;
+
+	int syscall = ( int )( ( stub[ 1 ] >> 6 ) & 0xFFFFF );
+	if( syscall >= _cpu->_syscalls->Length )
+		return false;
+	BiosFunction^ function = _cpu->_syscalls[ syscall ];
+
+	// sceDisplayGetVcount only changes when the vblank timer fires
+	return ( function != nullptr ) &&
+		( function->NID == 0x9C6EAAD7 );
+}
+#endif
+
+void R4000AdvancedBlockBuilder::AnalyzeBlock( int startAddress, int count )
+{
+	InstructionInfo* infos = _ctx->Analysis;
+
+	// Traces skip around, so work out where each instruction came from first
+	uint codes[ MAXANALYSISLENGTH ];
+	int addresses[ MAXANALYSISLENGTH ];
+	int address = startAddress;
+	int segment = 0;
+	for( int n = 0; n < count; n++ )
+	{
+		addresses[ n ] = address;
+		codes[ n ] = *( ( uint* )( _memory->MainMemory + ( address - MainMemoryBase ) ) );
+		address = _ctx->NextAddress( address, &segment );
+	}
+
+	// Find the branch targets inside of the block - constants can't be carried across them
+	bool targets[ MAXANALYSISLENGTH ];
+	memset( targets, 0, sizeof( targets ) );
+	for each( LabelMarker^ lm in _ctx->BranchLabels->Values )
+	{
+		for( int n = 0; n < count; n++ )
+		{
+			if( addresses[ n ] == lm->Address )
+			{
+				targets[ n ] = true;
+				break;
+			}
+		}
+	}
+
+	// Forward pass: constant propagation
+	uint known = 0x1;
+	uint values[ 32 ];
+	memset( values, 0, sizeof( values ) );
+	for( int n = 0; n < count; n++ )
+	{
+		InstructionInfo* info = &infos[ n ];
+		uint code = codes[ n ];
+		int rs = ( code >> 21 ) & 0x1F;
+		int rt = ( code >> 16 ) & 0x1F;
+
+		if( targets[ n ] == true )
+			known = 0x1;
+
+		info->Dead = false;
+		info->ResultKnown = false;
+		info->Result = 0;
+		info->RsKnown = ( known & ( 1 << rs ) ) != 0;
+		info->RsValue = values[ rs ];
+		info->RtKnown = ( known & ( 1 << rt ) ) != 0;
+		info->RtValue = values[ rt ];
+
+		// Delay slots of likely branches may not run, so we can't say what's in their outputs after
+		bool nullableDelay = ( n > 0 ) && ( IsLikelyBranch( codes[ n - 1 ] ) == true );
+
+		uint result;
+		int dest = GetDestinationRegister( code );
+		if( ( dest > 0 ) &&
+			( EvaluateConstant( code, known, values, &result ) == true ) )
+		{
+			info->ResultKnown = true;
+			info->Result = result;
+		}
+
+		if( ( info->ResultKnown == true ) &&
+			( nullableDelay == false ) )
+		{
+			known |= ( 1 << dest );
+			values[ dest ] = info->Result;
+		}
+		else
+			known = ( known & ~GetRegisterWrites( code ) ) | 0x1;
+	}
+
+	// Backward pass: liveness, for dead store elimination
+	// Everything is live when we leave the block, so branches (and their delay slots) reset the set
+	uint live = ALLREGISTERS;
+	for( int n = count - 1; n >= 0; n-- )
+	{
+		InstructionInfo* info = &infos[ n ];
+		uint code = codes[ n ];
+
+		if( ( IsBranchOrJump( code ) == true ) ||
+			( ( n > 0 ) && ( IsBranchOrJump( codes[ n - 1 ] ) == true ) ) )
+		{
+			live = ALLREGISTERS;
+			continue;
+		}
+
+		int dest = GetDestinationRegister( code );
+		if( ( dest > 0 ) &&
+			( ( live & ( 1 << dest ) ) == 0 ) &&
+			( R4000Generator::UsesRegisterCache( code ) == true ) )
+		{
+			// Nothing reads the result, and it has no other side effects
+			info->Dead = true;
+			continue;
+		}
+
+		live = ( live & ~GetRegisterWrites( code ) ) | GetRegisterReads( code );
+	}
+
+	_ctx->AnalysisValid = true;
+}
+
 #ifdef TRACESYMBOLS
 void __traceMethod( int methodAddress, int currentAddress )
 {
@@ -856,7 +1298,7 @@ void __traceMethod( int methodAddress, int currentAddress )
 }
 #endif
 
-void R4000AdvancedBlockBuilder::GeneratePreamble()
+void R4000AdvancedBlockBuilder::GeneratePreamble( CodeBlock* block, int cost )
 {
 	R4000Generator *g = _gen;
 
@@ -864,11 +1306,21 @@ void R4000AdvancedBlockBuilder::GeneratePreamble()
 	g->mov( MPCVALID( CTXP( _ctx->CtxPointer ) ), 0 );
 	g->mov( MNULLDELAY( CTXP( _ctx->CtxPointer ) ), 0 );
 
+#ifdef INSTRUCTIONBUDGET
+	// The whole (first run of the) block, even if a branch leaves early - it only has to be checked on the way out
+	g->sub( MBUDGET( CTXP( _ctx->CtxPointer ) ), ( uint )cost );
+#endif
+
 #ifdef STATISTICS
 	// Block count
 	g->add( g->dword_ptr[ &_codeBlocksExecuted ], 1 );
 #endif
 
+#ifdef CODECACHEEVICTION
+	// Linked jumps and predicted returns never go through the execution loop, so entries are counted here
+	g->add( g->dword_ptr[ &block->ExecutionCount ], 1 );
+#endif
+
 //#if 0
 #ifdef TRACESYMBOLS
 	// Trace entry to method
@@ -886,6 +1338,33 @@ void R4000AdvancedBlockBuilder::GeneratePreamble()
 #endif
 }
 
+#ifdef TIEREDCOMPILE
+// Called by quick blocks when they hit HOTBLOCKTHRESHOLD runs - the old code is still running when the block
+// gets rebuilt, but it stays in storage until the next eviction (which never happens under generated code)
+void __hotBlockThunk( CodeBlock* block )
+{
+	R4000Cpu::GlobalCpu->_builder->Recompile( block );
+}
+
+void R4000AdvancedBlockBuilder::EmitHotnessCheck( CodeBlock* block )
+{
+	R4000Generator *g = _gen;
+
+	Label* coldLabel = g->DefineLabel();
+
+	// Nothing is live yet, so the call can have whatever it wants - Recompile resets the count if it
+	// doesn't promote the block, so it is only asked again HOTBLOCKTHRESHOLD runs later
+	g->add( g->dword_ptr[ &block->TierUpCount ], 1 );
+	g->cmp( g->dword_ptr[ &block->TierUpCount ], HOTBLOCKTHRESHOLD );
+	g->jb( coldLabel );
+	g->Pointer();
+	g->push( ( uint )block );
+	g->call( ( uint )&__hotBlockThunk );
+	g->add( ESP, 4 );
+	g->MarkLabel( coldLabel );
+}
+#endif
+
 void __updateCorePC( int newPc )
 {
 	//R4000Cpu::GlobalCpu->_core0->PC = newPc;
@@ -893,6 +1372,65 @@ void __updateCorePC( int newPc )
 }
 
 // If tailJump == true, targetAddress must either be a valid address or -1 - -1 implies that EAX has the address to jump to
+#ifdef RETURNSTACK
+// Pops the top of the prediction stack in to ECX - only touches ECX/EDX
+void R4000AdvancedBlockBuilder::EmitReturnPop()
+{
+	R4000Generator *g = _gen;
+
+	g->mov( EDX, g->dword_ptr[ &_returnStackTop ] );
+	g->mov( ECX, g->dword_ptr[ EDX * 4 + ( int )_returnStack ] );
+	g->mov( g->dword_ptr[ EDX * 4 + ( int )_returnStack ], ( uint )0 );
+	g->sub( EDX, 1 );
+	g->and( EDX, RETURNSTACKSIZE - 1 );
+	g->mov( g->dword_ptr[ &_returnStackTop ], EDX );
+}
+
+// EAX = guest return address - jumps to missingLabel with EBX = EAX if the block doesn't exist
+void R4000AdvancedBlockBuilder::EmitReturnPrediction( Label* missingLabel )
+{
+	R4000Generator *g = _gen;
+
+	Label* noPrediction = g->DefineLabel();
+	Label* noPointer = g->DefineLabel();
+
+	// ECX = link
+	this->EmitReturnPop();
+
+	// Validate against the real return address
+	g->test( ECX, ECX );
+	g->jz( noPrediction );
+	g->cmp( EAX, g->dword_ptr[ ECX ] );
+	g->jne( noPrediction );
+
+	g->mov( EDX, g->dword_ptr[ ECX + 4 ] );
+	g->test( EDX, EDX );
+	g->jz( noPointer );
+
+#ifdef STATISTICS
+	g->add( g->dword_ptr[ &_returnPredictionHits ], 1 );
+#endif
+	g->jmp( EDX );
+
+	// Right link, but we haven't looked the block up yet - do it now and remember it
+	g->MarkLabel( noPointer );
+	g->push( ECX );
+	g->push( EAX );
+	g->call( ( uint )&QuickPointerLookup );
+	g->pop( EBX );
+	g->pop( ECX );
+	g->test( EAX, EAX );
+	g->jz( missingLabel );
+	g->mov( g->dword_ptr[ ECX + 4 ], EAX );
+	g->jmp( EAX );
+
+	g->MarkLabel( noPrediction );
+#ifdef STATISTICS
+	g->add( g->dword_ptr[ &_returnPredictionMisses ], 1 );
+#endif
+}
+#endif
+
 void R4000AdvancedBlockBuilder::GenerateTail( int address, bool tailJump, int targetAddress )
 {
 	R4000Generator *g = _gen;
@@ -900,6 +1438,12 @@ void R4000AdvancedBlockBuilder::GenerateTail( int address, bool tailJump, int ta
 	// NOTE: EAX has jump target address if tailJump==true && targetAddress==-1 - DO NOT OVERWRITE
 	// This is for the jr case
 
+	// Callers should have flushed already, but this only touches ESI/EDI/XMM so EAX is safe
+	_ctx->Registers->Flush();
+	_ctx->FpuRegisters->Flush();
+	// Immediate stores, so EAX is still safe - code after a branch exit keeps them pending
+	EmitVfpuPrefixStores( _ctx, true );
+
 	// 1 = pc updated, 0 = pc update needed
 	if( _ctx->UpdatePC == true )
 	{
@@ -908,7 +1452,7 @@ void R4000AdvancedBlockBuilder::GenerateTail( int address, bool tailJump, int ta
 	else
 	{
 		// PC was never touched (wow!) - need to update now ourselves
-		int instructionLength = 4 * ( _ctx->EndAddress - _ctx->StartAddress ) ;
+		int instructionLength = _ctx->EndAddress - _ctx->StartAddress;
 		g->mov( MPC( CTXP( _ctx->CtxPointer ) ), _ctx->StartAddress + instructionLength );
 		g->mov( MPCVALID( CTXP( _ctx->CtxPointer ) ), 1 );
 	}
@@ -925,12 +1469,39 @@ void R4000AdvancedBlockBuilder::GenerateTail( int address, bool tailJump, int ta
 
 	if( tailJump == true )
 	{
+#ifdef INSTRUCTIONBUDGET
+		// Out of time - go back to the execution loop instead of on to the next block
+		Label* inBudget = g->DefineLabel();
+		g->cmp( MBUDGET( CTXP( _ctx->CtxPointer ) ), 0 );
+		g->jge( inBudget );
+		if( targetAddress == -1 )
+		{
+			g->mov( MPC( CTXP( _ctx->CtxPointer ) ), EAX );
+#ifdef RETURNSTACK
+			// The JAL that got us here pushed, so the pop the prediction would have done still has to happen
+			if( _ctx->JumpRegister == 31 )
+				this->EmitReturnPop();
+#endif
+		}
+		else
+			g->mov( MPC( CTXP( _ctx->CtxPointer ) ), targetAddress );
+		g->xor( EAX, EAX );
+		g->ret();
+		g->MarkLabel( inBudget );
+#endif
+
 		if( targetAddress == -1 )
 		{
 			Label* nullPtrLabel = g->DefineLabel();
 
 			//g->int3();
 
+#ifdef RETURNSTACK
+			// Returns try the prediction stack first, and fall through to the normal lookup if it's wrong
+			if( _ctx->JumpRegister == 31 )
+				this->EmitReturnPrediction( nullPtrLabel );
+#endif
+
 			g->push( EAX );
 			g->call( ( uint )&QuickPointerLookup );
 			g->pop( EBX ); // get the argument (address) used, as it may be used below in EmitJumpBlockEbx
@@ -963,13 +1534,21 @@ void R4000AdvancedBlockBuilder::GenerateTail( int address, bool tailJump, int ta
 			this->EmitJumpBlockEbx();
 
 #ifdef STATISTICS
-			_jumpBlockLookupCount++;
+			// Tails are built on the background compiler's thread too
+			InterlockedIncrement( ( volatile LONG* )&_jumpBlockLookupCount );
 #endif
 		}
 		else
 		{
 			// Bounce out
+#ifdef BLOCKLINKS
+			// Always go through a jump block - they are the only kind of link the cache can undo
+			// when the target gets invalidated, and the thunk patches it on the first run anyway
+			// (this also keeps the background compiler from having to look in the cache)
+			CodeBlock* block = NULL;
+#else
 			CodeBlock* block = _codeCache->Find( targetAddress );
+#endif
 
 			// Note we have to check the case of us bouncing to ourselves - this is bad
 			// as at this point we don't have a pointer to ourselves, so we need to just write 0!
@@ -984,7 +1563,7 @@ void R4000AdvancedBlockBuilder::GenerateTail( int address, bool tailJump, int ta
 				this->EmitJumpBlock( targetAddress );
 
 #ifdef STATISTICS
-				_jumpBlockThunkCount++;
+				InterlockedIncrement( ( volatile LONG* )&_jumpBlockThunkCount );
 #endif
 			}
 			else
@@ -998,7 +1577,7 @@ void R4000AdvancedBlockBuilder::GenerateTail( int address, bool tailJump, int ta
 				g->jmp( ( int )block->Pointer );
 
 #ifdef STATISTICS
-				_jumpBlockInlineCount++;
+				InterlockedIncrement( ( volatile LONG* )&_jumpBlockInlineCount );
 #endif
 			}
 		}
@@ -1010,7 +1589,7 @@ void R4000AdvancedBlockBuilder::GenerateTail( int address, bool tailJump, int ta
 		g->ret();
 
 #ifdef STATISTICS
-		_codeBlockRetCount++;
+		InterlockedIncrement( ( volatile LONG* )&_codeBlockRetCount );
 #endif
 	}
 }
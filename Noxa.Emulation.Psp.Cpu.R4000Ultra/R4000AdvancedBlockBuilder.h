@@ -7,10 +7,12 @@
 #pragma once
 
 #include "R4000BlockBuilder.h"
+#include "Label.h"
 
 using namespace System;
 using namespace System::Collections::Generic;
 using namespace Noxa::Emulation::Psp;
+using namespace Noxa::Emulation::Psp::CodeGen;
 
 namespace Noxa {
 	namespace Emulation {
@@ -21,12 +23,31 @@ namespace Noxa {
 				{
 				protected:
 					virtual int InternalBuild( int startAddress, CodeBlock* block ) override;
+					// Returns -1 if the generator ran out of room
+					int InternalBuild( int startAddress, CodeBlock* block, int maxCodeLength );
 
-					void GeneratePreamble();
+					void GeneratePreamble( CodeBlock* block, int cost );
 					void GenerateTail( int address, bool tailJump, int targetAddress );
+					void EmitReturnPrediction( Label* missingLabel );
+					void EmitReturnPop();
+#ifdef TIEREDCOMPILE
+					void EmitHotnessCheck( CodeBlock* block );
+#endif
+
+					void AnalyzeBlock( int startAddress, int count );
+#ifdef SUPERBLOCKS
+					// Decides if the J (with its delay slot at address) can be followed, and starts a new run if so
+					bool FollowJump( int startAddress, int address, int count, int maxCodeLength );
+#endif
+#ifdef IDLELOOPS
+					// Decides if the backward branch at address just spins over a loop that waits on memory
+					bool IsIdleBranch( int address, int target );
+					bool IsIdleCall( int target );
+#endif
 
 				public:
 					R4000AdvancedBlockBuilder( R4000Cpu^ cpu, R4000Core^ core );
+					R4000AdvancedBlockBuilder( R4000Cpu^ cpu, R4000Core^ core, R4000GenContext^ context );
 					~R4000AdvancedBlockBuilder();
 				};
 
@@ -0,0 +1,382 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#include "StdAfx.h"
+#include "R4000Analysis.h"
+
+using namespace Noxa::Emulation::Psp;
+using namespace Noxa::Emulation::Psp::Cpu;
+
+#define OPCODE( code )		( ( code >> 26 ) & 0x3F )
+#define FUNCTION( code )	( code & 0x3F )
+#define RS( code )			( ( code >> 21 ) & 0x1F )
+#define RT( code )			( ( code >> 16 ) & 0x1F )
+#define RD( code )			( ( code >> 11 ) & 0x1F )
+#define SHAMT( code )		( ( code >> 6 ) & 0x1F )
+#define BIT( r )			( 1 << ( r ) )
+
+#pragma unmanaged
+
+uint Noxa::Emulation::Psp::Cpu::GetRegisterReads( uint code )
+{
+	uint rs = BIT( RS( code ) );
+	uint rt = BIT( RT( code ) );
+	uint rd = BIT( RD( code ) );
+
+	switch( OPCODE( code ) )
+	{
+	case 0:
+		switch( FUNCTION( code ) )
+		{
+		case 0: case 2: case 3:				// SLL, SRL, SRA
+			return rt;
+		case 4: case 6: case 7:				// SLLV, SRLV, SRAV
+			return rs | rt;
+		case 8: case 9:						// JR, JALR
+			return rs;
+		case 10: case 11:					// MOVZ, MOVN - rd is only conditionally written
+			return rs | rt | rd;
+		case 13: case 15:					// BREAK, SYNC
+		case 16: case 18:					// MFHI, MFLO
+			return 0;
+		case 17: case 19:					// MTHI, MTLO
+		case 22: case 23:					// CLZ, CLO
+			return rs;
+		case 24: case 25: case 26: case 27:	// MULT, MULTU, DIV, DIVU
+		case 28: case 29: case 46: case 47:	// MADD, MADDU, MSUB, MSUBU
+			return rs | rt;
+		}
+		if( ( FUNCTION( code ) >= 32 ) && ( FUNCTION( code ) <= 45 ) )
+			return rs | rt;
+		return ALLREGISTERS;				// SYSCALL and friends
+	case 1:									// REGIMM branches
+		return rs;
+	case 2: case 3:							// J, JAL
+		return 0;
+	case 4: case 5: case 20: case 21:		// BEQ, BNE, BEQL, BNEL
+		return rs | rt;
+	case 6: case 7: case 22: case 23:		// BLEZ, BGTZ, BLEZL, BGTZL
+		return rs;
+	case 8: case 9: case 10: case 11:		// ADDI, ADDIU, SLTI, SLTIU
+	case 12: case 13: case 14:				// ANDI, ORI, XORI
+		return rs;
+	case 15:								// LUI
+		return 0;
+	case 0x10: case 0x11: case 0x12:		// COPz
+		if( ( RS( code ) >= 4 ) && ( RS( code ) <= 7 ) )
+			return rt;						// MTCz/CTCz
+		return 0;
+	case 0x18: case 0x19: case 0x1A: case 0x1B:
+	case 0x34: case 0x37: case 0x3C: case 0x3F:
+		return 0;							// VFPU ops - no GPRs
+	case 0x1F:								// SPECIAL3
+		switch( FUNCTION( code ) )
+		{
+		case 0x0:							// EXT
+			return rs;
+		case 0x4:							// INS
+			return rs | rt;
+		case 0x20:							// BSHFL
+			return rt;
+		}
+		return ALLREGISTERS;
+	case 0x20: case 0x21: case 0x23:		// LB, LH, LW
+	case 0x24: case 0x25:					// LBU, LHU
+	case 0x2F: case 0x30:					// CACHE, LL
+	case 0x31: case 0x32: case 0x35: case 0x36:	// LWC1, LV.S, LVL/LVR.Q, LV.Q
+	case 0x39: case 0x3A: case 0x3D: case 0x3E:	// SWC1, SV.S, SVL/SVR.Q, SV.Q
+		return rs;
+	case 0x22: case 0x26:					// LWL, LWR - merge with the old rt
+	case 0x28: case 0x29: case 0x2A:		// SB, SH, SWL
+	case 0x2B: case 0x2E:					// SW, SWR
+	case 0x38:								// SC
+		return rs | rt;
+	}
+	return ALLREGISTERS;
+}
+
+uint Noxa::Emulation::Psp::Cpu::GetRegisterWrites( uint code )
+{
+	int dest = GetDestinationRegister( code );
+	if( dest >= 0 )
+		return BIT( dest );
+
+	switch( OPCODE( code ) )
+	{
+	case 0:
+		switch( FUNCTION( code ) )
+		{
+		case 8:								// JR
+		case 13: case 15:					// BREAK, SYNC
+		case 17: case 19:					// MTHI, MTLO
+		case 24: case 25: case 26: case 27:	// MULT, MULTU, DIV, DIVU
+		case 28: case 29: case 46: case 47:	// MADD, MADDU, MSUB, MSUBU
+			return 0;
+		case 9:								// JALR
+			return BIT( RD( code ) );
+		}
+		return ALLREGISTERS;				// SYSCALL can touch anything
+	case 1:
+		if( ( RT( code ) & 0x10 ) != 0 )	// BxxAL
+			return BIT( 31 );
+		return 0;
+	case 2:									// J
+		return 0;
+	case 3:									// JAL
+		return BIT( 31 );
+	case 4: case 5: case 6: case 7:
+	case 20: case 21: case 22: case 23:		// Branches
+		return 0;
+	case 0x10: case 0x11: case 0x12:		// COPz - moves from the cop are handled above
+		return 0;
+	case 0x18: case 0x19: case 0x1A: case 0x1B:
+	case 0x34: case 0x37: case 0x3C: case 0x3F:
+		return 0;							// VFPU ops
+	case 0x28: case 0x29: case 0x2A:
+	case 0x2B: case 0x2E: case 0x2F:		// Stores, CACHE
+	case 0x31: case 0x32: case 0x35: case 0x36:
+	case 0x39: case 0x3A: case 0x3D: case 0x3E:
+		return 0;							// COP loads/stores
+	}
+	return ALLREGISTERS;
+}
+
+int Noxa::Emulation::Psp::Cpu::GetDestinationRegister( uint code )
+{
+	switch( OPCODE( code ) )
+	{
+	case 0:
+		switch( FUNCTION( code ) )
+		{
+		case 0: case 2: case 3:				// SLL, SRL, SRA
+		case 4: case 6: case 7:				// SLLV, SRLV, SRAV
+		case 10: case 11:					// MOVZ, MOVN
+		case 16: case 18:					// MFHI, MFLO
+		case 22: case 23:					// CLZ, CLO
+			return RD( code );
+		}
+		if( ( FUNCTION( code ) >= 32 ) && ( FUNCTION( code ) <= 45 ) &&
+			( FUNCTION( code ) != 40 ) && ( FUNCTION( code ) != 41 ) )
+			return RD( code );
+		return -1;
+	case 8: case 9: case 10: case 11:
+	case 12: case 13: case 14: case 15:		// ALU immediates
+		return RT( code );
+	case 0x10: case 0x11: case 0x12:
+		if( RS( code ) <= 3 )				// MFCz/CFCz (MFV on the VFPU)
+			return RT( code );
+		return -1;
+	case 0x1F:
+		switch( FUNCTION( code ) )
+		{
+		case 0x0: case 0x4:					// EXT, INS
+			return RT( code );
+		case 0x20:							// BSHFL
+			return RD( code );
+		}
+		return -1;
+	case 0x20: case 0x21: case 0x22: case 0x23:
+	case 0x24: case 0x25: case 0x26:		// Loads
+	case 0x30: case 0x38:					// LL, SC
+		return RT( code );
+	}
+	return -1;
+}
+
+bool Noxa::Emulation::Psp::Cpu::IsBranchOrJump( uint code )
+{
+	switch( OPCODE( code ) )
+	{
+	case 0:
+		return ( FUNCTION( code ) == 8 ) || ( FUNCTION( code ) == 9 );
+	case 1: case 2: case 3:
+	case 4: case 5: case 6: case 7:
+	case 20: case 21: case 22: case 23:
+		return true;
+	case 0x10: case 0x11: case 0x12:
+		return ( RS( code ) == 0x08 );		// BCz
+	}
+	return false;
+}
+
+bool Noxa::Emulation::Psp::Cpu::IsLikelyBranch( uint code )
+{
+	switch( OPCODE( code ) )
+	{
+	case 1:
+		return ( RT( code ) & 0x2 ) != 0;
+	case 20: case 21: case 22: case 23:
+		return true;
+	case 0x10: case 0x11: case 0x12:
+		return ( RS( code ) == 0x08 ) && ( ( RT( code ) & 0x2 ) != 0 );
+	}
+	return false;
+}
+
+bool Noxa::Emulation::Psp::Cpu::GetStaticTarget( uint code, int address, int* target )
+{
+	switch( OPCODE( code ) )
+	{
+	case 0:								// JR, JALR
+		return false;
+	case 2: case 3:						// J, JAL
+		*target = ( ( address + 4 ) & 0xF0000000 ) | ( ( code & 0x03FFFFFF ) << 2 );
+		return true;
+	}
+	if( IsBranchOrJump( code ) == false )
+		return false;
+	*target = address + 4 + ( ( int )( short )( code & 0xFFFF ) << 2 );
+	return true;
+}
+
+bool Noxa::Emulation::Psp::Cpu::EvaluateConstant( uint code, uint known, const uint* values, uint* result )
+{
+	bool rsKnown = ( known & BIT( RS( code ) ) ) != 0;
+	bool rtKnown = ( known & BIT( RT( code ) ) ) != 0;
+	uint rs = values[ RS( code ) ];
+	uint rt = values[ RT( code ) ];
+	uint zimm = code & 0xFFFF;
+	uint simm = ( uint )( int )( short )( code & 0xFFFF );
+
+	switch( OPCODE( code ) )
+	{
+	case 0:
+		switch( FUNCTION( code ) )
+		{
+		case 0:
+			if( rtKnown == false ) return false;
+			*result = rt << SHAMT( code );
+			return true;
+		case 2:
+			if( rtKnown == false ) return false;
+			*result = rt >> SHAMT( code );
+			return true;
+		case 3:
+			if( rtKnown == false ) return false;
+			*result = ( uint )( ( int )rt >> SHAMT( code ) );
+			return true;
+		}
+		if( ( rsKnown == false ) || ( rtKnown == false ) )
+			return false;
+		switch( FUNCTION( code ) )
+		{
+		case 32: case 33:	*result = rs + rt;	return true;
+		case 34: case 35:	*result = rs - rt;	return true;
+		case 36:			*result = rs & rt;	return true;
+		case 37:			*result = rs | rt;	return true;
+		case 38:			*result = rs ^ rt;	return true;
+		case 39:			*result = ~( rs | rt );	return true;
+		case 42:			*result = ( ( int )rs < ( int )rt ) ? 1 : 0;	return true;
+		case 43:			*result = ( rs < rt ) ? 1 : 0;	return true;
+		}
+		return false;
+	case 15:				// LUI
+		*result = zimm << 16;
+		return true;
+	}
+
+	if( rsKnown == false )
+		return false;
+	switch( OPCODE( code ) )
+	{
+	case 8: case 9:			*result = rs + simm;	return true;
+	case 10:				*result = ( ( int )rs < ( int )simm ) ? 1 : 0;	return true;
+	case 11:				*result = ( rs < simm ) ? 1 : 0;	return true;
+	case 12:				*result = rs & zimm;	return true;
+	case 13:				*result = rs | zimm;	return true;
+	case 14:				*result = rs ^ zimm;	return true;
+	}
+	return false;
+}
+
+bool Noxa::Emulation::Psp::Cpu::IsIdleLoop( const uint* codes, int address, int count, uint calls )
+{
+	// Registers the loop changes - if one of them is read before it is written, an iteration can see what the last
+	// one left behind (a counter, say) and the loop is going somewhere on its own
+	uint writes = 0;
+	for( int n = 0; n < count; n++ )
+	{
+		if( ( calls & BIT( n ) ) != 0 )
+			writes |= BIT( 2 ) | BIT( 31 );
+		else
+			writes |= GetRegisterWrites( codes[ n ] );
+	}
+
+	uint written = BIT( 0 );
+	for( int n = 0; n < count; n++ )
+	{
+		uint code = codes[ n ];
+		if( ( calls & BIT( n ) ) != 0 )
+		{
+			written |= BIT( 31 );
+			continue;
+		}
+
+		int target;
+		switch( OPCODE( code ) )
+		{
+		case 0:
+			switch( FUNCTION( code ) )
+			{
+			case 0: case 2: case 3:				// SLL, SRL, SRA (and NOP)
+			case 4: case 6: case 7:				// SLLV, SRLV, SRAV
+			case 10: case 11:					// MOVZ, MOVN
+			case 32: case 33: case 34: case 35:	// ADD, ADDU, SUB, SUBU
+			case 36: case 37: case 38: case 39:	// AND, OR, XOR, NOR
+			case 42: case 43:					// SLT, SLTU
+				break;
+			default:
+				return false;
+			}
+			break;
+		case 1:
+			if( ( RT( code ) & 0x10 ) != 0 )	// BxxAL
+				return false;
+			// Fall through
+		case 4: case 5: case 6: case 7:
+		case 20: case 21: case 22: case 23:
+			// Anything but the loop branch has to leave the loop - skipping over part of it would break the
+			// read before write check
+			if( n != count - 2 )
+			{
+				GetStaticTarget( code, address + ( n << 2 ), &target );
+				if( ( target >= address ) &&
+					( target < address + ( count << 2 ) ) )
+					return false;
+			}
+			break;
+		case 8: case 9: case 10: case 11:
+		case 12: case 13: case 14: case 15:		// ALU immediates
+		case 0x20: case 0x21: case 0x22: case 0x23:
+		case 0x24: case 0x25: case 0x26:		// Loads
+			break;
+		case 0x1F:
+			switch( FUNCTION( code ) )
+			{
+			case 0x0: case 0x4: case 0x20:		// EXT, INS, BSHFL
+				break;
+			default:
+				return false;
+			}
+			break;
+		default:
+			return false;
+		}
+
+		if( ( GetRegisterReads( code ) & writes & ~written ) != 0 )
+			return false;
+		written |= GetRegisterWrites( code );
+
+		// A call's $v0 is there once its delay slot has run
+		if( ( n > 0 ) &&
+			( ( calls & BIT( n - 1 ) ) != 0 ) )
+			written |= BIT( 2 );
+	}
+
+	return true;
+}
+
+#pragma managed
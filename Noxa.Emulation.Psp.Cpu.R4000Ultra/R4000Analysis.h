@@ -0,0 +1,61 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+using namespace Noxa::Emulation::Psp;
+
+// Returned by the read/write set functions when we don't know what the instruction touches
+#define ALLREGISTERS		0xFFFFFFFF
+
+// Maximum number of instructions in a block that can be analyzed
+#define MAXANALYSISLENGTH	256
+
+namespace Noxa {
+	namespace Emulation {
+		namespace Psp {
+			namespace Cpu {
+
+				// What the analysis pass learned about a single instruction
+				typedef struct InstructionInfo_t
+				{
+					bool		Dead;			// Result is overwritten before anything reads it
+					bool		ResultKnown;	// Result can be computed at generation time
+					uint		Result;
+
+					bool		RsKnown;		// Value of rs before the instruction
+					uint		RsValue;
+					bool		RtKnown;		// Value of rt before the instruction
+					uint		RtValue;
+				} InstructionInfo;
+
+#pragma unmanaged
+				// GPR masks (bit n = $n) of the registers an instruction reads/writes
+				uint GetRegisterReads( uint code );
+				uint GetRegisterWrites( uint code );
+
+				// The single GPR written by a non-control instruction, or -1
+				int GetDestinationRegister( uint code );
+
+				bool IsBranchOrJump( uint code );
+				bool IsLikelyBranch( uint code );
+
+				// Target of a PC-relative branch or J/JAL at address - false for register jumps and non-branches
+				bool GetStaticTarget( uint code, int address, int* target );
+
+				// Computes the result of simple ALU ops when all of their inputs are in known (bit n set = values[ n ] is valid)
+				bool EvaluateConstant( uint code, uint known, const uint* values, uint* result );
+
+				// Checks if the loop in codes (from address, the target of the branch in codes[ count - 2 ]) can only do
+				// something different the next time around if memory changes - calls marks (bit n = codes[ n ]) the JALs
+				// to stubs that just return a value in $v0
+				bool IsIdleLoop( const uint* codes, int address, int count, uint calls );
+#pragma managed
+
+			}
+		}
+	}
+}
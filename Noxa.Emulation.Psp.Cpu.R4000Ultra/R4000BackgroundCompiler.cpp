@@ -0,0 +1,358 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#include "StdAfx.h"
+#pragma unmanaged
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#pragma managed
+#include "R4000BackgroundCompiler.h"
+#include "R4000AdvancedBlockBuilder.h"
+#include "R4000Analysis.h"
+#include "R4000Cpu.h"
+#include "R4000Core.h"
+#include "R4000Memory.h"
+#include "R4000GenContext.h"
+#include "R4000Generator.h"
+
+using namespace System::Diagnostics;
+using namespace Noxa::Emulation::Psp;
+using namespace Noxa::Emulation::Psp::CodeGen;
+using namespace Noxa::Emulation::Psp::Cpu;
+
+#define LOCK	Monitor::Enter( _syncRoot )
+#define UNLOCK	Monitor::Exit( _syncRoot )
+
+// The worker never places code in storage, so its generator only needs the minimum
+#define BACKGROUNDSTORAGESIZE	( 1024 * 64 )
+
+#ifdef STATISTICS
+extern uint _backgroundBlocksPublished;
+extern uint _backgroundBlocksDiscarded;
+#endif
+
+#pragma unmanaged
+
+volatile long Noxa::Emulation::Psp::Cpu::_backgroundPending = 0;
+
+uint BackgroundHash( const byte* data, int length )
+{
+	// FNV-1a
+	uint hash = 2166136261;
+	for( int n = 0; n < length; n++ )
+		hash = ( hash ^ data[ n ] ) * 16777619;
+	return hash;
+}
+
+#pragma managed
+
+R4000BackgroundCompiler::R4000BackgroundCompiler( R4000Cpu^ cpu )
+{
+	_cpu = cpu;
+	_codeCache = cpu->_codeCache;
+	_mainMemory = cpu->_memory->MainMemory;
+
+	// Everything the builder keeps between instructions lives in the context, so the worker gets its own
+	R4000Generator* gen = new R4000Generator( BACKGROUNDSTORAGESIZE );
+	R4000GenContext^ context = gcnew R4000GenContext( gen, cpu->_memory->NativeSystem );
+	context->FastMemory = cpu->_memory->FastMemoryBase;
+	_builder = gcnew R4000AdvancedBlockBuilder( cpu, cpu->_core0, context );
+
+	_running = false;
+	_syncRoot = gcnew Object();
+	_queue = gcnew Queue<int>( BACKGROUNDQUEUESIZE );
+	_queued = gcnew Dictionary<int, int>( BACKGROUNDQUEUESIZE );
+	_current = -1;
+	_finished = gcnew List<IntPtr>( BACKGROUNDQUEUESIZE );
+}
+
+R4000BackgroundCompiler::~R4000BackgroundCompiler()
+{
+	this->Stop();
+
+	delete _builder;
+	_builder = nullptr;
+}
+
+void R4000BackgroundCompiler::Start()
+{
+	Debug::Assert( _thread == nullptr );
+
+	_running = true;
+
+	_thread = gcnew Thread( gcnew ThreadStart( this, &R4000BackgroundCompiler::ThreadProc ) );
+	_thread->Name = "R4000 background compiler";
+	_thread->Priority = ThreadPriority::BelowNormal;
+	_thread->IsBackground = true;
+	_thread->Start();
+}
+
+void R4000BackgroundCompiler::Stop()
+{
+	if( _thread == nullptr )
+		return;
+
+	LOCK;
+	_running = false;
+	_queue->Clear();
+	_queued->Clear();
+	Monitor::PulseAll( _syncRoot );
+	UNLOCK;
+
+	// Whatever it is building is finished (and dropped) before it looks at _running again
+	_thread->Join();
+	_thread = nullptr;
+
+	for each( IntPtr ptr in _finished )
+		this->Discard( ( CompiledBlock* )ptr.ToPointer() );
+	_finished->Clear();
+	_backgroundPending = 0;
+}
+
+void R4000BackgroundCompiler::Enqueue( int address, int depth )
+{
+	address &= 0x3FFFFFFF;
+
+	// Only main memory is read by the builder, and a debugger changes what it would generate
+	if( ( address < MainMemoryBase ) ||
+		( address >= MainMemoryBound ) ||
+		( ( address & 0x3 ) != 0 ) )
+		return;
+	if( ( _cpu->_hook != nullptr ) ||
+		( _codeCache->Find( address ) != NULL ) )
+		return;
+
+	LOCK;
+	if( ( _running == true ) &&
+		( _current != address ) &&
+		( _queued->Count < BACKGROUNDQUEUESIZE ) &&
+		( _queued->ContainsKey( address ) == false ) )
+	{
+		_queue->Enqueue( address );
+		_queued->Add( address, depth );
+		Monitor::Pulse( _syncRoot );
+	}
+	UNLOCK;
+}
+
+void R4000BackgroundCompiler::QueueSuccessors( CodeBlock* block, int depth )
+{
+	depth++;
+	if( ( depth > BACKGROUNDDEPTH ) ||
+		( block->Address < MainMemoryBase ) ||
+		( block->Address >= MainMemoryBound ) ||
+		( block->InstructionCount == 0 ) )
+		return;
+
+	const uint* codes = ( const uint* )( _mainMemory + ( block->Address - MainMemoryBase ) );
+	for( int n = 0; n < block->InstructionCount; n++ )
+	{
+		int target;
+		if( GetStaticTarget( codes[ n ], block->Address + ( n << 2 ), &target ) == true )
+			this->Enqueue( target, depth );
+	}
+
+	// Unless it ended on a J or JR (+ delay slot) we could end up right after the block
+	bool fallsThrough = true;
+	if( block->InstructionCount >= 2 )
+	{
+		uint last = codes[ block->InstructionCount - 2 ];
+		uint opcode = last >> 26;
+		if( ( opcode == 2 ) ||
+			( ( opcode == 0 ) && ( ( last & 0x3F ) == 8 ) ) )
+			fallsThrough = false;
+	}
+	if( fallsThrough == true )
+		this->Enqueue( block->Address + ( block->InstructionCount << 2 ), depth );
+}
+
+CodeBlock* R4000BackgroundCompiler::Take( int address )
+{
+	LOCK;
+	_queued->Remove( address );
+	while( _current == address )
+		Monitor::Wait( _syncRoot );
+	UNLOCK;
+
+	if( _backgroundPending != 0 )
+		this->Publish();
+
+	return _codeCache->Find( address );
+}
+
+void R4000BackgroundCompiler::Publish()
+{
+	LOCK;
+	array<IntPtr>^ finished = _finished->ToArray();
+	_finished->Clear();
+	_backgroundPending = 0;
+	UNLOCK;
+
+	R4000Generator* gen = _cpu->_context->Generator;
+	for each( IntPtr ptr in finished )
+	{
+		CompiledBlock* compiled = ( CompiledBlock* )ptr.ToPointer();
+		if( this->IsStale( compiled ) == true )
+		{
+			this->Discard( compiled );
+			continue;
+		}
+
+		CodeBlock* block = _codeCache->Add( compiled->Address );
+
+		// Calls out were relative to where the worker put the code, pointers in to it were absolute, and
+		// pointers in to the block were left as offsets
+		byte* code = ( byte* )gen->CopyCode( compiled->Code, compiled->Size );
+		int delta = ( int )( code - compiled->Code );
+		for( int n = 0; n < compiled->RelocationCount; n++ )
+		{
+			int* field = ( int* )( code + compiled->Relocations[ n ].Offset );
+			if( compiled->Relocations[ n ].Type == RelocCall )
+				*field -= delta;
+			else if( compiled->Relocations[ n ].Type == RelocAbsolute )
+				*field += ( int )block;
+			else
+				*field += delta;
+		}
+
+		block->Size = compiled->Size;
+		block->InstructionCount = compiled->InstructionCount;
+		block->EndsOnSyscall = compiled->EndsOnSyscall;
+#ifdef TIEREDCOMPILE
+		block->Tier = 1;
+#endif
+#ifdef DEBUGGING
+		block->InstructionSizes = compiled->InstructionSizes;
+		block->PreambleSize = compiled->PreambleSize;
+#endif
+		_codeCache->UpdatePointer( block, code );
+
+		this->QueueSuccessors( block, compiled->Depth );
+
+		SAFEFREE( compiled->Code );
+		free( compiled );
+
+#ifdef STATISTICS
+		_backgroundBlocksPublished++;
+#endif
+	}
+}
+
+bool R4000BackgroundCompiler::IsStale( CompiledBlock* compiled )
+{
+	// Return links it took may have been handed out again, and the debugger needs its own code
+	if( ( compiled->CacheVersion != _codeCache->Version ) ||
+		( _cpu->_hook != nullptr ) )
+		return true;
+
+	// The emulation thread got there first
+	if( _codeCache->Find( compiled->Address ) != NULL )
+		return true;
+
+	const byte* guestCode = _mainMemory + ( compiled->Address - MainMemoryBase );
+	int length = min( ( compiled->InstructionCount + 1 ) << 2, MainMemoryBound - compiled->Address );
+	return ( BackgroundHash( guestCode, length ) != compiled->CodeHash );
+}
+
+void R4000BackgroundCompiler::Discard( CompiledBlock* compiled )
+{
+	SAFEFREE( compiled->Code );
+#ifdef DEBUGGING
+	SAFEFREE( compiled->InstructionSizes );
+#endif
+	free( compiled );
+
+#ifdef STATISTICS
+	// Called from both threads
+	InterlockedIncrement( ( volatile LONG* )&_backgroundBlocksDiscarded );
+#endif
+}
+
+CompiledBlock* R4000BackgroundCompiler::Compile( int address, int depth )
+{
+	// If the emulation thread writes to the code while we are reading it we can't trust what we built
+	const byte* guestCode = _mainMemory + ( address - MainMemoryBase );
+	int span = min( MAXBLOCKSPAN, MainMemoryBound - address );
+	uint before = BackgroundHash( guestCode, span );
+	int version = _codeCache->Version;
+
+	CompiledBlock* compiled;
+	try
+	{
+		compiled = _builder->BuildDetached( address );
+	}
+	catch( Exception^ ex )
+	{
+		// The emulation thread will build it itself (and hit the same problem) when it gets there
+		Log::WriteLine( Verbosity::Normal, Feature::Cpu, "R4000BackgroundCompiler: failed to build 0x{0:X8}: {1}", address, ex->Message );
+		_builder->_gen->RecordRelocations( false );
+		_builder->_gen->Reset();
+		return NULL;
+	}
+
+	if( BackgroundHash( guestCode, span ) != before )
+	{
+		this->Discard( compiled );
+		return NULL;
+	}
+
+	compiled->Depth = depth;
+	compiled->CacheVersion = version;
+	int length = min( ( compiled->InstructionCount + 1 ) << 2, MainMemoryBound - address );
+	compiled->CodeHash = BackgroundHash( guestCode, length );
+
+	return compiled;
+}
+
+void R4000BackgroundCompiler::ThreadProc()
+{
+	while( true )
+	{
+		int address = 0;
+		int depth = 0;
+
+		LOCK;
+		while( _running == true )
+		{
+			// Addresses the emulation thread took are still in _queue, but not in _queued
+			if( _queue->Count == 0 )
+				Monitor::Wait( _syncRoot );
+			else
+			{
+				address = _queue->Dequeue();
+				if( _queued->TryGetValue( address, depth ) == true )
+				{
+					_queued->Remove( address );
+					break;
+				}
+			}
+		}
+		if( _running == false )
+		{
+			UNLOCK;
+			return;
+		}
+		_current = address;
+		UNLOCK;
+
+		CompiledBlock* compiled = this->Compile( address, depth );
+
+		LOCK;
+		if( compiled != NULL )
+		{
+			if( _running == true )
+			{
+				_finished->Add( IntPtr( compiled ) );
+				InterlockedIncrement( &_backgroundPending );
+			}
+			else
+				this->Discard( compiled );
+		}
+		_current = -1;
+		Monitor::PulseAll( _syncRoot );
+		UNLOCK;
+	}
+}
@@ -0,0 +1,105 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "R4000Cache.h"
+#include "Label.h"
+
+using namespace System;
+using namespace System::Collections::Generic;
+using namespace System::Threading;
+using namespace Noxa::Emulation::Psp;
+using namespace Noxa::Emulation::Psp::CodeGen;
+
+namespace Noxa {
+	namespace Emulation {
+		namespace Psp {
+			namespace Cpu {
+
+				ref class R4000Cpu;
+				ref class R4000BlockBuilder;
+
+				// A block built by the background compiler that hasn't been placed in to code storage yet
+				typedef struct CompiledBlock_t
+				{
+					int			Address;
+					int			Size;
+					int			InstructionCount;
+					bool		EndsOnSyscall;
+
+					int			Depth;				// # of branches away from a block the emulation thread asked for
+					int			CacheVersion;		// R4000Cache::Version when the build started
+					uint		CodeHash;			// Hash of the guest code it was built from
+
+					byte*		Code;				// malloc'ed, fixed up to run where it is
+#ifdef DEBUGGING
+					ushort*		InstructionSizes;
+					byte		PreambleSize;
+#endif
+					int			RelocationCount;
+					Relocation*	Relocations;		// RelocCall/RelocCode fields, and RelocAbsolute ones holding an offset in to the CodeBlock
+				} CompiledBlock;
+
+#pragma unmanaged
+				// # of finished blocks waiting to be published - the execution loop checks this without locking
+				extern volatile long _backgroundPending;
+#pragma managed
+
+				/* Compiles blocks ahead of the emulation thread. Every block the emulation thread builds queues
+				   its static successors (branch/jump targets and the fall-through), and each of those queues its
+				   own up to BACKGROUNDDEPTH branches away. The worker has its own generator and context and never
+				   touches the cache or code storage - finished blocks sit in a private buffer until Publish is
+				   called at a safe point on the emulation thread, which copies them in to storage and adds them.
+				   Anything that went stale in the meantime (cache cleared, guest code changed, debugger attached)
+				   is thrown away.
+				*/
+				ref class R4000BackgroundCompiler
+				{
+				protected:
+					R4000Cpu^				_cpu;
+					R4000Cache*				_codeCache;
+					R4000BlockBuilder^		_builder;
+					byte*					_mainMemory;
+
+					Thread^					_thread;
+					bool					_running;
+
+					Object^					_syncRoot;
+					Queue<int>^				_queue;
+					Dictionary<int, int>^	_queued;		// Address -> depth of everything waiting in _queue
+					int						_current;		// Address being built, or -1
+					List<IntPtr>^			_finished;		// CompiledBlock*s waiting to be published
+
+					void ThreadProc();
+					CompiledBlock* Compile( int address, int depth );
+					bool IsStale( CompiledBlock* compiled );
+					void Discard( CompiledBlock* compiled );
+
+				public:
+					R4000BackgroundCompiler( R4000Cpu^ cpu );
+					~R4000BackgroundCompiler();
+
+					void Start();
+					void Stop();
+
+					// Asks for the block at address to be built - ignored if it is cached, already queued, or
+					// not in main memory
+					void Enqueue( int address, int depth );
+					void QueueSuccessors( CodeBlock* block, int depth );
+
+					// Called by the builder before it builds address itself - waits if the worker is in the
+					// middle of it, and returns the block if the worker has it
+					CodeBlock* Take( int address );
+
+					// Moves all finished blocks in to the cache - emulation thread only
+					void Publish();
+				};
+
+			}
+		}
+	}
+}
@@ -11,6 +11,7 @@
 #include "R4000Cpu.h"
 #include "R4000BiosStubs.h"
 #include "R4000Generator.h"
+#include "R4000Cache.h"
 
 using namespace System;
 using namespace Noxa::Emulation::Psp::Bios;
@@ -55,9 +56,11 @@ extern int sceGeListSync( int qid, int syncType );
 extern int sceGeDrawSync( int syncType );
 
 // sceUtilsForUser -------------------------------------
-// All D(ata) and I(nstruction) cache inval calls are nop'ed
+// All D(ata) cache inval calls are nop'ed
 // Perhaps we should be smarter and pass invals to the video plugin if they
 // are in the FB range?
+// I(nstruction) cache invals drop the blocks in the range when SMCDETECTION is on
+void sceKernelIcacheInvalidateRange( int address, int size );	// <-- managed
 
 #pragma managed
 
@@ -86,6 +89,7 @@ bool R4000BiosStubs::EmitCall( R4000GenContext^ context, R4000Generator *g, int
 		g->mov( EAX, MREG( CTX, 4 ) );
 		g->and( EAX, 0x3FFFFFFF );
 		g->sub( EAX, MainMemoryBase );
+		g->Pointer();
 		g->add( EAX, ( int )context->MainMemory );
 		g->push( EAX );
 		g->call( ( uint )&sceRtcGetCurrentTick );
@@ -130,11 +134,25 @@ bool R4000BiosStubs::EmitCall( R4000GenContext^ context, R4000Generator *g, int
 	case 0x34b9fa9e:		// sceKernelDcacheWritebackInvalidateRange
 		g->xor( EAX, EAX );
 		return true;
+#ifdef SMCDETECTION
+	case 0x920f104a:		// sceKernelIcacheInvalidateAll
+		// Stores already drop any code they hit, so there is nothing left to do
+		g->xor( EAX, EAX );
+		return true;
+	case 0xc2df770e:		// sceKernelIcacheInvalidateRange
+		g->push( MREG( CTX, 5 ) );
+		g->push( MREG( CTX, 4 ) );
+		g->call( ( uint )&sceKernelIcacheInvalidateRange );
+		g->add( ESP, 8 );
+		g->xor( EAX, EAX );
+		return true;
+#else
 	case 0x920f104a:		// sceKernelIcacheInvalidateAll
 	case 0xc2df770e:		// sceKernelIcacheInvalidateRange
 		g->int3();
 		g->xor( EAX, EAX );
 		return true;
+#endif
 
 	// sceDisplay ------------------------------------------
 	case 0x773DD3A3:		// sceDisplayGetCurrentHcount
@@ -299,3 +317,12 @@ int scePowerSetCpuClockFrequency( int cpuFreq )
 }
 
 #pragma managed
+
+// sceUtilsForUser -------------------------------------
+
+void sceKernelIcacheInvalidateRange( int address, int size )
+{
+#ifdef SMCDETECTION
+	R4000Cpu::GlobalCpu->_codeCache->InvalidateRange( address, size );
+#endif
+}
@@ -15,6 +15,8 @@
 #include "R4000GenContext.h"
 #include "R4000Cache.h"
 #include "R4000Generator.h"
+#include "R4000PersistentCache.h"
+#include "R4000BackgroundCompiler.h"
 
 using namespace System::Diagnostics;
 using namespace System::Runtime::InteropServices;
@@ -28,6 +30,7 @@ extern uint _codeBlocksGenerated;
 extern uint _jumpBlockThunkCalls;
 extern uint _jumpBlockThunkBuilds;
 extern uint _jumpBlockThunkHits;
+extern uint _hotBlocksRecompiled;
 
 void __fixupBlockJump( void* sourceAddress, int newTarget );
 void __missingBlockThunk( void* targetAddress, byte needFixup, void* stackPointer );
@@ -52,6 +55,22 @@ R4000BlockBuilder::R4000BlockBuilder( R4000Cpu^ cpu, R4000Core^ core )
 
 	// LOL confusing
 	_ctx->CtxPointer = ( void* )_cpu->_ctx;
+
+	_detached = false;
+}
+
+R4000BlockBuilder::R4000BlockBuilder( R4000Cpu^ cpu, R4000Core^ core, R4000GenContext^ context )
+{
+	_cpu = cpu;
+	_core = core;
+	_memory = ( R4000Memory^ )_cpu->Memory;
+	_codeCache = _cpu->CodeCache;
+
+	_gen = context->Generator;
+	_ctx = context;
+	_ctx->CtxPointer = ( void* )_cpu->_ctx;
+
+	_detached = true;
 }
 
 R4000BlockBuilder::~R4000BlockBuilder()
@@ -202,6 +221,17 @@ CodeBlock* R4000BlockBuilder::Build( int address )
 
 	address &= 0x3FFFFFFF;
 
+#ifdef BACKGROUNDCOMPILE
+	// The background compiler may have it (or be working on it) already
+	R4000BackgroundCompiler^ compiler = _cpu->_compiler;
+	if( compiler != nullptr )
+	{
+		CodeBlock* compiled = compiler->Take( address );
+		if( compiled != NULL )
+			return compiled;
+	}
+#endif
+
 	// Don't try to re-add blocks
 	Debug::Assert( _codeCache->Find( address ) == NULL );
 
@@ -215,8 +245,35 @@ CodeBlock* R4000BlockBuilder::Build( int address )
 	_gen->annotate( "Block @ [%#08X]: ----------------------------------------------------------", address );
 #endif
 
+#ifdef PERSISTENTCACHE
+	PersistentCache* persistentCache = _cpu->_persistentCache;
+	const byte* guestCode = this->GetPersistentCode( address );
+	if( ( guestCode != NULL ) &&
+		( PersistentCacheLoad( persistentCache, _gen, _codeCache, block, guestCode ) == true ) )
+	{
+#ifdef TIEREDCOMPILE
+		// Only optimized code is ever saved
+		block->Tier = 1;
+#endif
+		return block;
+	}
+#ifdef TIEREDCOMPILE
+	// Quick builds only last until Recompile replaces them - it saves the optimized one
+	guestCode = NULL;
+#endif
+	_gen->RecordRelocations( guestCode != NULL );
+#endif
+
 	InternalBuild( address, block );
 
+#ifdef PERSISTENTCACHE
+	// Syscalls go through shims built at startup, so those blocks are always rebuilt
+	if( ( guestCode != NULL ) &&
+		( _ctx->UseSyscalls == false ) )
+		PersistentCacheStore( persistentCache, _gen, block, guestCode );
+	_gen->RecordRelocations( false );
+#endif
+
 #ifdef _DEBUG
 	// Listing
 	//const char *listing = _gen->getListing();
@@ -244,9 +301,128 @@ CodeBlock* R4000BlockBuilder::Build( int address )
 	//Debug::WriteLine( String::Format( "gen block at 0x{0:X8} took {1}s ({2} instructions)", address, genTime, block->InstructionCount ) );
 #endif
 
+#ifdef BACKGROUNDCOMPILE
+	if( compiler != nullptr )
+		compiler->QueueSuccessors( block, 0 );
+#endif
+
 	return block;
 }
 
+#ifdef PERSISTENTCACHE
+// Only plain main memory code is saved - hooks and breakpoints change what gets generated
+const byte* R4000BlockBuilder::GetPersistentCode( int address )
+{
+#ifndef DEBUGGING
+	if( ( _cpu->_persistentCache != NULL ) &&
+		( _cpu->_hook == nullptr ) &&
+		( address >= MainMemoryBase ) &&
+		( address < MainMemoryBound ) )
+		return _memory->MainMemory + ( address - MainMemoryBase );
+#endif
+	return NULL;
+}
+#endif
+
+#ifdef TIEREDCOMPILE
+void R4000BlockBuilder::Recompile( CodeBlock* block )
+{
+	block->TierUpCount = 0;
+
+	// Dropped since it was entered, or the debugger attached - it would come out the same anyway
+	if( ( block->Pointer == NULL ) ||
+		( block->Tier != 0 ) ||
+		( _cpu->_hook != nullptr ) )
+		return;
+
+	// Anything patched to jump to the quick code has to look the block up again
+	_codeCache->Unlink( block );
+
+#ifdef DEBUGGING
+	SAFEFREE( block->InstructionSizes );
+#endif
+	block->Tier = 1;
+
+#ifdef PERSISTENTCACHE
+	PersistentCache* persistentCache = _cpu->_persistentCache;
+	const byte* guestCode = this->GetPersistentCode( block->Address );
+	_gen->RecordRelocations( guestCode != NULL );
+#endif
+
+	// A trace can cover more than the quick build did - InternalBuild moves the pages it covers along with it
+	InternalBuild( block->Address, block );
+
+#ifdef PERSISTENTCACHE
+	if( ( guestCode != NULL ) &&
+		( _ctx->UseSyscalls == false ) )
+		PersistentCacheStore( persistentCache, _gen, block, guestCode );
+	_gen->RecordRelocations( false );
+#endif
+
+	_gen->Reset();
+
+#ifdef STATISTICS
+	_hotBlocksRecompiled++;
+#endif
+}
+#endif
+
+#ifdef BACKGROUNDCOMPILE
+CompiledBlock* R4000BlockBuilder::BuildDetached( int address )
+{
+	Debug::Assert( _detached == true );
+
+	address &= 0x3FFFFFFF;
+
+	// Nothing else sees this block - InternalBuild just needs somewhere to put the results
+	CodeBlock block;
+	memset( &block, 0, sizeof( CodeBlock ) );
+	block.Address = address;
+#ifdef TIEREDCOMPILE
+	// It costs the emulation thread nothing, so it may as well be the good code
+	block.Tier = 1;
+#endif
+
+	_gen->RecordRelocations( true );
+	InternalBuild( address, &block );
+	_gen->RecordRelocations( false );
+
+	// Absolute fields stay valid wherever the code goes, so only calls out, pointers in to the code, and
+	// pointers in to the stand-in block (left relative to it) are kept
+	const Relocation* relocations = _gen->GetRelocations();
+	byte* code = ( byte* )block.Pointer;
+
+	CompiledBlock* compiled = ( CompiledBlock* )malloc( sizeof( CompiledBlock ) + sizeof( Relocation ) * _gen->GetRelocationCount() );
+	compiled->Address = address;
+	compiled->Size = block.Size;
+	compiled->InstructionCount = block.InstructionCount;
+	compiled->EndsOnSyscall = block.EndsOnSyscall;
+	compiled->Code = code;
+#ifdef DEBUGGING
+	compiled->InstructionSizes = block.InstructionSizes;
+	compiled->PreambleSize = block.PreambleSize;
+#endif
+	compiled->RelocationCount = 0;
+	compiled->Relocations = ( Relocation* )( compiled + 1 );
+	for( int n = 0; n < _gen->GetRelocationCount(); n++ )
+	{
+		uint* field = ( uint* )( code + relocations[ n ].Offset );
+		if( relocations[ n ].Type == RelocAbsolute )
+		{
+			if( ( *field < ( uint )&block ) ||
+				( *field >= ( uint )( &block + 1 ) ) )
+				continue;
+			*field -= ( uint )&block;
+		}
+		compiled->Relocations[ compiled->RelocationCount++ ] = relocations[ n ];
+	}
+
+	_gen->Reset();
+
+	return compiled;
+}
+#endif
+
 // The bounce function takes an integer address, sets up the stack, and jumps there.
 // It then cleans things up when done.
 void* R4000BlockBuilder::BuildBounce()
@@ -278,6 +454,9 @@ void* R4000BlockBuilder::BuildBounce()
 	FunctionPointer ptr = _gen->GenerateCode();
 	_gen->Reset();
 
+	// Lives as long as we do
+	_gen->PinStorage( ( void* )ptr );
+
 	return ptr;
 }
 
@@ -331,7 +510,7 @@ void R4000BlockBuilder::EmitJumpBlock( int targetAddress )
 	_gen->db( 0x54 );											// PUSH ESP
 	_gen->db( 0x6A ); _gen->db( 1 );							// PUSH 1 (fixup)
 	_gen->db( 0x68 ); _gen->dd( targetAddress );				// PUSH targetAddress
-	_gen->db( 0xB8 ); _gen->dd( ( int )__missingBlockThunk );	// MOV EAX, &__missingBlockThunk
+	_gen->db( 0xB8 ); _gen->Pointer(); _gen->dd( ( int )__missingBlockThunk );	// MOV EAX, &__missingBlockThunk
 	_gen->db( 0xFF ); _gen->db( 0xD0 );							// CALL EAX
 }
 
@@ -341,7 +520,7 @@ void R4000BlockBuilder::EmitJumpBlockEbx()
 	_gen->db( 0x54 );											// PUSH ESP
 	_gen->db( 0x6A ); _gen->db( 0 );							// PUSH 0 (no fixup)
 	_gen->db( 0x53 );											// PUSH EBX
-	_gen->db( 0xB8 ); _gen->dd( ( int )__missingBlockThunk );	// MOV EAX, &__missingBlockThunk
+	_gen->db( 0xB8 ); _gen->Pointer(); _gen->dd( ( int )__missingBlockThunk );	// MOV EAX, &__missingBlockThunk
 	_gen->db( 0xFF ); _gen->db( 0xD0 );							// CALL EAX
 }
 
@@ -372,6 +551,18 @@ void __fixupBlockJump( void* sourceAddress, void* newTarget )
 	*startPtr = 0xE0; // ModRM = source EAX
 	//startPtr++;
 }
+
+// Undoes __fixupBlockJump by writing the original jump block back - the next time it runs it will go
+// through the thunk and look up (or build) the target again
+void __unfixupBlockJump( void* jumpBlock, int targetAddress )
+{
+	byte* ptr = ( byte* )jumpBlock;
+	*ptr++ = 0x54;												// PUSH ESP
+	*ptr++ = 0x6A; *ptr++ = 1;									// PUSH 1 (fixup)
+	*ptr++ = 0x68; *( int* )ptr = targetAddress; ptr += 4;		// PUSH targetAddress
+	*ptr++ = 0xB8; *( int* )ptr = ( int )__missingBlockThunk; ptr += 4;	// MOV EAX, &__missingBlockThunk
+	*ptr++ = 0xFF; *ptr++ = 0xD0;								// CALL EAX
+}
 #pragma managed
 
 // This method is called by generated code when the target block is not found.
@@ -455,7 +646,13 @@ void __missingBlockThunk( void* targetAddress, byte needFixup, void* stackPointe
 
 	// Fixup to target
 	if( needFixup == 1 )
-		__fixupBlockJump( sourceAddress, jumpTarget );
+	{
+#ifdef BLOCKLINKS
+		// If we can't track it we can't undo it, so leave it going through the thunk
+		if( AddBlockLink( ( byte* )sourceAddress - THUNKJUMPSIZE, ( int )targetAddress ) == true )
+#endif
+			__fixupBlockJump( sourceAddress, jumpTarget );
+	}
 
 	// We cannot do RET, so need to do jump, but must fix up stack pointer first
 	__asm
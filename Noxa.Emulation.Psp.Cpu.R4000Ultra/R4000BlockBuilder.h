@@ -22,6 +22,7 @@ namespace Noxa {
 				ref class R4000Memory;
 				ref class R4000GenContext;
 				class R4000Generator;
+				typedef struct CompiledBlock_t CompiledBlock;
 
 				ref class R4000BlockBuilder abstract
 				{
@@ -34,17 +35,33 @@ namespace Noxa {
 					R4000GenContext^	_ctx;
 					R4000Generator*		_gen;
 
+					// Set on builders that run off of the emulation thread (with their own context) - they
+					// never touch the cache or code storage, see BuildDetached
+					bool				_detached;
+
 				protected:
 					virtual int InternalBuild( int startAddress, CodeBlock* block ) = 0;
 
+#ifdef PERSISTENTCACHE
+					const byte* GetPersistentCode( int address );
+#endif
+
 				public:
 					R4000BlockBuilder( R4000Cpu^ cpu, R4000Core^ core );
+					R4000BlockBuilder( R4000Cpu^ cpu, R4000Core^ core, R4000GenContext^ context );
 					~R4000BlockBuilder();
 
 					void EmitTrace( int address, int code );
 					void EmitDebug( int address, int code, char* codeString );
 
 					CodeBlock* Build( int address );
+#ifdef BACKGROUNDCOMPILE
+					CompiledBlock* BuildDetached( int address );
+#endif
+#ifdef TIEREDCOMPILE
+					// Rebuilds a quick block in place with all of the optimizations on
+					void Recompile( CodeBlock* block );
+#endif
 					void* BuildBounce();
 
 					void EmitJumpBlock( int targetAddress );
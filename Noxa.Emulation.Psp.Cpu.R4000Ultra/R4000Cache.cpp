@@ -5,6 +5,10 @@
 // ----------------------------------------------------------------------------
 
 #include "StdAfx.h"
+#pragma unmanaged
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#pragma managed
 #include <string>
 #include "R4000Cache.h"
 
@@ -40,10 +44,49 @@ using namespace Noxa::Emulation::Psp::Cpu;
 
 static int*** CCLookupTable;
 
+#ifdef FLATCODELOOKUP
+// One pointer per instruction in main memory - only reserved up front, and each page is committed
+// the first time a block in it is added
+#define FLATLOOKUPSIZE		( 0x02000000 >> 2 )
+#define FLATLOOKUPINDEX( address )	( ( ( ( uint )( address ) & 0x0FFFFFFF ) - MainMemoryBase ) >> 2 )
+// Entries per 4KB page of the table
+#define FLATLOOKUPPAGESHIFT	10
+#define FLATLOOKUPPAGECOUNT	( FLATLOOKUPSIZE >> FLATLOOKUPPAGESHIFT )
+
+static void** CCFlatTable;
+// Non-zero if the page of CCFlatTable has been committed - pages that haven't can't have anything in them
+static byte CCFlatCommitted[ FLATLOOKUPPAGECOUNT ];
+#endif
+
+#ifdef SMCDETECTION
+ushort Noxa::Emulation::Psp::Cpu::_codePages[ CODEPAGECOUNT ];
+#endif
+
+#ifdef BLOCKLINKS
+static BlockLink* CCBlockLinks;
+static int CCBlockLinkCount;
+
+// R4000BlockBuilder.cpp
+void __unfixupBlockJump( void* jumpBlock, int targetAddress );
+#endif
+
+#define RETURNLINKHASH( address )	( ( ( ( uint )( address ) >> 2 ) * 2654435761u ) >> ( 32 - RETURNLINKINDEXBITS ) )
+
+// Return address prediction stack - the top is _returnStack[ _returnStackTop ]
+ReturnLink* _returnStack[ RETURNSTACKSIZE ];
+int _returnStackTop;
+
 #pragma unmanaged
 
 void* Noxa::Emulation::Psp::Cpu::QuickPointerLookup( int address )
 {
+#ifdef FLATCODELOOKUP
+	// Anything outside of main memory wraps to a huge index and goes to the tiered table
+	uint index = FLATLOOKUPINDEX( address );
+	if( index < FLATLOOKUPSIZE )
+		return ( CCFlatCommitted[ index >> FLATLOOKUPPAGESHIFT ] != 0 ) ? CCFlatTable[ index ] : NULL;
+#endif
+
 	uint addr = ( address & 0x0FFFFFFF ) >> 2;
 
 	uint b0 = addr >> 20;
@@ -62,12 +105,36 @@ void* Noxa::Emulation::Psp::Cpu::QuickPointerLookup( int address )
 	return ( void* )ret;
 }
 
+#ifdef BLOCKLINKS
+bool Noxa::Emulation::Psp::Cpu::AddBlockLink( void* jumpBlock, int targetAddress )
+{
+	if( CCBlockLinkCount >= BLOCKLINKCOUNT )
+		return false;
+	BlockLink* link = &CCBlockLinks[ CCBlockLinkCount++ ];
+	link->Target = targetAddress;
+	link->JumpBlock = ( byte* )jumpBlock;
+	return true;
+}
+#endif
+
 #pragma managed
 
 R4000Cache::R4000Cache()
 {
 	_lookup = NULL;
 	_ptrLookup = NULL;
+	_returnLinks = ( ReturnLink* )calloc( RETURNLINKCOUNT, sizeof( ReturnLink ) );
+	_returnLinkCount = 0;
+	_returnLinkIndex = ( volatile LONG* )calloc( RETURNLINKINDEXSIZE, sizeof( LONG ) );
+#ifdef FLATCODELOOKUP
+	CCFlatTable = ( void** )VirtualAlloc( NULL, FLATLOOKUPSIZE * sizeof( void* ), MEM_RESERVE, PAGE_READWRITE );
+	Debug::Assert( CCFlatTable != NULL );
+	memset( CCFlatCommitted, 0, sizeof( CCFlatCommitted ) );
+#endif
+#ifdef BLOCKLINKS
+	CCBlockLinks = ( BlockLink* )calloc( BLOCKLINKCOUNT, sizeof( BlockLink ) );
+	CCBlockLinkCount = 0;
+#endif
 	Version = 0;
 	this->Clear( true );
 }
@@ -75,6 +142,63 @@ R4000Cache::R4000Cache()
 R4000Cache::~R4000Cache()
 {
 	this->Clear( false );
+	SAFEFREE( _returnLinks );
+	SAFEFREE( _returnLinkIndex );
+#ifdef FLATCODELOOKUP
+	if( CCFlatTable != NULL )
+		VirtualFree( CCFlatTable, 0, MEM_RELEASE );
+	CCFlatTable = NULL;
+#endif
+#ifdef BLOCKLINKS
+	SAFEFREE( CCBlockLinks );
+#endif
+}
+
+ReturnLink* R4000Cache::AddReturnLink( int address )
+{
+	// Every call site with the same return address shares a link, so rebuilding, recompiling or
+	// evicting code doesn't use them up
+	uint slot = RETURNLINKHASH( address );
+	for( int probe = 0; probe < RETURNLINKINDEXSIZE; probe++ )
+	{
+		int entry = _returnLinkIndex[ slot ];
+		if( entry == 0 )
+			break;
+		if( _returnLinks[ entry - 1 ].Address == address )
+			return &_returnLinks[ entry - 1 ];
+		slot = ( slot + 1 ) & ( RETURNLINKINDEXSIZE - 1 );
+	}
+
+	// The background compiler adds links too, so the slot is claimed atomically - the walks over
+	// _returnLinkCount on the emulation thread only ever see a count of fully reserved slots
+	int index;
+	do
+	{
+		index = _returnLinkCount;
+		if( index >= RETURNLINKCOUNT )
+			return NULL;
+	} while( InterlockedCompareExchange( ( volatile LONG* )&_returnLinkCount, index + 1, index ) != index );
+
+	ReturnLink* link = &_returnLinks[ index ];
+	link->Address = address;
+#ifdef BACKGROUNDCOMPILE
+	// Looking in the cache isn't safe off of the emulation thread - JR $ra will look it up the first time
+	link->Pointer = NULL;
+#else
+	link->Pointer = QuickPointerLookup( address );
+#endif
+
+	// Publish it - if another thread added the same address first we use theirs and our slot goes unused
+	slot = RETURNLINKHASH( address );
+	while( true )
+	{
+		int entry = InterlockedCompareExchange( &_returnLinkIndex[ slot ], index + 1, 0 );
+		if( entry == 0 )
+			return link;
+		if( _returnLinks[ entry - 1 ].Address == address )
+			return &_returnLinks[ entry - 1 ];
+		slot = ( slot + 1 ) & ( RETURNLINKINDEXSIZE - 1 );
+	}
 }
 
 CodeBlock* R4000Cache::Add( int address )
@@ -133,6 +257,10 @@ void R4000Cache::UpdatePointer( CodeBlock* block, void* pointer )
 
 	LOCK;
 	{
+#ifdef SMCDETECTION
+		if( block->Pointer == NULL )
+			this->MarkCodePages( block, 1 );
+#endif
 		block->Pointer = pointer;
 
 		int** pblock0 = *( _ptrLookup + b0 );
@@ -150,6 +278,40 @@ void R4000Cache::UpdatePointer( CodeBlock* block, void* pointer )
 		}
 
 		*( pblock1 + b2 ) = ( int )pointer;
+
+#ifdef FLATCODELOOKUP
+		uint index = FLATLOOKUPINDEX( block->Address );
+		if( index < FLATLOOKUPSIZE )
+		{
+			uint page = index >> FLATLOOKUPPAGESHIFT;
+			if( CCFlatCommitted[ page ] == 0 )
+			{
+				// Committed pages come back zeroed, so everything else in it reads as NULL
+				void** pageStart = &CCFlatTable[ page << FLATLOOKUPPAGESHIFT ];
+				if( VirtualAlloc( pageStart, sizeof( void* ) << FLATLOOKUPPAGESHIFT, MEM_COMMIT, PAGE_READWRITE ) != NULL )
+					CCFlatCommitted[ page ] = 1;
+			}
+			if( CCFlatCommitted[ page ] != 0 )
+				CCFlatTable[ index ] = pointer;
+		}
+#endif
+	}
+	UNLOCK;
+}
+
+void R4000Cache::UpdateLength( CodeBlock* block, int instructionCount )
+{
+	LOCK;
+	{
+#ifdef SMCDETECTION
+		if( block->Pointer != NULL )
+			this->MarkCodePages( block, -1 );
+#endif
+		block->InstructionCount = instructionCount;
+#ifdef SMCDETECTION
+		if( block->Pointer != NULL )
+			this->MarkCodePages( block, 1 );
+#endif
 	}
 	UNLOCK;
 }
@@ -307,11 +469,6 @@ void R4000Cache::Invalidate( int address )
 			return;
 		}
 
-		// --
-
-		int** pblock0 = *( _ptrLookup + b0 );
-		int* pblock1 = *( pblock0 + b1 );
-
 		for( int n = 0; n < L3SIZE; n++ )
 		{
 			CodeBlock* block = &block1[ n ];
@@ -327,11 +484,259 @@ void R4000Cache::Invalidate( int address )
 			if( ( address >= block->Address ) &&
 				( address <= upper ) )
 			{
+				this->DropBlock( block );
+
+				// Links are cheap to refill, so just drop them all
+				for( int m = 0; m < _returnLinkCount; m++ )
+					_returnLinks[ m ].Pointer = NULL;
+			}
+		}
+	}
+	UNLOCK;
+}
+
+// Adds delta to the count of every code page the block covers
+void R4000Cache::MarkCodePages( CodeBlock* block, int delta )
+{
+#ifdef SMCDETECTION
+	uint lower = ( ( uint )block->Address & 0x0FFFFFFF ) >> CODEPAGESHIFT;
+	uint upper = ( ( ( uint )block->Address & 0x0FFFFFFF ) + ( block->InstructionCount << 2 ) - 1 ) >> CODEPAGESHIFT;
+	for( uint n = lower; ( n <= upper ) && ( n < CODEPAGECOUNT ); n++ )
+		_codePages[ n ] += delta;
+#endif
+}
+
+// Removes a block from all of the lookup tables - the generated code is left where it is, as we
+// may be in the middle of running it
+void R4000Cache::DropBlock( CodeBlock* block )
+{
+	uint addr = ( ( uint )block->Address ) >> 2;
+
+	uint b0 = addr >> 20;
+	uint b1 = ( addr >> L2SHIFT ) & L2MASK;
+	uint b2 = addr & L3MASK;
+
+	int** pblock0 = *( _ptrLookup + b0 );
+	if( ( pblock0 != NULL ) &&
+		( *( pblock0 + b1 ) != NULL ) )
+		*( *( pblock0 + b1 ) + b2 ) = NULL;
+
+#ifdef FLATCODELOOKUP
+	uint index = FLATLOOKUPINDEX( block->Address );
+	if( ( index < FLATLOOKUPSIZE ) &&
+		( CCFlatCommitted[ index >> FLATLOOKUPPAGESHIFT ] != 0 ) )
+		CCFlatTable[ index ] = NULL;
+#endif
+
+#ifdef SMCDETECTION
+	if( block->Pointer != NULL )
+		this->MarkCodePages( block, -1 );
+#endif
+
+	this->UnlinkJumps( block );
+
 #ifdef DEBUGGING
-				SAFEFREE( block->InstructionSizes );
+	SAFEFREE( block->InstructionSizes );
+#endif
+	memset( block, 0, sizeof( CodeBlock ) );
+}
+
+// Unpatches the jumps in to the block and forgets the ones inside of its code
+void R4000Cache::UnlinkJumps( CodeBlock* block )
+{
+#ifdef BLOCKLINKS
+	if( block->Pointer != NULL )
+	{
+		byte* codeLower = ( byte* )block->Pointer;
+		byte* codeUpper = codeLower + block->Size;
+		for( int n = 0; n < CCBlockLinkCount; )
+		{
+			BlockLink* link = &CCBlockLinks[ n ];
+			if( link->Target == block->Address )
+			{
+				// Jumps in to us go back to the thunk so they rebuild/relink on the next run
+				__unfixupBlockJump( link->JumpBlock, link->Target );
+			}
+			else if( ( link->JumpBlock < codeLower ) ||
+				( link->JumpBlock >= codeUpper ) )
+			{
+				n++;
+				continue;
+			}
+
+			// Either unpatched or inside of our (now dead) code - remove by swapping in the last one
+			*link = CCBlockLinks[ --CCBlockLinkCount ];
+		}
+	}
 #endif
-				memset( block, 0, sizeof( CodeBlock ) );
-				*( pblock1 + n ) = NULL;
+}
+
+void R4000Cache::Unlink( CodeBlock* block )
+{
+	LOCK;
+	{
+		this->UnlinkJumps( block );
+
+		for( int m = 0; m < _returnLinkCount; m++ )
+		{
+			if( _returnLinks[ m ].Pointer == block->Pointer )
+				_returnLinks[ m ].Pointer = NULL;
+		}
+	}
+	UNLOCK;
+}
+
+void R4000Cache::InvalidateRange( int address, int length )
+{
+#ifdef SMCDETECTION
+	if( length <= 0 )
+		return;
+
+	uint lower = ( uint )address & 0x0FFFFFFF;
+	uint upper = lower + ( uint )length;
+
+	// Most writes land on pages with no code, so check that before doing any real work
+	bool hasCode = false;
+	for( uint n = lower >> CODEPAGESHIFT; ( n <= ( ( upper - 1 ) >> CODEPAGESHIFT ) ) && ( n < CODEPAGECOUNT ); n++ )
+	{
+		if( _codePages[ n ] != 0 )
+		{
+			hasCode = true;
+			break;
+		}
+	}
+	if( hasCode == false )
+		return;
+
+	// Blocks that start before the range may run in to it
+	uint searchLower = ( lower > MAXBLOCKSPAN ) ? ( lower - MAXBLOCKSPAN ) : 0;
+
+	LOCK;
+	{
+		bool dropped = false;
+
+		// Code can be built through any of the segments that alias physical memory
+		static const uint segments[] = { 0x00000000, 0x40000000, 0x80000000 };
+		for( int s = 0; s < sizeof( segments ) / sizeof( uint ); s++ )
+		{
+			uint addr = ( searchLower | segments[ s ] ) >> 2;
+			uint end = ( upper | segments[ s ] ) >> 2;
+			while( addr < end )
+			{
+				CodeBlock** block0 = _lookup[ addr >> 20 ];
+				if( block0 == NULL )
+				{
+					addr = ( ( addr >> 20 ) + 1 ) << 20;
+					continue;
+				}
+
+				CodeBlock* block1 = block0[ ( addr >> L2SHIFT ) & L2MASK ];
+				if( block1 == NULL )
+				{
+					addr = ( ( addr >> L2SHIFT ) + 1 ) << L2SHIFT;
+					continue;
+				}
+
+				CodeBlock* block = &block1[ addr & L3MASK ];
+				if( block->Address != NULL )
+				{
+					uint blockLower = ( uint )block->Address & 0x0FFFFFFF;
+					uint blockUpper = blockLower + ( block->InstructionCount << 2 );
+					if( ( blockLower < upper ) &&
+						( blockUpper > lower ) )
+					{
+						this->DropBlock( block );
+						dropped = true;
+					}
+				}
+				addr++;
+			}
+		}
+
+		if( dropped == true )
+		{
+			// Links are cheap to refill, so just drop them all
+			for( int m = 0; m < _returnLinkCount; m++ )
+				_returnLinks[ m ].Pointer = NULL;
+		}
+	}
+	UNLOCK;
+#endif
+}
+
+void R4000Cache::EvictRange( void* lower, void* upper )
+{
+	LOCK;
+	{
+		bool dropped = false;
+		for( int n = 0; n < L1SIZE; n++ )
+		{
+			CodeBlock** block0 = _lookup[ n ];
+			if( block0 == NULL )
+				continue;
+			for( int m = 0; m < L2SIZE; m++ )
+			{
+				CodeBlock* block1 = block0[ m ];
+				if( block1 == NULL )
+					continue;
+				for( int i = 0; i < L3SIZE; i++ )
+				{
+					CodeBlock* block = &block1[ i ];
+					if( ( block->Address == NULL ) ||
+						( block->Pointer < lower ) ||
+						( block->Pointer >= upper ) )
+						continue;
+					this->DropBlock( block );
+					dropped = true;
+				}
+			}
+		}
+
+#ifdef BLOCKLINKS
+		// Code that was abandoned (tier 0 code replaced by a recompile, blocks dropped by a code write
+		// they made) can still be running and linking jumps after it is no longer any block's
+		// Pointer - forget all of them, or unpatching one later would write in to freed storage
+		for( int n = 0; n < CCBlockLinkCount; )
+		{
+			if( ( CCBlockLinks[ n ].JumpBlock >= lower ) &&
+				( CCBlockLinks[ n ].JumpBlock < upper ) )
+				CCBlockLinks[ n ] = CCBlockLinks[ --CCBlockLinkCount ];
+			else
+				n++;
+		}
+#endif
+
+		// Links are cheap to refill, so just drop them all - otherwise only the ones in to the range
+		for( int m = 0; m < _returnLinkCount; m++ )
+		{
+			if( ( dropped == true ) ||
+				( ( _returnLinks[ m ].Pointer >= lower ) &&
+				( _returnLinks[ m ].Pointer < upper ) ) )
+				_returnLinks[ m ].Pointer = NULL;
+		}
+	}
+	UNLOCK;
+}
+
+void R4000Cache::ForEachBlock( CodeBlockCallback callback, void* state )
+{
+	LOCK;
+	{
+		for( int n = 0; n < L1SIZE; n++ )
+		{
+			CodeBlock** block0 = _lookup[ n ];
+			if( block0 == NULL )
+				continue;
+			for( int m = 0; m < L2SIZE; m++ )
+			{
+				CodeBlock* block1 = block0[ m ];
+				if( block1 == NULL )
+					continue;
+				for( int i = 0; i < L3SIZE; i++ )
+				{
+					if( block1[ i ].Address != NULL )
+						callback( &block1[ i ], state );
+				}
 			}
 		}
 	}
@@ -384,6 +789,32 @@ void R4000Cache::Clear( bool realloc )
 		}
 		CCLookupTable = NULL;
 
+		// Old code may still reference the links, so keep them around but make sure they never match
+		for( int n = 0; n < _returnLinkCount; n++ )
+		{
+			_returnLinks[ n ].Address = 0;
+			_returnLinks[ n ].Pointer = NULL;
+		}
+		_returnLinkCount = 0;
+		if( _returnLinkIndex != NULL )
+			memset( ( void* )_returnLinkIndex, 0, RETURNLINKINDEXSIZE * sizeof( LONG ) );
+		memset( _returnStack, 0, sizeof( _returnStack ) );
+		_returnStackTop = 0;
+
+#ifdef SMCDETECTION
+		memset( _codePages, 0, sizeof( _codePages ) );
+#endif
+#ifdef BLOCKLINKS
+		CCBlockLinkCount = 0;
+#endif
+
+#ifdef FLATCODELOOKUP
+		// Give back everything we committed - pages get committed again as blocks are added
+		if( CCFlatTable != NULL )
+			VirtualFree( CCFlatTable, FLATLOOKUPSIZE * sizeof( void* ), MEM_DECOMMIT );
+		memset( CCFlatCommitted, 0, sizeof( CCFlatCommitted ) );
+#endif
+
 		if( realloc == true )
 		{
 			_lookup = ( CodeBlock*** )calloc( L1SIZE + 1, sizeof( CodeBlock** ) );
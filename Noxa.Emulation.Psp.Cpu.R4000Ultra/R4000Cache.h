@@ -19,8 +19,48 @@ namespace Noxa {
 
 #pragma unmanaged
 				void* QuickPointerLookup( int address );
+
+				// Records a patched jump block so it can be unpatched if the target is dropped - if this
+				// returns false the table is full and the jump must not be patched
+				bool AddBlockLink( void* jumpBlock, int targetAddress );
 #pragma managed
 
+				// Used for return address prediction - JAL pushes the link for its return address, and
+				// JR $ra pops it and jumps right to Pointer if Address matches what is in $ra
+				typedef struct ReturnLink_t
+				{
+					int			Address;		// Guest return address
+					void*		Pointer;		// Block at Address, or NULL if it hasn't been looked up yet
+				} ReturnLink;
+
+// Entries in the prediction stack - must be a power of two
+#define RETURNSTACKSIZE		32
+// Maximum number of return links (one per distinct return address)
+#define RETURNLINKCOUNT		16384
+// Slots in the return address -> link index - twice RETURNLINKCOUNT so probes stay short
+#define RETURNLINKINDEXBITS	15
+#define RETURNLINKINDEXSIZE	( 1 << RETURNLINKINDEXBITS )
+
+				// A jump block that has been patched to jump directly to the block at Target
+				typedef struct BlockLink_t
+				{
+					int			Target;			// Guest address of the target block
+					byte*		JumpBlock;		// Start of the patched jump block
+				} BlockLink;
+
+// Maximum number of patched jump blocks we can track
+#define BLOCKLINKCOUNT		65536
+
+// Compiled code is tracked per page of guest memory - stores to a page with a non-zero count call in to
+// InvalidateRange, everything else is free to write without checking the cache
+#define CODEPAGESHIFT		12
+#define CODEPAGECOUNT		( 0x10000000 >> CODEPAGESHIFT )
+// Largest amount of guest code (in bytes) a single block can cover - we search this far back for overlaps
+#define MAXBLOCKSPAN		0x400
+
+				// # of blocks overlapping each code page, indexed by ( address & 0x0FFFFFFF ) >> CODEPAGESHIFT
+				extern ushort _codePages[ CODEPAGECOUNT ];
+
 				typedef struct CodeBlock_t
 				{
 				public:
@@ -31,6 +71,10 @@ namespace Noxa {
 					bool		EndsOnSyscall;
 					
 					int			ExecutionCount;
+#ifdef TIEREDCOMPILE
+					byte		Tier;			// 0 = quick build that counts its runs, 1 = optimized
+					int			TierUpCount;	// Runs of the quick build - only its own code touches this
+#endif
 
 #ifdef DEBUGGING
 					// This is a list of instruction expansion sizes
@@ -41,12 +85,22 @@ namespace Noxa {
 #endif
 				} CodeBlock;
 
+				typedef void (*CodeBlockCallback)( CodeBlock* block, void* state );
+
 				class R4000Cache
 				{
 				protected:
 					CodeBlock***	_lookup;
 					int***			_ptrLookup;
 
+					ReturnLink*		_returnLinks;
+					int				_returnLinkCount;
+					volatile LONG*	_returnLinkIndex;	// Index in to _returnLinks + 1, or 0 if empty
+
+					void MarkCodePages( CodeBlock* block, int delta );
+					void UnlinkJumps( CodeBlock* block );
+					void DropBlock( CodeBlock* block );
+
 				public:
 					R4000Cache();
 					~R4000Cache();
@@ -56,6 +110,8 @@ namespace Noxa {
 				public:
 					CodeBlock* Add( int address );
 					void UpdatePointer( CodeBlock* block, void* pointer );
+					// Changes the range of guest code a block covers - rebuilt blocks may not cover what they did
+					void UpdateLength( CodeBlock* block, int instructionCount );
 					
 					// Finds the code block that starts at the given address
 					CodeBlock* Find( int address );
@@ -63,7 +119,29 @@ namespace Noxa {
 					// Finds the code blocks that contains the given address
 					int Search( int address, CodeBlock** buffer );
 
+					// Gets the return link for a return address, adding it if this is the first call site that
+					// uses it, or NULL if we are out - safe to call from any thread
+					ReturnLink* AddReturnLink( int address );
+					// All RETURNLINKCOUNT links, used or not
+					ReturnLink* GetReturnLinks(){ return _returnLinks; }
+
 					void Invalidate( int address );
+
+					// Sends everything that jumps straight to the block's current code back through the lookup, so
+					// the block can be rebuilt in place - the old code is left where it is
+					void Unlink( CodeBlock* block );
+
+					// Drops all blocks that overlap the given range of guest memory - cheap if none of the
+					// pages it covers have code in them
+					void InvalidateRange( int address, int length );
+
+					// Drops all blocks whose generated code lives in the given host range, and every block and
+					// return link that points in to it - used when the storage holding them is being thrown away
+					void EvictRange( void* lower, void* upper );
+
+					// Calls callback for every block in the cache
+					void ForEachBlock( CodeBlockCallback callback, void* state );
+
 					void Clear();
 					void Clear( bool realloc );
 				};
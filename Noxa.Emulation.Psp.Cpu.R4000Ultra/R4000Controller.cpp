@@ -500,6 +500,10 @@ void SetBreakpoint( Breakpoint^ breakpoint, CodeBlock* block )
 	int size;
 	byte* start = FindInstructionStart( block, breakpoint->Address, &size );
 
+	// Traces don't have any code for the instructions they jumped over
+	if( size == 0 )
+		return;
+
 	// Write break jump bytes (see __debugThunk for more info)
 	if( start[ 0 ] != 0x90 )
 	{
@@ -14,12 +14,15 @@
 #include "Tracer.h"
 
 #include "R4000AdvancedBlockBuilder.h"
+#include "R4000BackgroundCompiler.h"
 #include "R4000Generator.h"
 #include "R4000Ctx.h"
 #include "R4000BiosStubs.h"
+#include "R4000Vfpu.h"
 #include "R4000VideoInterface.h"
 
 using namespace System::Diagnostics;
+using namespace System::Runtime::InteropServices;
 using namespace System::Text;
 using namespace Noxa::Emulation::Psp;
 using namespace Noxa::Emulation::Psp::Cpu;
@@ -38,6 +41,12 @@ R4000Cpu::R4000Cpu( IEmulationInstance^ emulator, ComponentParameters^ parameter
 	// Ugly: has to be above the block builder constructor!
 	_ctx = ( R4000Ctx* )_aligned_malloc( sizeof( R4000Ctx ), 16 );
 	memset( _ctx, 0, sizeof( R4000Ctx ) );
+	// VFPU S/T prefixes are pass-throughs when nothing is set
+	( ( R4000Ctx* )_ctx )->Cp2Pfx[ 0 ] = 0xE4;
+	( ( R4000Ctx* )_ctx )->Cp2Pfx[ 1 ] = 0xE4;
+
+	// Shared by every builder (including the background one), so it is done before any exist
+	VfpuBuildDecoder();
 
 	_emu = emulator;
 	_params = parameters;
@@ -45,6 +54,9 @@ R4000Cpu::R4000Cpu( IEmulationInstance^ emulator, ComponentParameters^ parameter
 	_memory = gcnew R4000Memory();
 	_core0 = gcnew R4000Core( this, ( R4000Ctx* )_ctx );
 	_codeCache = new R4000Cache();
+#ifdef PERSISTENTCACHE
+	_persistentCache = NULL;
+#endif
 
 	_stats = gcnew R4000Statistics();
 #ifdef STATISTICS
@@ -68,7 +80,14 @@ R4000Cpu::R4000Cpu( IEmulationInstance^ emulator, ComponentParameters^ parameter
 	_hasExecuted = false;
 
 	R4000Generator* gen = new R4000Generator();
+#ifdef CODECACHEEVICTION
+	gen->SetStorageBudget( CODECACHEBUDGET );
+#endif
+#ifdef DIRECTCODEGEN
+	gen->SetDirect( true );
+#endif
 	_context = gcnew R4000GenContext( gen, _memory->NativeSystem );
+	_context->FastMemory = _memory->FastMemoryBase;
 	_builder = gcnew R4000AdvancedBlockBuilder( this, _core0 );
 	_biosStubs = gcnew R4000BiosStubs();
 	_videoInterface = gcnew R4000VideoInterface( this );
@@ -141,6 +160,15 @@ uint R4000Cpu::LookupUserExport( uint nid )
 
 void R4000Cpu::Cleanup()
 {
+#ifdef BACKGROUNDCOMPILE
+	// Must be gone before the cache and memory it reads are
+	if( _compiler != nullptr )
+	{
+		delete _compiler;
+		_compiler = nullptr;
+	}
+#endif
+
 	this->DestroyThreading();
 
 	this->DestroyNativeInterface();
@@ -152,6 +180,15 @@ void R4000Cpu::Cleanup()
 		_aligned_free( _ctx );
 	_ctx = NULL;
 	//SAFEFREE( _bounce );
+#ifdef PERSISTENTCACHE
+	if( _persistentCache != NULL )
+	{
+		Log::WriteLine( Verbosity::Normal, Feature::Cpu, "Cpu: persistent code cache loaded {0} blocks, stored {1}",
+			_persistentCache->Loads, _persistentCache->Stores );
+		PersistentCacheClose( _persistentCache );
+		SAFEFREE( _persistentCache );
+	}
+#endif
 	SAFEDELETE( _codeCache );
 }
 
@@ -173,6 +210,15 @@ void R4000Cpu::SetupGame( GameInformation^ game, Stream^ bootStream )
 			Debug::WriteLine( "Cpu: no debug information found in program - method names will be unavailable" );
 #endif
 
+#ifdef PERSISTENTCACHE
+		this->SetupPersistentCache( game, bootStream );
+#endif
+
+#ifdef BACKGROUNDCOMPILE
+		_compiler = gcnew R4000BackgroundCompiler( this );
+		_compiler->Start();
+#endif
+
 		// Has to happen late in the game because we need to
 		// make sure the video subsystem is ready
 		_videoInterface->Prepare();
@@ -181,6 +227,78 @@ void R4000Cpu::SetupGame( GameInformation^ game, Stream^ bootStream )
 	}
 }
 
+#ifdef PERSISTENTCACHE
+void R4000Cpu::SetupPersistentCache( GameInformation^ game, Stream^ bootStream )
+{
+	// Saved code is kept per boot module - if we can't read it, the game ID is the next best thing
+	uint moduleHash = 2166136261;
+	if( ( bootStream != nullptr ) &&
+		( bootStream->CanSeek == true ) )
+	{
+		int64 position = bootStream->Position;
+		bootStream->Position = 0;
+		array<byte>^ buffer = gcnew array<byte>( 4096 );
+		int read;
+		while( ( read = bootStream->Read( buffer, 0, buffer->Length ) ) > 0 )
+		{
+			for( int n = 0; n < read; n++ )
+				moduleHash = ( moduleHash ^ buffer[ n ] ) * 16777619;
+		}
+		bootStream->Position = position;
+	}
+	else if( ( game != nullptr ) &&
+		( game->UniqueID != nullptr ) )
+	{
+		for each( wchar_t c in game->UniqueID )
+			moduleHash = ( moduleHash ^ ( uint )c ) * 16777619;
+	}
+	else
+		return;
+
+	PersistentCache* cache = ( PersistentCache* )calloc( 1, sizeof( PersistentCache ) );
+	cache->Ranges[ PERSISTENTRANGECONTEXT ].Base = ( byte* )_ctx;
+	cache->Ranges[ PERSISTENTRANGECONTEXT ].Size = sizeof( R4000Ctx );
+	cache->Ranges[ PERSISTENTRANGEMAINMEMORY ].Base = _context->MainMemory;
+	cache->Ranges[ PERSISTENTRANGEMAINMEMORY ].Size = MainMemorySize + 1;
+	cache->Ranges[ PERSISTENTRANGEFRAMEBUFFER ].Base = _context->FrameBuffer;
+	cache->Ranges[ PERSISTENTRANGEFRAMEBUFFER ].Size = VideoMemorySize + 1;
+	cache->Ranges[ PERSISTENTRANGESCRATCHPAD ].Base = _context->ScratchPad;
+	cache->Ranges[ PERSISTENTRANGESCRATCHPAD ].Size = ScratchPadSize + 1;
+	cache->Ranges[ PERSISTENTRANGEFASTMEMORY ].Base = _context->FastMemory;
+	cache->Ranges[ PERSISTENTRANGEFASTMEMORY ].Size = FASTMEMORYSIZE;
+	cache->Ranges[ PERSISTENTRANGERETURNLINKS ].Base = ( byte* )_codeCache->GetReturnLinks();
+	cache->Ranges[ PERSISTENTRANGERETURNLINKS ].Size = RETURNLINKCOUNT * sizeof( ReturnLink );
+
+	bool opened = false;
+	try
+	{
+		String^ directory = Path::Combine( AppDomain::CurrentDomain->BaseDirectory, PERSISTENTCACHEPATH );
+		Directory::CreateDirectory( directory );
+		String^ path = Path::Combine( directory, String::Format( "{0:X8}.jit", moduleHash ) );
+
+		IntPtr pathPointer = Marshal::StringToHGlobalUni( path );
+		opened = PersistentCacheOpen( cache, ( const wchar_t* )pathPointer.ToPointer(), moduleHash );
+		Marshal::FreeHGlobal( pathPointer );
+	}
+	catch( IOException^ )
+	{
+	}
+	catch( UnauthorizedAccessException^ )
+	{
+	}
+
+	if( opened == false )
+	{
+		Log::WriteLine( Verbosity::Normal, Feature::Cpu, "Cpu: persistent code cache could not be opened - blocks will not be saved" );
+		SAFEFREE( cache );
+		return;
+	}
+
+	Log::WriteLine( Verbosity::Normal, Feature::Cpu, "Cpu: persistent code cache for module {0:X8} has {1} blocks", moduleHash, cache->IndexCount );
+	_persistentCache = cache;
+}
+#endif
+
 /*
 void R4000Cpu::PrintStatistics()
 {
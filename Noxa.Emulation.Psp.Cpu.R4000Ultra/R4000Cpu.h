@@ -25,6 +25,7 @@ using namespace Noxa::Emulation::Psp::Utilities;
 #include "R4000Core.h"
 #include "R4000GenContext.h"
 #include "R4000Memory.h"
+#include "R4000PersistentCache.h"
 #include "R4000Statistics.h"
 
 using namespace Noxa::Emulation::Psp::Cpu::Native;
@@ -38,6 +39,7 @@ namespace Noxa {
 				ref class R4000BiosStubs;
 				ref class R4000VideoInterface;
 				ref class R4000BlockBuilder;
+				ref class R4000BackgroundCompiler;
 				ref class R4000Hook;
 				ref class R4000Controller;
 
@@ -73,8 +75,14 @@ namespace Noxa {
 					R4000Core^					_core0;
 
 					R4000Cache*					_codeCache;
+#ifdef PERSISTENTCACHE
+					PersistentCache*			_persistentCache;
+#endif
 					R4000GenContext^			_context;
 					R4000BlockBuilder^			_builder;
+#ifdef BACKGROUNDCOMPILE
+					R4000BackgroundCompiler^	_compiler;
+#endif
 					R4000BiosStubs^				_biosStubs;
 					R4000VideoInterface^		_videoInterface;
 
@@ -265,6 +273,10 @@ namespace Noxa {
 
 					void SetupThreading();
 					void DestroyThreading();
+
+#ifdef PERSISTENTCACHE
+					void SetupPersistentCache( GameInformation^ game, Stream^ bootStream );
+#endif
 				};
 
 			}
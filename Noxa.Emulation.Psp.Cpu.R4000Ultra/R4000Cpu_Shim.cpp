@@ -345,7 +345,10 @@ void* R4000Cpu::EmitShimN( BiosFunction^ function, NativeMemorySystem* memory, v
 
 	// Handle memory usage - this is always the first parameter
 	if( function->UsesMemorySystem == true )
+	{
+		g->Pointer();
 		g->push( ( uint )memory );
+	}
 
 	// Invoke method
 #pragma warning( disable: 4395 )
@@ -379,5 +382,8 @@ void* R4000Cpu::EmitShimN( BiosFunction^ function, NativeMemorySystem* memory, v
 	FunctionPointer ptr = g->GenerateCode();
 	g->Reset();
 
+	// Shims are not in the code cache, so make sure they never get evicted
+	g->PinStorage( ( void* )ptr );
+
 	return ptr;
 }
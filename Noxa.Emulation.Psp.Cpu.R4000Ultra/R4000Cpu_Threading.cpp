@@ -8,6 +8,7 @@
 #include "R4000Cpu.h"
 #include "R4000Core.h"
 #include "R4000BlockBuilder.h"
+#include "R4000BackgroundCompiler.h"
 #include "R4000Memory.h"
 #include "Tracer.h"
 #include "gcref.h"
@@ -35,6 +36,8 @@ extern uint _instructionsExecuted;
 extern uint _executionLoops;
 extern uint _codeCacheHits;
 extern uint _codeCacheMisses;
+extern uint _codeStorageEvictions;
+extern uint _idleLoopExits;
 #endif
 
 extern void BreakHandler( uint pc );
@@ -84,6 +87,7 @@ HANDLE					_waitHandle;
 
 R4000Ctx*				_cpuCtx;
 R4000Cache*				_cache;
+R4000Generator*			_generator;
 bouncefn				_bounceFn;
 
 int						_currentTcsId;
@@ -92,6 +96,10 @@ ThreadContext*			_currentTcs;
 SwitchRequest			_switchRequest;
 LL<SwitchRequest*>		_marshalRequests;
 
+#ifdef IDLELOOPS
+int						_idleExits;				// # of NativeExecutes in a row that ended in an idle loop
+#endif
+
 // From interrupts file
 void PerformInterrupt();
 
@@ -101,6 +109,7 @@ void R4000Cpu::SetupThreading()
 {
 	_cpuCtx = ( R4000Ctx* )_ctx;
 	_cache = this->_codeCache;
+	_generator = _context->Generator;
 	_bounceFn = ( bouncefn )this->_bounce;
 
 	_currentTcsId = -1;
@@ -281,6 +290,15 @@ CodeBlock* BuildBlock( int pc )
 	return R4000Cpu::GlobalCpu->_builder->Build( pc );
 }
 
+#ifdef BACKGROUNDCOMPILE
+void PublishCompiledBlocks()
+{
+	R4000BackgroundCompiler^ compiler = R4000Cpu::GlobalCpu->_compiler;
+	if( compiler != nullptr )
+		compiler->Publish();
+}
+#endif
+
 void MakeSafetyCallback( int tcsId, ThreadContext* tcs )
 {
 	ContextSafetyDelegate^ del = tcs->SafetyCallback;
@@ -410,6 +428,61 @@ void __debugRunPrint( int pc, int codePointer )
 }
 #pragma unmanaged
 
+#ifdef CODECACHEEVICTION
+typedef struct StorageHeat_t
+{
+	R4000Generator*	Generator;
+	uint			Heat[ STORAGETABLESIZE ];
+} StorageHeat;
+
+void MeasureStorageHeat( CodeBlock* block, void* state )
+{
+	StorageHeat* heat = ( StorageHeat* )state;
+	int index = heat->Generator->FindStorage( block->Pointer );
+	if( index >= 0 )
+		heat->Heat[ index ] += block->ExecutionCount;
+
+	// Age the counts so that code that was hot a long time ago can eventually go
+	block->ExecutionCount >>= 1;
+}
+
+// Throws away the coldest storage blocks until we are back under budget - must only be called when
+// there is no generated code on the stack
+void EvictCode()
+{
+	while( _generator->IsOverBudget() == true )
+	{
+		StorageHeat heat;
+		memset( &heat, 0, sizeof( StorageHeat ) );
+		heat.Generator = _generator;
+		_cache->ForEachBlock( MeasureStorageHeat, &heat );
+
+		// Never the one we are currently filling or one holding shims - ties go to the lowest (usually oldest) one
+		int victim = -1;
+		for( int n = 0; n < STORAGETABLESIZE; n++ )
+		{
+			if( ( n == _generator->GetCurrentStorage() ) ||
+				( _generator->GetStorage( n ) == NULL ) ||
+				( _generator->IsStoragePinned( n ) == true ) )
+				continue;
+			if( ( victim == -1 ) ||
+				( heat.Heat[ n ] < heat.Heat[ victim ] ) )
+				victim = n;
+		}
+		if( victim == -1 )
+			break;
+
+		byte* lower = _generator->GetStorage( victim );
+		_cache->EvictRange( lower, lower + _generator->GetStorageBlockSize() );
+		_generator->ReleaseStorage( victim );
+
+#ifdef STATISTICS
+		_codeStorageEvictions++;
+#endif
+	}
+}
+#endif
+
 uint NativeExecute( bool* breakFlag )
 {
 	// If we came in with a switch flag, it's possible we are the first run
@@ -460,13 +533,31 @@ uint NativeExecute( bool* breakFlag )
 	}
 
 	uint instructionCount = 0;
+#ifdef IDLELOOPS
+	bool idled = false;
+#endif
 
 executeStart:		// Arrived at from call/interrupt handling below
 
-#ifdef STATISTICS
+#ifdef INSTRUCTIONBUDGET
+	// Blocks count this down and come back here once it runs out
+	_cpuCtx->Budget = EXECUTIONBUDGET;
+#elif defined( STATISTICS )
 	uint startInstructionCount = _instructionsExecuted;
 #endif
 
+#ifdef CODECACHEEVICTION
+	// We are outside of all generated code here, so it is safe to throw some away
+	if( _generator->IsOverBudget() == true )
+		EvictCode();
+#endif
+
+#ifdef BACKGROUNDCOMPILE
+	// Also a good time to pick up whatever the background compiler has finished
+	if( _backgroundPending != 0 )
+		PublishCompiledBlocks();
+#endif
+
 	// Get/build block
 	int pc = _cpuCtx->PC & 0x3FFFFFFF;
 	void* codePointer = QuickPointerLookup( pc );
@@ -485,11 +576,13 @@ executeStart:		// Arrived at from call/interrupt handling below
 	}
 #endif
 
-#ifdef STATISTICS
+#if defined( STATISTICS ) && !defined( CODECACHEEVICTION )
+	// With eviction on, the block preamble does the counting
 	CodeBlock* block = _cache->Find( pc );
 	assert( block != NULL );
 	block->ExecutionCount++;
-
+#endif
+#ifdef STATISTICS
 	_executionLoops++;
 #endif
 
@@ -502,7 +595,14 @@ executeStart:		// Arrived at from call/interrupt handling below
 	_bounceFn( ( int )codePointer );
 #endif
 
+#ifdef INSTRUCTIONBUDGET
+	// Grab it before a switch below replaces the ctx
+	int budgetLeft = _cpuCtx->Budget;
+	instructionCount += EXECUTIONBUDGET - budgetLeft;
 #ifdef STATISTICS
+	_instructionsExecuted += EXECUTIONBUDGET - budgetLeft;
+#endif
+#elif defined( STATISTICS )
 	instructionCount += _instructionsExecuted - startInstructionCount;
 #endif
 
@@ -551,7 +651,35 @@ executeStart:		// Arrived at from call/interrupt handling below
 			// BreakAndWait request
 			BreakHandler( _cpuCtx->PC );
 		}
+#ifdef IDLELOOPS
+		else if( ( _cpuCtx->StopFlag & CtxIdle ) == CtxIdle )
+		{
+			_cpuCtx->StopFlag &= ~CtxIdle;
+			// The block is waiting on something only a timer or another thread can change, so give the host
+			// the time instead of spinning - the loop will be back if it is still waiting when we return
+			idled = true;
+			_idleExits++;
+#ifdef INSTRUCTIONBUDGET
+			// The loop would have spent the rest of the timeslice going around
+			if( budgetLeft > 0 )
+				instructionCount += budgetLeft;
+#endif
+			if( _idleExits >= IDLESLEEPTHRESHOLD )
+				Sleep( 1 );
+			else
+				SwitchToThread();
+#ifdef STATISTICS
+			_idleLoopExits++;
+#endif
+		}
+#endif
 	}
+
+#ifdef IDLELOOPS
+	// Only a thread that does nothing but wait gets put to sleep
+	if( idled == false )
+		_idleExits = 0;
+#endif
 	
 	return instructionCount;
 }
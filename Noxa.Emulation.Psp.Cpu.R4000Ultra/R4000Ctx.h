@@ -26,6 +26,7 @@ using namespace Noxa::Emulation::Psp;
 #define CTXCP2CONDBIT	1204
 #define CTXINDELAY		1208
 #define CTXNEXTPC		1212
+#define CTXBUDGET		1216
 //#define CTXCP0REGS	
 //#define CTXCP0CONTROL	
 #define CTXSIZE			1212
@@ -62,6 +63,8 @@ namespace Noxa {
 					CtxInterruptPending	= 0x08,
 					// BreakAndWait request
 					CtxBreakAndWait		= 0x10,
+					// Block is spinning in an idle loop
+					CtxIdle				= 0x20,
 				};
 
 				// Note: for perf, everything should be 32 bit ints
@@ -91,6 +94,7 @@ namespace Noxa {
 					int				Cp2ConditionBit;		// +1204
 					int				InDelay;				// +1208 - DEBUG
 					uint			NextPC;					// +1212 - DEBUG
+					int				Budget;					// +1216 - instructions left before going back to the execution loop
 					//int			Cp0Registers[ 32 ];		// + (128)
 					//int			Cp0Control[ 32 ];		// + (128)
 				} R4000Ctx;
@@ -0,0 +1,266 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#include "StdAfx.h"
+#pragma unmanaged
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#pragma managed
+#include "R4000FastMemory.h"
+#include "R4000Ctx.h"
+
+using namespace Noxa::Emulation::Psp;
+using namespace Noxa::Emulation::Psp::Cpu;
+
+// Number of times to try to grab the window before giving up
+#define MAXIMUMATTEMPTS		16
+// Reservations start on this granularity
+#define ALLOCATIONGRANULARITY	0x10000
+
+// R4000Generator_Memory.cpp
+int __readMemoryThunk( uint pc, uint targetAddress );
+void __writeMemoryThunk( uint pc, uint targetAddress, uint width, uint value );
+
+#pragma unmanaged
+
+FastMemory* _fastMemory = NULL;
+
+// Host register for a ModRM reg field
+DWORD* FaultRegister( PCONTEXT context, int reg )
+{
+	switch( reg )
+	{
+	default:
+	case 0:
+		return &context->Eax;
+	case 1:
+		return &context->Ecx;
+	case 2:
+		return &context->Edx;
+	case 3:
+		return &context->Ebx;
+	case 4:
+		return &context->Esp;
+	case 5:
+		return &context->Ebp;
+	case 6:
+		return &context->Esi;
+	case 7:
+		return &context->Edi;
+	}
+}
+
+LONG CALLBACK __fastMemoryFaultHandler( PEXCEPTION_POINTERS info )
+{
+	FastMemory* memory = _fastMemory;
+	if( ( memory == NULL ) ||
+		( info->ExceptionRecord->ExceptionCode != EXCEPTION_ACCESS_VIOLATION ) )
+		return EXCEPTION_CONTINUE_SEARCH;
+
+	// Only faults inside of our window are ours
+	byte* target = ( byte* )info->ExceptionRecord->ExceptionInformation[ 1 ];
+	if( ( target < memory->Base ) ||
+		( target >= memory->Base + FASTMEMORYSIZE ) )
+		return EXCEPTION_CONTINUE_SEARCH;
+
+	// Only the MOVs that EmitDirectMemoryRead/Write generate are handled: [66] 88/89/8B with a
+	// [reg + disp] operand, followed by the marker NOP that holds the guest PC
+	PCONTEXT context = info->ContextRecord;
+	byte* code = ( byte* )context->Eip;
+	int width = 4;
+	if( *code == 0x66 )
+	{
+		width = 2;
+		code++;
+	}
+	byte opcode = *code++;
+	if( opcode == 0x88 )
+		width = 1;
+	else if( ( opcode != 0x89 ) &&
+		( opcode != 0x8B ) )
+		return EXCEPTION_CONTINUE_SEARCH;
+	int mod = code[ 0 ] >> 6;
+	int reg = ( code[ 0 ] >> 3 ) & 0x7;
+	int rm = code[ 0 ] & 0x7;
+	if( ( mod == 3 ) ||
+		( rm == 4 ) ||
+		( ( mod == 0 ) && ( rm == 5 ) ) )
+		return EXCEPTION_CONTINUE_SEARCH;
+	code += ( mod == 1 ) ? 2 : ( ( mod == 2 ) ? 5 : 1 );
+	if( ( code[ 0 ] != 0x0F ) ||
+		( code[ 1 ] != 0x1F ) ||
+		( code[ 2 ] != 0x80 ) )
+		return EXCEPTION_CONTINUE_SEARCH;
+	uint pc = *( uint* )( code + 3 );
+
+	// Do what the slow path would have - report it, and reads get 0 - without mapping anything, so the
+	// next access to the same place is reported too
+	uint targetAddress = ( uint )( target - memory->Base );
+	if( opcode == 0x8B )
+	{
+		uint value = ( uint )__readMemoryThunk( pc, targetAddress );
+		DWORD* dest = FaultRegister( context, reg );
+		if( width == 2 )
+			*dest = ( *dest & 0xFFFF0000 ) | ( value & 0xFFFF );
+		else
+			*dest = value;
+	}
+	else
+	{
+		uint value;
+		if( width == 1 )
+		{
+			// AL/CL/DL/BL, then AH/CH/DH/BH
+			value = *FaultRegister( context, reg & 0x3 );
+			if( reg >= 4 )
+				value >>= 8;
+			value &= 0xFF;
+		}
+		else
+			value = *FaultRegister( context, reg ) & ( ( width == 2 ) ? 0xFFFF : 0xFFFFFFFF );
+		__writeMemoryThunk( pc, targetAddress, width, value );
+	}
+
+	// Skip the access - the marker runs as a NOP
+	context->Eip = ( DWORD )code;
+	return EXCEPTION_CONTINUE_EXECUTION;
+}
+
+void FastMemoryUnmapViews( byte* base )
+{
+	UnmapViewOfFile( base + MainMemoryBase );
+	for( int offset = 0; offset < FASTVIDEOMIRRORSIZE; offset += FASTVIDEOMEMORYSIZE )
+		UnmapViewOfFile( base + VideoMemoryBase + offset );
+	UnmapViewOfFile( base + ScratchPadBase );
+}
+
+void FastMemoryReleaseGaps( FastMemory* memory )
+{
+	for( int n = 0; n < FASTMEMORYGAPS; n++ )
+	{
+		if( memory->Gaps[ n ] != NULL )
+			VirtualFree( memory->Gaps[ n ], 0, MEM_RELEASE );
+		memory->Gaps[ n ] = NULL;
+	}
+}
+
+bool FastMemoryReserveGaps( FastMemory* memory, byte* base )
+{
+	// In address order - views take up whole allocation granules, so the starts are rounded up
+	uint starts[ FASTMEMORYGAPS ] = { 0, ScratchPadBase + FASTSCRATCHPADSIZE, VideoMemoryBase + FASTVIDEOMIRRORSIZE, MainMemoryBase + FASTMAINMEMORYSIZE };
+	uint ends[ FASTMEMORYGAPS ] = { ScratchPadBase, VideoMemoryBase, MainMemoryBase, FASTMEMORYSIZE };
+	for( int n = 0; n < FASTMEMORYGAPS; n++ )
+	{
+		uint start = ( starts[ n ] + ALLOCATIONGRANULARITY - 1 ) & ~( ALLOCATIONGRANULARITY - 1 );
+		if( start >= ends[ n ] )
+			continue;
+		memory->Gaps[ n ] = ( byte* )VirtualAlloc( base + start, ends[ n ] - start, MEM_RESERVE, PAGE_NOACCESS );
+		if( memory->Gaps[ n ] == NULL )
+		{
+			FastMemoryReleaseGaps( memory );
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FastMemoryMapViews( FastMemory* memory, byte* base )
+{
+	if( MapViewOfFileEx( memory->MainSection, FILE_MAP_ALL_ACCESS, 0, 0, FASTMAINMEMORYSIZE, base + MainMemoryBase ) == NULL )
+		return false;
+
+	// Each mirror is another view of the same section
+	for( int offset = 0; offset < FASTVIDEOMIRRORSIZE; offset += FASTVIDEOMEMORYSIZE )
+	{
+		if( MapViewOfFileEx( memory->VideoSection, FILE_MAP_ALL_ACCESS, 0, 0, FASTVIDEOMEMORYSIZE, base + VideoMemoryBase + offset ) == NULL )
+			return false;
+	}
+
+	if( MapViewOfFileEx( memory->ScratchPadSection, FILE_MAP_ALL_ACCESS, 0, 0, FASTSCRATCHPADSIZE, base + ScratchPadBase ) == NULL )
+		return false;
+
+	return true;
+}
+
+bool Noxa::Emulation::Psp::Cpu::FastMemoryCreate( FastMemory* memory )
+{
+	memset( memory, 0, sizeof( FastMemory ) );
+
+	// Pagefile backed, so they come back zeroed
+	memory->MainSection = CreateFileMapping( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, FASTMAINMEMORYSIZE, NULL );
+	memory->VideoSection = CreateFileMapping( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, FASTVIDEOMEMORYSIZE, NULL );
+	memory->ScratchPadSection = CreateFileMapping( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, FASTSCRATCHPADSIZE, NULL );
+	if( ( memory->MainSection == NULL ) ||
+		( memory->VideoSection == NULL ) ||
+		( memory->ScratchPadSection == NULL ) )
+	{
+		FastMemoryDestroy( memory );
+		return false;
+	}
+
+	// Views can't be placed inside of a reservation, so find a hole big enough, release it, and
+	// map in to it - another thread could take part of it in between, so retry a few times
+	for( int attempt = 0; attempt < MAXIMUMATTEMPTS; attempt++ )
+	{
+		byte* base = ( byte* )VirtualAlloc( NULL, FASTMEMORYSIZE, MEM_RESERVE, PAGE_NOACCESS );
+		if( base == NULL )
+			break;
+		VirtualFree( base, 0, MEM_RELEASE );
+
+		if( ( FastMemoryMapViews( memory, base ) == true ) &&
+			( FastMemoryReserveGaps( memory, base ) == true ) )
+		{
+			memory->Base = base;
+			break;
+		}
+		FastMemoryUnmapViews( base );
+	}
+	if( memory->Base == NULL )
+	{
+		FastMemoryDestroy( memory );
+		return false;
+	}
+
+	memory->MainMemory = memory->Base + MainMemoryBase;
+	memory->VideoMemory = memory->Base + VideoMemoryBase;
+	memory->ScratchPad = memory->Base + ScratchPadBase;
+
+	_fastMemory = memory;
+	memory->FaultHandler = AddVectoredExceptionHandler( 1, __fastMemoryFaultHandler );
+
+	return true;
+}
+
+void Noxa::Emulation::Psp::Cpu::FastMemoryDestroy( FastMemory* memory )
+{
+	if( memory->FaultHandler != NULL )
+		RemoveVectoredExceptionHandler( memory->FaultHandler );
+	memory->FaultHandler = NULL;
+	if( _fastMemory == memory )
+		_fastMemory = NULL;
+
+	if( memory->Base != NULL )
+	{
+		FastMemoryUnmapViews( memory->Base );
+		FastMemoryReleaseGaps( memory );
+	}
+	memory->Base = NULL;
+	memory->MainMemory = NULL;
+	memory->VideoMemory = NULL;
+	memory->ScratchPad = NULL;
+
+	if( memory->MainSection != NULL )
+		CloseHandle( memory->MainSection );
+	if( memory->VideoSection != NULL )
+		CloseHandle( memory->VideoSection );
+	if( memory->ScratchPadSection != NULL )
+		CloseHandle( memory->ScratchPadSection );
+	memory->MainSection = NULL;
+	memory->VideoSection = NULL;
+	memory->ScratchPadSection = NULL;
+}
+
+#pragma managed
@@ -0,0 +1,61 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+using namespace Noxa::Emulation::Psp;
+
+// Size of the host window - covers everything a 0x3FFFFFFF masked address can reach
+#define FASTMEMORYSIZE			0x40000000
+// Guest addresses are masked with this and then added to the window base
+#define FASTMEMORYMASK			0x3FFFFFFF
+// Holes between the mapped regions, each held by its own no-access reservation
+#define FASTMEMORYGAPS			4
+
+// Real sizes of the regions (the *Size defines in NoxaShared.h are size - 1)
+#define FASTMAINMEMORYSIZE		0x02000000
+#define FASTVIDEOMEMORYSIZE		0x00200000
+#define FASTVIDEOMIRRORSIZE		0x04000000
+#define FASTSCRATCHPADSIZE		0x00004000
+
+namespace Noxa {
+	namespace Emulation {
+		namespace Psp {
+			namespace Cpu {
+
+				/* One host reservation laid out like the PSP physical map.
+				   Main memory, VRAM and the scratchpad are pagefile backed sections mapped at their
+				   guest offsets, and VRAM is mapped once per 2MB in 0x04000000-0x07FFFFFF so the
+				   mirrors alias the same pages. Everything else in the window is reserved no-access
+				   (so nothing else in the process can land there) and faults - the fault handler decodes the access, reports it like the slow path does
+				   (reads get 0, writes are dropped) and skips it. Nothing is ever mapped in, so every
+				   bad access is reported.
+				*/
+				typedef struct FastMemory_t
+				{
+					byte*		Base;				// Host address of guest 0x00000000
+
+					byte*		MainMemory;
+					byte*		VideoMemory;
+					byte*		ScratchPad;
+
+					void*		MainSection;
+					void*		VideoSection;
+					void*		ScratchPadSection;
+					void*		FaultHandler;
+
+					byte*		Gaps[ FASTMEMORYGAPS ];
+				} FastMemory;
+
+#pragma unmanaged
+				bool FastMemoryCreate( FastMemory* memory );
+				void FastMemoryDestroy( FastMemory* memory );
+#pragma managed
+
+			}
+		}
+	}
+}
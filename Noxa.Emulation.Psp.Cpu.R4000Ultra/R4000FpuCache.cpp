@@ -0,0 +1,237 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#include "StdAfx.h"
+#include "R4000FpuCache.h"
+#include "R4000Generator.h"
+#include "R4000Ctx.h"
+
+using namespace System::Diagnostics;
+using namespace Noxa::Emulation::Psp;
+using namespace Noxa::Emulation::Psp::CodeGen;
+using namespace Noxa::Emulation::Psp::Cpu;
+
+R4000FpuCache::R4000FpuCache( R4000Generator* generator )
+{
+	_gen = generator;
+	this->Reset( NULL, false );
+}
+
+void R4000FpuCache::Reset( void* ctxPointer, bool enabled )
+{
+	_ctx = ( int )ctxPointer;
+	_enabled = enabled;
+	_tick = 0;
+
+	for( int n = 0; n < FPUCACHESLOTS; n++ )
+	{
+		_slots[ n ].Register = -1;
+		_slots[ n ].Dirty = false;
+		_slots[ n ].Locked = false;
+		_slots[ n ].LastUse = 0;
+	}
+}
+
+const OperandXMMREG& R4000FpuCache::HostRegister( int slot )
+{
+	switch( slot )
+	{
+	default:
+	case 0:
+		return _gen->xmm2;
+	case 1:
+		return _gen->xmm3;
+	case 2:
+		return _gen->xmm4;
+	case 3:
+		return _gen->xmm5;
+	case 4:
+		return _gen->xmm6;
+	case 5:
+		return _gen->xmm7;
+	}
+}
+
+OperandXMM32 R4000FpuCache::Memory( int reg )
+{
+	return OperandXMM32( _gen->dword_ptr[ _ctx + CTXCP1REGS + ( reg << 4 ) ] );
+}
+
+int R4000FpuCache::Find( int reg )
+{
+	for( int n = 0; n < FPUCACHESLOTS; n++ )
+	{
+		if( _slots[ n ].Register == reg )
+			return n;
+	}
+	return -1;
+}
+
+int R4000FpuCache::Allocate( int reg )
+{
+	// Prefer a free slot, otherwise evict the least recently used unlocked one
+	int slot = -1;
+	for( int n = 0; n < FPUCACHESLOTS; n++ )
+	{
+		if( _slots[ n ].Register == -1 )
+		{
+			slot = n;
+			break;
+		}
+		if( _slots[ n ].Locked == true )
+			continue;
+		if( ( slot == -1 ) ||
+			( _slots[ n ].LastUse < _slots[ slot ].LastUse ) )
+			slot = n;
+	}
+
+	// An instruction never touches more registers than we have slots
+	Debug::Assert( slot != -1 );
+
+	FpuCacheSlot* s = &_slots[ slot ];
+	if( ( s->Register != -1 ) &&
+		( s->Dirty == true ) )
+		_gen->movss( Memory( s->Register ), HostRegister( slot ) );
+
+	s->Register = reg;
+	s->Dirty = false;
+	s->Locked = false;
+	return slot;
+}
+
+OperandXMM32 R4000FpuCache::Read( int reg )
+{
+	if( _enabled == false )
+		return Memory( reg );
+
+	int slot = this->Find( reg );
+	if( slot == -1 )
+	{
+		slot = this->Allocate( reg );
+		_gen->movss( HostRegister( slot ), Memory( reg ) );
+	}
+
+	_slots[ slot ].Locked = true;
+	_slots[ slot ].LastUse = ++_tick;
+	return OperandXMM32( HostRegister( slot ) );
+}
+
+OperandXMM32 R4000FpuCache::Write( int reg )
+{
+	if( _enabled == false )
+		return Memory( reg );
+
+	int slot = this->Find( reg );
+	if( slot == -1 )
+		slot = this->Allocate( reg );
+
+	_slots[ slot ].Dirty = true;
+	_slots[ slot ].Locked = true;
+	_slots[ slot ].LastUse = ++_tick;
+	return OperandXMM32( HostRegister( slot ) );
+}
+
+void R4000FpuCache::Load( const OperandREG32& target, int reg )
+{
+	int slot = ( _enabled == true ) ? this->Find( reg ) : -1;
+	if( slot == -1 )
+	{
+		_gen->mov( target, _gen->dword_ptr[ _ctx + CTXCP1REGS + ( reg << 4 ) ] );
+		return;
+	}
+
+	_slots[ slot ].Locked = true;
+	_slots[ slot ].LastUse = ++_tick;
+	_gen->movd( target, HostRegister( slot ) );
+}
+
+void R4000FpuCache::Store( int reg, const OperandREG32& source )
+{
+	if( _enabled == false )
+	{
+		_gen->mov( _gen->dword_ptr[ _ctx + CTXCP1REGS + ( reg << 4 ) ], source );
+		return;
+	}
+
+	int slot = this->Find( reg );
+	if( slot == -1 )
+		slot = this->Allocate( reg );
+
+	_slots[ slot ].Dirty = true;
+	_slots[ slot ].Locked = true;
+	_slots[ slot ].LastUse = ++_tick;
+	_gen->movd( HostRegister( slot ), source );
+}
+
+void R4000FpuCache::Unlock()
+{
+	for( int n = 0; n < FPUCACHESLOTS; n++ )
+		_slots[ n ].Locked = false;
+}
+
+void R4000FpuCache::Flush()
+{
+	if( _enabled == false )
+		return;
+
+	for( int n = 0; n < FPUCACHESLOTS; n++ )
+	{
+		FpuCacheSlot* s = &_slots[ n ];
+		if( ( s->Register != -1 ) &&
+			( s->Dirty == true ) )
+			_gen->movss( Memory( s->Register ), HostRegister( n ) );
+
+		s->Register = -1;
+		s->Dirty = false;
+		s->Locked = false;
+	}
+}
+
+int R4000FpuCache::LiveCount()
+{
+	int count = 0;
+	for( int n = 0; n < FPUCACHESLOTS; n++ )
+	{
+		if( _slots[ n ].Register != -1 )
+			count++;
+	}
+	return count;
+}
+
+void R4000FpuCache::Preserve()
+{
+	int count = this->LiveCount();
+	if( count == 0 )
+		return;
+
+	// Clean slots have to be saved too - nothing about them changes on the other path
+	_gen->sub( _gen->esp, count << 2 );
+	int offset = 0;
+	for( int n = 0; n < FPUCACHESLOTS; n++ )
+	{
+		if( _slots[ n ].Register == -1 )
+			continue;
+		_gen->movss( _gen->dword_ptr[ _gen->esp + offset ], HostRegister( n ) );
+		offset += 4;
+	}
+}
+
+void R4000FpuCache::Restore()
+{
+	int count = this->LiveCount();
+	if( count == 0 )
+		return;
+
+	int offset = 0;
+	for( int n = 0; n < FPUCACHESLOTS; n++ )
+	{
+		if( _slots[ n ].Register == -1 )
+			continue;
+		_gen->movss( HostRegister( n ), _gen->dword_ptr[ _gen->esp + offset ] );
+		offset += 4;
+	}
+	_gen->add( _gen->esp, count << 2 );
+}
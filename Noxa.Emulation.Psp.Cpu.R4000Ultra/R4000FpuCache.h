@@ -0,0 +1,85 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "CodeGenerator.h"
+
+using namespace Noxa::Emulation::Psp;
+using namespace Noxa::Emulation::Psp::CodeGen;
+
+// Number of host registers (XMM2-XMM7) that COP1 registers can live in - XMM0/XMM1 are left as scratch
+#define FPUCACHESLOTS	6
+
+namespace Noxa {
+	namespace Emulation {
+		namespace Psp {
+			namespace Cpu {
+
+				class R4000Generator;
+
+				typedef struct FpuCacheSlot_t
+				{
+					int			Register;		// COP1 register in this slot, or -1 if free
+					bool		Dirty;			// Host copy is newer than the one in the ctx
+					bool		Locked;			// In use by the current instruction - don't evict
+					int			LastUse;		// For LRU eviction
+				} FpuCacheSlot;
+
+				/* Per-block COP1 register allocator - the XMM version of R4000RegisterCache.
+				   Only the low lane of each slot is used, and values are kept as raw bits so W format
+				   registers can live in them too. XMM registers are not preserved across calls, so the
+				   builder has to Flush before any instruction that R4000Generator::KeepsFpuCache rejects,
+				   and code that calls out on a cold path has to wrap the call in Preserve/Restore.
+				*/
+				class R4000FpuCache
+				{
+				protected:
+					R4000Generator*		_gen;
+					int					_ctx;
+					bool				_enabled;
+
+					FpuCacheSlot		_slots[ FPUCACHESLOTS ];
+					int					_tick;
+
+				public:
+					R4000FpuCache( R4000Generator* generator );
+
+					void Reset( void* ctxPointer, bool enabled );
+					bool IsEnabled(){ return _enabled; }
+
+					// Operand holding the current value of reg
+					OperandXMM32 Read( int reg );
+					// Operand that will receive a new value of reg (old value not loaded)
+					OperandXMM32 Write( int reg );
+
+					// Moves the bits of reg in to a GPR, without caching it if it isn't already
+					void Load( const OperandREG32& target, int reg );
+					// Sets reg to the bits in a GPR
+					void Store( int reg, const OperandREG32& source );
+
+					// Called after each instruction so its registers can be evicted again
+					void Unlock();
+
+					// Writes back dirty registers and drops all mappings
+					void Flush();
+
+					// Saves/restores the live slots on the stack around a call - emits nothing if there are none
+					void Preserve();
+					void Restore();
+
+				protected:
+					int Find( int reg );
+					int Allocate( int reg );
+					int LiveCount();
+					const OperandXMMREG& HostRegister( int slot );
+					OperandXMM32 Memory( int reg );
+				};
+
+			}
+		}
+	}
+}
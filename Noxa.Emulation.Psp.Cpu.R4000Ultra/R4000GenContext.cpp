@@ -16,16 +16,26 @@ using namespace Noxa::Emulation::Psp::Cpu;
 R4000GenContext::R4000GenContext( R4000Generator* generator, NativeMemorySystem* memory )
 {
 	Generator = generator;
+	Registers = new R4000RegisterCache( generator );
+	FpuRegisters = new R4000FpuCache( generator );
+	Analysis = new InstructionInfo[ MAXANALYSISLENGTH ];
 
 	MainMemory = memory->MainMemory;
 	FrameBuffer = memory->VideoMemory;
 	ScratchPad = memory->ScratchPad;
+	FastMemory = NULL;
 
 	BranchLabels = gcnew Dictionary<int, LabelMarker^>();
+	SegmentStarts = gcnew array<int>( MAXSEGMENTS );
+	SegmentEnds = gcnew array<int>( MAXSEGMENTS );
+	VfpuPrefixes = gcnew array<int>( 3 );
 }
 
 R4000GenContext::~R4000GenContext()
 {
+	SAFEDELETE( Registers );
+	SAFEDELETE( FpuRegisters );
+	SAFEDELETEA( Analysis );
 	SAFEDELETE( Generator );
 }
 
@@ -33,16 +43,27 @@ void R4000GenContext::Reset( int startAddress )
 {
 	StartAddress = startAddress;
 	EndAddress = startAddress;
+	SegmentCount = 0;
+	SegmentAddress = startAddress;
 
 	UpdatePC = false;
 	UseSyscalls = false;
 
+	// Builders opt in to register caching once they are ready to emit
+	Registers->Reset( CtxPointer, false );
+	FpuRegisters->Reset( CtxPointer, false );
+	AnalysisValid = false;
+	CurrentInfo = NULL;
+
 	BranchLabels->Clear();
 	LastBranchTarget = 0;
 	InDelay = false;
 	BranchTarget = nullptr;
 	JumpTarget = 0;
 	JumpRegister = 0;
+	VfpuPrefixesKnown = 0;
+	VfpuPrefixesDirty = 0;
+	Cp1ConditionAddress = 0;
 }
 
 void R4000GenContext::DefineBranchTarget( int address )
@@ -8,6 +8,9 @@
 
 #include <string>
 #include "Label.h"
+#include "R4000RegisterCache.h"
+#include "R4000FpuCache.h"
+#include "R4000Analysis.h"
 
 using namespace System;
 using namespace System::Collections::Generic;
@@ -15,6 +18,9 @@ using namespace System::Diagnostics;
 using namespace Noxa::Emulation::Psp;
 using namespace Noxa::Emulation::Psp::CodeGen;
 
+// Maximum number of runs of guest code in a block - only traces have more than one (see SUPERBLOCKS)
+#define MAXSEGMENTS		8
+
 namespace Noxa {
 	namespace Emulation {
 		namespace Psp {
@@ -56,14 +62,32 @@ namespace Noxa {
 					~R4000GenContext();
 
 					R4000Generator*		Generator;
+					R4000RegisterCache*	Registers;
+					R4000FpuCache*		FpuRegisters;
+
+					// Per-instruction results of the analysis pass - only valid when AnalysisValid is set
+					InstructionInfo*	Analysis;
+					bool				AnalysisValid;
+					// Info for the instruction being emitted, or NULL if there is none
+					InstructionInfo*	CurrentInfo;
 
 					byte*				MainMemory;
 					byte*				FrameBuffer;
 					byte*				ScratchPad;
+					// Base of the fast memory window, or NULL if accesses need range checks
+					byte*				FastMemory;
 
 					int					StartAddress;
 					int					EndAddress;
 
+					// A trace is built from more than one run of guest code, each ending on the delay slot of
+					// a J it followed - the runs before the last one are kept here, and the last one goes from
+					// SegmentAddress to EndAddress
+					array<int>^			SegmentStarts;
+					array<int>^			SegmentEnds;
+					int					SegmentCount;
+					int					SegmentAddress;
+
 					bool				UpdatePC;
 					bool				UseSyscalls;
 					bool				LastSyscallStateless;
@@ -79,12 +103,57 @@ namespace Noxa {
 
 					void*				CtxPointer;
 
+					// VPFX state as of the instruction being emitted - bit n of VfpuPrefixesKnown is set when the
+					// prefix is known to be VfpuPrefixes[ n ] (indexed by VfpuPfx) at that point in the block, and
+					// bit n of VfpuPrefixesDirty when the ctx may not hold it yet (see EmitVfpuPrefixStores)
+					array<int>^			VfpuPrefixes;
+					int					VfpuPrefixesKnown;
+					int					VfpuPrefixesDirty;
+
+					// Address of the instruction that can find the COP1 condition bit (0 or 1) in EBX, left
+					// there by the c.cond right before it (see FCOMPARE), or 0
+					int					Cp1ConditionAddress;
+
 					void Reset( int startAddress );
 
 					__inline bool IsBranchLocal( int address )
 					{
-						return( ( address >= StartAddress ) &&
-							( address <= EndAddress ) );
+						if( ( address >= SegmentAddress ) &&
+							( address <= EndAddress ) )
+							return true;
+						for( int n = 0; n < SegmentCount; n++ )
+						{
+							if( ( address >= SegmentStarts[ n ] ) &&
+								( address <= SegmentEnds[ n ] ) )
+								return true;
+						}
+						return false;
+					}
+
+					// First address of the run segment is in (the last run when segment == SegmentCount)
+					__inline int SegmentStart( int segment )
+					{
+						return ( segment < SegmentCount ) ? SegmentStarts[ segment ] : SegmentAddress;
+					}
+
+					// Number of instructions in a run, delay slot included
+					__inline int SegmentLength( int segment )
+					{
+						int end = ( segment < SegmentCount ) ? SegmentEnds[ segment ] : EndAddress;
+						return ( ( end - SegmentStart( segment ) ) >> 2 ) + 1;
+					}
+
+					// Address of the instruction generated after the one at address - segment is the index of
+					// the run it is in, and is moved on when the run ends
+					__inline int NextAddress( int address, int* segment )
+					{
+						if( ( *segment < SegmentCount ) &&
+							( address == SegmentEnds[ *segment ] ) )
+						{
+							( *segment )++;
+							return ( *segment < SegmentCount ) ? SegmentStarts[ *segment ] : SegmentAddress;
+						}
+						return address + 4;
 					}
 
 					void DefineBranchTarget( int address );
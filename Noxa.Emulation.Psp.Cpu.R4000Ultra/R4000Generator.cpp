@@ -22,3 +22,9 @@ R4000Generator::R4000Generator()
 {
 	Setup();
 }
+
+R4000Generator::R4000Generator( int storageBlockSize )
+	: CodeGenerator( 1024 * 128, storageBlockSize )
+{
+	Setup();
+}
@@ -31,6 +31,11 @@ using namespace Noxa::Emulation::Psp::CodeGen;
 #define XMM0 g->xmm0
 #define XMM1 g->xmm1
 #define XMM2 g->xmm2
+#define XMM3 g->xmm3
+#define XMM4 g->xmm4
+#define XMM5 g->xmm5
+#define XMM6 g->xmm6
+#define XMM7 g->xmm7
 
 #define ZE( x ) ((int)(uint)x)
 #define SE( x ) ((int)(short)x)
@@ -50,6 +55,16 @@ using namespace Noxa::Emulation::Psp::CodeGen;
 #define MSTOPFLAG( xr )			g->dword_ptr[ xr + CTXSTOPFLAG ]
 #define MINDELAY( xr )			g->dword_ptr[ xr + CTXINDELAY ]
 #define MNEXTPC( xr )			g->dword_ptr[ xr + CTXNEXTPC ]
+#define MBUDGET( xr )			g->dword_ptr[ xr + CTXBUDGET ]
+
+// Register cache operands - only valid in instructions flagged in the Table*_c tables
+#define RREG( r )				context->Registers->Read( r )
+#define WREG( r )				context->Registers->Write( r )
+#define RWREG( r )				context->Registers->Modify( r )
+
+// FPU cache operands - only valid in instructions R4000Generator::KeepsFpuCache accepts
+#define RFPR( r )				context->FpuRegisters->Read( r )
+#define WFPR( r )				context->FpuRegisters->Write( r )
 
 namespace Noxa {
 	namespace Emulation {
@@ -67,6 +82,7 @@ namespace Noxa {
 				{
 				public:
 					R4000Generator();
+					R4000Generator( int storageBlockSize );
 					void Setup();
 
 				public:
@@ -87,6 +103,15 @@ namespace Noxa {
 					static const char* TableCopA_n[ 64 ];
 					static const char* TableCopB_n[ 64 ];
 					static const char* TableFpu_n[ 64 ];
+
+					// true if the instruction uses RREG/WREG instead of going to the ctx directly
+					static bool TableR_c[ 64 ];
+					static bool TableI_c[ 64 ];
+					static bool TableSpecial3_c[ 64 ];
+
+					static bool UsesRegisterCache( uint code );
+					// true if XMM registers held by the FPU cache survive the instruction
+					static bool KeepsFpuCache( uint code );
 				};
 
 			}
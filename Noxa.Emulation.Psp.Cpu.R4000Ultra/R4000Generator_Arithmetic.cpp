@@ -33,12 +33,12 @@ GenerationResult SLL( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rt ) );
 		if( ( shamt >= 0 ) && ( shamt < 32 ) )
 			g->shl( EAX, shamt );
 		else
 			Debug::Assert( false );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -53,12 +53,12 @@ GenerationResult SRL( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rt ) );
 		if( ( shamt >= 0 ) && ( shamt < 32 ) )
 			g->shr( EAX, shamt );
 		else
 			Debug::Assert( false );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -73,12 +73,12 @@ GenerationResult SRA( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rt ) );
 		if( ( shamt >= 0 ) && ( shamt < 32 ) )
 			g->sar( EAX, shamt );
 		else
 			Debug::Assert( false );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -93,8 +93,8 @@ GenerationResult SLLV( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rt ) );
-		g->mov( EBX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rt ) );
+		g->mov( EBX, RREG( rs ) );
 		g->and( EBX, 0x1F );
 		g->mov( CL, BL );
 #ifdef SAFEARITHMETIC
@@ -109,7 +109,7 @@ GenerationResult SLLV( R4000GenContext^ context, int pass, int address, uint cod
 #ifdef SAFEARITHMETIC
 		g->label( skip );
 #endif
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -124,8 +124,8 @@ GenerationResult SRLV( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rt ) );
-		g->mov( EBX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rt ) );
+		g->mov( EBX, RREG( rs ) );
 		g->and( EBX, 0x1F );
 		g->mov( CL, BL );
 #ifdef SAFEARITHMETIC
@@ -140,7 +140,7 @@ GenerationResult SRLV( R4000GenContext^ context, int pass, int address, uint cod
 #ifdef SAFEARITHMETIC
 		g->label( skip );
 #endif
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -155,8 +155,8 @@ GenerationResult SRAV( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rt ) );
-		g->mov( EBX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rt ) );
+		g->mov( EBX, RREG( rs ) );
 		g->and( EBX, 0x1F );
 		g->mov( CL, BL );
 #ifdef SAFEARITHMETIC
@@ -171,7 +171,7 @@ GenerationResult SRAV( R4000GenContext^ context, int pass, int address, uint cod
 #ifdef SAFEARITHMETIC
 		g->label( skip );
 #endif
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -186,12 +186,15 @@ GenerationResult MOVZ( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
+		// Everything must be in the cache before the jump so both paths agree
 		Label* l = g->DefineLabel();
-		g->mov( EAX, MREG( CTX, rt ) );
+		OperandR_M32 source = RREG( rs );
+		OperandR_M32 dest = RWREG( rd );
+		g->mov( EAX, RREG( rt ) );
 		g->test( EAX, EAX ); // cmp EAX, 0
 		g->jne( l );
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( EAX, source );
+		g->mov( dest, EAX );
 		g->MarkLabel( l );
 	}
 	return GenerationResult::Success;
@@ -207,12 +210,15 @@ GenerationResult MOVN( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
+		// Everything must be in the cache before the jump so both paths agree
 		Label* l = g->DefineLabel();
-		g->mov( EAX, MREG( CTX, rt ) );
+		OperandR_M32 source = RREG( rs );
+		OperandR_M32 dest = RWREG( rd );
+		g->mov( EAX, RREG( rt ) );
 		g->test( EAX, EAX ); // cmp EAX, 0
 		g->je( l );
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( EAX, source );
+		g->mov( dest, EAX );
 		g->MarkLabel( l );
 	}
 	return GenerationResult::Success;
@@ -229,7 +235,7 @@ GenerationResult MFHI( R4000GenContext^ context, int pass, int address, uint cod
 	else if( pass == 1 )
 	{
 		g->mov( EAX, MHI( CTX ) );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -241,7 +247,7 @@ GenerationResult MTHI( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rs ) );
 		g->mov( MHI( CTX ), EAX );
 	}
 	return GenerationResult::Success;
@@ -258,7 +264,7 @@ GenerationResult MFLO( R4000GenContext^ context, int pass, int address, uint cod
 	else if( pass == 1 )
 	{
 		g->mov( EAX, MLO( CTX ) );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -270,7 +276,7 @@ GenerationResult MTLO( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rs ) );
 		g->mov( MLO( CTX ), EAX );
 	}
 	return GenerationResult::Success;
@@ -283,8 +289,8 @@ GenerationResult MULT( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->imul( MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rs ) );
+		g->imul( RREG( rt ) );
 		g->mov( MLO( CTX ), EAX );
 		g->mov( MHI( CTX ), EDX );
 	}
@@ -298,8 +304,8 @@ GenerationResult MULTU( R4000GenContext^ context, int pass, int address, uint co
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->mul( MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rs ) );
+		g->mul( RREG( rt ) );
 		g->mov( MLO( CTX ), EAX );
 		g->mov( MHI( CTX ), EDX );
 	}
@@ -308,14 +314,17 @@ GenerationResult MULTU( R4000GenContext^ context, int pass, int address, uint co
 
 GenerationResult MUL( R4000GenContext^ context, int pass, int address, uint code, byte opcode, byte rs, byte rt, byte rd, byte shamt, byte function )
 {
+	if( rd == 0 )
+		return GenerationResult::Success;
+
 	if( pass == 0 )
 	{
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->imul( MREG( CTX, rt ) );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( EAX, RREG( rs ) );
+		g->imul( RREG( rt ) );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -327,8 +336,8 @@ GenerationResult MADD( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->imul( MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rs ) );
+		g->imul( RREG( rt ) );
 		g->add( MLO( CTX ), EAX );
 		g->adc( MHI( CTX ), EDX );	// add with carry for 64 bit add
 	}
@@ -342,8 +351,8 @@ GenerationResult MADDU( R4000GenContext^ context, int pass, int address, uint co
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->mul( MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rs ) );
+		g->mul( RREG( rt ) );
 		g->add( MLO( CTX ), EAX );
 		g->adc( MHI( CTX ), EDX );	// add with carry for 64 bit add
 	}
@@ -357,8 +366,8 @@ GenerationResult MSUB( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->imul( MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rs ) );
+		g->imul( RREG( rt ) );
 		g->sub( MLO( CTX ), EAX );
 		g->sbb( MHI( CTX ), EDX );
 	}
@@ -372,8 +381,8 @@ GenerationResult MSUBU( R4000GenContext^ context, int pass, int address, uint co
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->mul( MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rs ) );
+		g->mul( RREG( rt ) );
 		g->sub( MLO( CTX ), EAX );
 		g->sbb( MHI( CTX ), EDX );
 	}
@@ -387,9 +396,9 @@ GenerationResult DIV( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rs ) );
 		g->cdq();						// Sign extend EAX in to EDX
-		g->idiv( MREG( CTX, rt ) );
+		g->idiv( RREG( rt ) );
 		g->mov( MLO( CTX ), EAX );
 		g->mov( MHI( CTX ), EDX );
 	}
@@ -403,9 +412,9 @@ GenerationResult DIVU( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rs ) );
 		g->xor( EDX, EDX );
-		g->div( MREG( CTX, rt ) );
+		g->div( RREG( rt ) );
 		g->mov( MLO( CTX ), EAX );
 		g->mov( MHI( CTX ), EDX );
 	}
@@ -422,9 +431,9 @@ GenerationResult ADD( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->add( EAX, MREG( CTX, rt ) );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( EAX, RREG( rs ) );
+		g->add( EAX, RREG( rt ) );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -439,9 +448,9 @@ GenerationResult ADDU( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->add( EAX, MREG( CTX, rt ) );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( EAX, RREG( rs ) );
+		g->add( EAX, RREG( rt ) );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -456,9 +465,9 @@ GenerationResult SUB( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->sub( EAX, MREG( CTX, rt ) );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( EAX, RREG( rs ) );
+		g->sub( EAX, RREG( rt ) );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -473,9 +482,9 @@ GenerationResult SUBU( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->sub( EAX, MREG( CTX, rt ) );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( EAX, RREG( rs ) );
+		g->sub( EAX, RREG( rt ) );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -490,9 +499,9 @@ GenerationResult AND( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->and( EAX, MREG( CTX, rt ) );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( EAX, RREG( rs ) );
+		g->and( EAX, RREG( rt ) );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -507,9 +516,9 @@ GenerationResult OR( R4000GenContext^ context, int pass, int address, uint code,
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->or( EAX, MREG( CTX, rt ) );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( EAX, RREG( rs ) );
+		g->or( EAX, RREG( rt ) );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -524,9 +533,9 @@ GenerationResult XOR( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->xor( EAX, MREG( CTX, rt ) );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( EAX, RREG( rs ) );
+		g->xor( EAX, RREG( rt ) );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -541,10 +550,10 @@ GenerationResult NOR( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->or( EAX, MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rs ) );
+		g->or( EAX, RREG( rt ) );
 		g->not( EAX );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -559,11 +568,11 @@ GenerationResult SLT( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->cmp( EAX, MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rs ) );
+		g->cmp( EAX, RREG( rt ) );
 		g->setl( BL );
 		g->movzx( EBX, BL );
-		g->mov( MREG( CTX, rd ), EBX );
+		g->mov( WREG( rd ), EBX );
 	}
 	return GenerationResult::Success;
 }
@@ -578,12 +587,12 @@ GenerationResult SLTU( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->cmp( EAX, MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rs ) );
+		g->cmp( EAX, RREG( rt ) );
 		g->setb( BL );
 		//g->setl( BL );
 		g->movzx( EBX, BL );
-		g->mov( MREG( CTX, rd ), EBX );
+		g->mov( WREG( rd ), EBX );
 	}
 	return GenerationResult::Success;
 }
@@ -598,11 +607,11 @@ GenerationResult MAX( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->mov( EBX, MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rs ) );
+		g->mov( EBX, RREG( rt ) );
 		g->cmp( EAX, EBX );
 		g->cmovl( EAX, EBX );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -617,11 +626,11 @@ GenerationResult MIN( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		g->mov( EBX, MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rs ) );
+		g->mov( EBX, RREG( rt ) );
 		g->cmp( EAX, EBX );
 		g->cmovg( EAX, EBX );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -636,9 +645,9 @@ GenerationResult ADDI( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rs ) );
 		g->add( EAX, SE( imm ) );
-		g->mov( MREG( CTX, rt ), EAX );
+		g->mov( WREG( rt ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -653,9 +662,9 @@ GenerationResult ADDIU( R4000GenContext^ context, int pass, int address, uint co
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rs ) );
 		g->add( EAX, SE( imm ) );
-		g->mov( MREG( CTX, rt ), EAX );
+		g->mov( WREG( rt ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -670,11 +679,11 @@ GenerationResult SLTI( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rs ) );
 		g->cmp( EAX, SE( imm ) );
 		g->setl( BL );
 		g->movzx( EBX, BL );
-		g->mov( MREG( CTX, rt ), EBX );
+		g->mov( WREG( rt ), EBX );
 	}
 	return GenerationResult::Success;
 }
@@ -689,12 +698,12 @@ GenerationResult SLTIU( R4000GenContext^ context, int pass, int address, uint co
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rs ) );
 		g->cmp( EAX, SE( imm ) );
 		g->setb( BL );
 		//g->setl( BL );
 		g->movzx( EBX, BL );
-		g->mov( MREG( CTX, rt ), EBX );
+		g->mov( WREG( rt ), EBX );
 	}
 	return GenerationResult::Success;
 }
@@ -709,9 +718,9 @@ GenerationResult ANDI( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rs ) );
 		g->and( EAX, ZE( imm ) );
-		g->mov( MREG( CTX, rt ), EAX );
+		g->mov( WREG( rt ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -726,9 +735,9 @@ GenerationResult ORI( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rs ) );
 		g->or( EAX, ZE( imm ) );
-		g->mov( MREG( CTX, rt ), EAX );
+		g->mov( WREG( rt ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -743,9 +752,9 @@ GenerationResult XORI( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rs ) );
 		g->xor( EAX, ZE( imm ) );
-		g->mov( MREG( CTX, rt ), EAX );
+		g->mov( WREG( rt ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -760,7 +769,7 @@ GenerationResult LUI( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( MREG( CTX, rt ), ( int )( ( uint )imm << 16 ) & 0xFFFF0000 );
+		g->mov( WREG( rt ), ( int )( ( uint )imm << 16 ) & 0xFFFF0000 );
 	}
 	return GenerationResult::Success;
 }
@@ -790,10 +799,10 @@ GenerationResult EXT( R4000GenContext^ context, int pass, int address, uint code
 
 		// value =>> pos
 		// value &= bitfield
-		g->mov( EAX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rs ) );
 		g->shr( EAX, function );
 		g->and( EAX, bitmask );
-		g->mov( MREG( CTX, rt ), EAX );
+		g->mov( WREG( rt ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -826,13 +835,13 @@ GenerationResult INS( R4000GenContext^ context, int pass, int address, uint code
 		int rtmask = ( int )bittemp;
 		rtmask = ~rtmask;
 
-		g->mov( EAX, MREG( CTX, rs ) );
+		g->mov( EAX, RREG( rs ) );
 		g->and( EAX, rsmask );
 		g->shl( EAX, function );
-		g->mov( EBX, MREG( CTX, rt ) );
+		g->mov( EBX, RREG( rt ) );
 		g->and( EBX, rtmask );
 		g->or( EAX, EBX );
-		g->mov( MREG( CTX, rt ), EAX );
+		g->mov( WREG( rt ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -847,9 +856,9 @@ GenerationResult SEB( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rt ) );
 		g->movsx( EAX, AL );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -864,9 +873,9 @@ GenerationResult SEH( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rt ) );
+		g->mov( EAX, RREG( rt ) );
 		g->movsx( EAX, AX );
-		g->mov( MREG( CTX, rd ), EAX );
+		g->mov( WREG( rd ), EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -10,6 +10,7 @@
 #include "R4000Core.h"
 #include "R4000Memory.h"
 #include "R4000GenContext.h"
+#include "R4000Cache.h"
 
 #include "CodeGenerator.h"
 
@@ -20,6 +21,26 @@ using namespace Noxa::Emulation::Psp::Cpu;
 
 #define g context->Generator
 
+#ifdef RETURNSTACK
+extern ReturnLink* _returnStack[ RETURNSTACKSIZE ];
+extern int _returnStackTop;
+
+// Pushes the link for the call's return address - popped by JR $ra (see GenerateTail)
+void EmitReturnPush( R4000GenContext^ context, int returnAddress )
+{
+	ReturnLink* link = R4000Cpu::GlobalCpu->_codeCache->AddReturnLink( returnAddress );
+	if( link == NULL )
+		return;
+
+	g->mov( EAX, g->dword_ptr[ &_returnStackTop ] );
+	g->add( EAX, 1 );
+	g->and( EAX, RETURNSTACKSIZE - 1 );
+	g->mov( g->dword_ptr[ &_returnStackTop ], EAX );
+	g->Pointer();
+	g->mov( g->dword_ptr[ EAX * 4 + ( int )_returnStack ], ( uint )link );
+}
+#endif
+
 GenerationResult JR( R4000GenContext^ context, int pass, int address, uint code, byte opcode, byte rs, byte rt, byte rd, byte shamt, byte function )
 {
 	context->JumpTarget = 0x0;
@@ -50,6 +71,10 @@ GenerationResult JALR( R4000GenContext^ context, int pass, int address, uint cod
 	else if( pass == 1 )
 	{
 		g->mov( MREG( CTX, rd ), address + 4 );
+#ifdef RETURNSTACK
+		if( rd == 31 )
+			EmitReturnPush( context, address + 4 );
+#endif
 		g->mov( EAX, MREG( CTX, rs ) );
 		g->mov( MPC( CTX ), EAX );
 		g->mov( MPCVALID( CTX ), 1 );
@@ -90,6 +115,9 @@ GenerationResult JAL( R4000GenContext^ context, int pass, int address, uint code
 	else if( pass == 1 )
 	{
 		g->mov( MREG( CTX, 31 ), address + 4 );
+#ifdef RETURNSTACK
+		EmitReturnPush( context, address + 4 );
+#endif
 		g->mov( MPC( CTX ), pc );
 		g->mov( MPCVALID( CTX ), 1 );
 	}
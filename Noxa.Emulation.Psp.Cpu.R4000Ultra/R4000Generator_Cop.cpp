@@ -21,6 +21,24 @@ using namespace Noxa::Emulation::Psp::Cpu;
 
 #define g context->Generator
 
+// EBX = 1 if the COPz condition bit is set, 0 if not
+void EmitCopCondition( R4000GenContext^ context, int address, byte opcode )
+{
+	// A c.cond right before us already left it there
+	if( ( opcode == 1 ) &&
+		( context->Cp1ConditionAddress == address - 4 ) )
+		return;
+
+	if( opcode == 1 )
+		g->mov( EAX, MCP1CONDBIT( CTX ) );
+	else if( opcode == 2 )
+		g->mov( EAX, MCP2CONDBIT( CTX ) );
+	// EAX = >=1 if cond true, 0 if cond false
+	g->xor( EBX, EBX );
+	g->cmp( EAX, 1 );
+	g->setge( BL );
+}
+
 GenerationResult BCzF( R4000GenContext^ context, int pass, int address, uint code, byte opcode, byte rs, byte rt, ushort imm )
 {
 	int target = address + ( SE( imm ) << 2 );
@@ -37,15 +55,7 @@ GenerationResult BCzF( R4000GenContext^ context, int pass, int address, uint cod
 		Debug::Assert( targetLabel != nullptr );
 		context->BranchTarget = targetLabel;
 
-		if( opcode == 1 )
-			g->mov( EAX, MCP1CONDBIT( CTX ) );
-		else if( opcode == 2 )
-			g->mov( EAX, MCP2CONDBIT( CTX ) );
-		// EAX = >=1 if cond true, 0 if cond false
-		g->xor( EBX, EBX );
-		g->cmp( EAX, 1 );
-		g->setge( BL );
-		// EBX = 1 if >=1, 0 if 0
+		EmitCopCondition( context, address, opcode );
 		g->xor( EBX, 0x1 ); // <- flip, as we are F
 		g->mov( MPCVALID( CTX ), EBX );
 	}
@@ -68,15 +78,7 @@ GenerationResult BCzFL( R4000GenContext^ context, int pass, int address, uint co
 		Debug::Assert( targetLabel != nullptr );
 		context->BranchTarget = targetLabel;
 
-		if( opcode == 1 )
-			g->mov( EAX, MCP1CONDBIT( CTX ) );
-		else if( opcode == 2 )
-			g->mov( EAX, MCP2CONDBIT( CTX ) );
-		// EAX = >=1 if cond true, 0 if cond false
-		g->xor( EBX, EBX );
-		g->cmp( EAX, 1 );
-		g->setge( BL );
-		// EBX = 1 if >=1, 0 if 0
+		EmitCopCondition( context, address, opcode );
 		g->xor( EBX, 0x1 ); // <- flip, as we are F
 		g->mov( MPCVALID( CTX ), EBX );
 		g->xor( EBX, 0x1 ); // nulldelay = !pcvalid
@@ -101,15 +103,7 @@ GenerationResult BCzT( R4000GenContext^ context, int pass, int address, uint cod
 		Debug::Assert( targetLabel != nullptr );
 		context->BranchTarget = targetLabel;
 
-		if( opcode == 1 )
-			g->mov( EAX, MCP1CONDBIT( CTX ) );
-		else if( opcode == 2 )
-			g->mov( EAX, MCP2CONDBIT( CTX ) );
-		// EAX = >=1 if cond true, 0 if cond false
-		g->xor( EBX, EBX );
-		g->cmp( EAX, 1 );
-		g->setge( BL );
-		// EBX = 1 if >=1, 0 if 0
+		EmitCopCondition( context, address, opcode );
 		g->mov( MPCVALID( CTX ), EBX );
 	}
 	return GenerationResult::Branch;
@@ -131,15 +125,7 @@ GenerationResult BCzTL( R4000GenContext^ context, int pass, int address, uint co
 		Debug::Assert( targetLabel != nullptr );
 		context->BranchTarget = targetLabel;
 
-		if( opcode == 1 )
-			g->mov( EAX, MCP1CONDBIT( CTX ) );
-		else if( opcode == 2 )
-			g->mov( EAX, MCP2CONDBIT( CTX ) );
-		// EAX = >=1 if cond true, 0 if cond false
-		g->xor( EBX, EBX );
-		g->cmp( EAX, 1 );
-		g->setge( BL );
-		// EBX = 1 if >=1, 0 if 0
+		EmitCopCondition( context, address, opcode );
 		g->mov( MPCVALID( CTX ), EBX );
 		g->xor( EBX, 0x1 ); // nulldelay = !pcvalid
 		g->mov( MNULLDELAY( CTX ), EBX );
@@ -160,7 +146,7 @@ GenerationResult MFCz( R4000GenContext^ context, int pass, int address, uint cod
 	{
 		if( opcode == 1 )
 		{
-			g->mov( EAX, MCP1REG( CTX, rs, 0 ) );
+			context->FpuRegisters->Load( EAX, rs );
 			g->mov( MREG( CTX, rt ), EAX );
 		}
 		else
@@ -183,7 +169,7 @@ GenerationResult MTCz( R4000GenContext^ context, int pass, int address, uint cod
 		if( opcode == 1 )
 		{
 			g->mov( EAX, MREG( CTX, rt ) );
-			g->mov( MCP1REG( CTX, rs, 0 ), EAX );
+			context->FpuRegisters->Store( rs, EAX );
 		}
 		else
 			/* nothing */;
@@ -27,15 +27,8 @@ using namespace Noxa::Emulation::Psp::Cpu;
 
 #define g context->Generator
 
-// W = int, S = float
-#define CONVERT( srcfmt, tgtfmt, r ) if( srcfmt != tgtfmt ){ \
-	if( tgtfmt == 0 ){ /* float */ } \
-	else if( tgtfmt == 4 ){ /* int */ } }
-
-// We have both an x86 and an SSE code path - because they weren't that hard, and
-// I couldn't find enough info to make a perf conclusion without doing my own tests
-// Define SSE to use the SSE set, else x87 is used
-#define SSE
+// Everything here is scalar SSE - operands come from RFPR/WFPR (so they may be XMM2-XMM7 or the ctx)
+// and XMM0/XMM1 are scratch. Nothing may call out, as the FPU cache would not survive it
 
 // This will, whenever the RC bits from MXCSR are used, ensure they
 // are set to the proper rounding mode for the operation that is about
@@ -43,30 +36,23 @@ using namespace Noxa::Emulation::Psp::Cpu;
 // we know that round even (RC=00) is not set coming in
 //#define SSE_ENSURERC
 
-// Some things may be faster w/ x87 - define this to try those
-// instead of SSE
-#define TRYFASTERX87
-
 // Try to prevent -0.0 and other weird cases
 //#define CAUTIOUSFPU
 
 // Add a bunch of checks for +/-inf, etc
 //#define DEBUGFPU
 
-// -- macro hacks
-#ifdef SSE
-#ifdef TRYFASTERX87
-#define SSEOPT
-#endif
-#endif
+// MXCSR rounding control
+#define MXCSRRCMASK		0x6000
+#define MXCSRRCNEAREST	0x0000
+#define MXCSRRCDOWN		0x2000
+#define MXCSRRCUP		0x4000
 
 #ifdef DEBUGFPU
 #define ASSERTXMM0VALID() { g->push( ( uint )address ); g->call( ( uint )&assertXmm0 ); g->add( ESP, 4 ); }
-#define ASSERTX87VALID() { g->push( ( uint )address ); g->call( ( uint )&assertFpu ); g->add( ESP, 4 ); }
 #define PRINTEAX() { g->push( EAX ); g->push( ( uint )address ); g->call( ( uint )&printEax ); g->add( ESP, 4 ); g->pop( EAX ); }
 #else
 #define ASSERTXMM0VALID()
-#define ASSERTX87VALID()
 #define PRINTEAX()
 #endif
 
@@ -88,19 +74,6 @@ void assertXmm0( int address )
 	Tracer::WriteLine( assertLine );
 #endif
 }
-void assertFpu( int address )
-{
-	// Check top of stack
-	float x;
-	uint y;
-	__asm fst [x];
-	__asm fst [y];
-	assert( _finite( x ) != 0 );
-#ifdef TRACE
-	sprintf_s( assertLine, 150, "fs(0)=%f (0x%0X)\r\n", x, y );
-	Tracer::WriteLine( assertLine );
-#endif
-}
 void printEax( int address, int eax )
 {
 	//assert( eax != 0x80000000 );
@@ -112,6 +85,24 @@ void printEax( int address, int eax )
 #pragma managed
 #endif
 
+// EAX = fs converted to an int with the given MXCSR rounding mode
+void EmitRoundedConversion( R4000GenContext^ context, byte fs, int rc )
+{
+	g->sub( ESP, 8 );
+	g->stmxcsr( g->dword_ptr[ ESP ] );
+	g->mov( EAX, g->dword_ptr[ ESP ] );
+	g->and( EAX, ~MXCSRRCMASK );
+	if( rc != MXCSRRCNEAREST )
+		g->or( EAX, rc );
+	g->mov( g->dword_ptr[ ESP + 4 ], EAX );
+	g->ldmxcsr( g->dword_ptr[ ESP + 4 ] );
+
+	g->cvtss2si( EAX, RFPR( fs ) );
+
+	g->ldmxcsr( g->dword_ptr[ ESP ] );
+	g->add( ESP, 8 );
+}
+
 GenerationResult FADD( R4000GenContext^ context, int pass, int address, uint code, byte fmt, byte fs, byte ft, byte fd, byte function )
 {
 	if( pass == 0 )
@@ -119,17 +110,10 @@ GenerationResult FADD( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-#ifdef SSE
-		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
-		g->addss( XMM0, MCP1REG( CTX, ft, fmt ) );
+		g->movss( XMM0, RFPR( fs ) );
+		g->addss( XMM0, RFPR( ft ) );
 		ASSERTXMM0VALID();
-		g->movss( MCP1REG( CTX, fd, fmt ), XMM0 );
-#else
-		g->mov( EAX, MCP1REG( CTX, fs, fmt ) );
-		g->mov( EBX, MCP1REG( CTX, ft, fmt ) );
-		// EAX = EAX + EBX
-		g->mov( MREG( CTX, fd ), EAX );
-#endif
+		g->movss( WFPR( fd ), XMM0 );
 	}
 	return GenerationResult::Success;
 }
@@ -141,17 +125,10 @@ GenerationResult FSUB( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-#ifdef SSE
-		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
-		g->subss( XMM0, MCP1REG( CTX, ft, fmt ) );
+		g->movss( XMM0, RFPR( fs ) );
+		g->subss( XMM0, RFPR( ft ) );
 		ASSERTXMM0VALID();
-		g->movss( MCP1REG( CTX, fd, fmt ), XMM0 );
-#else
-		g->mov( EAX, MCP1REG( CTX, fs, fmt ) );
-		g->mov( EBX, MCP1REG( CTX, ft, fmt ) );
-		// EAX = EAX - EBX
-		g->mov( MREG( CTX, fd ), EAX );
-#endif
+		g->movss( WFPR( fd ), XMM0 );
 	}
 	return GenerationResult::Success;
 }
@@ -163,48 +140,19 @@ GenerationResult FMUL( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-#ifdef SSE
-#if 0
-		// ultra super debug version
-		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
-		g->mulss( XMM0, MCP1REG( CTX, ft, fmt ) );
-		//ASSERTXMM0VALID();
-		g->movss( EAX, XMM0 );
-		//PRINTEAX();
-		g->cmp( EAX, 0x80000000 );
-		char xx[40];
-		sprintf_s( xx, 40, "fmul%0X", address );
-		g->jne( xx );
-		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
-		ASSERTXMM0VALID();
-		g->movss( XMM0, MCP1REG( CTX, ft, fmt ) );
-		ASSERTXMM0VALID();
-		//g->int3();
-		g->mov( EAX, 0 );
-		g->label( xx );
-		PRINTEAX();
-		g->mov( MCP1REG( CTX, fd, fmt ), EAX );
-#else
-		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
-		g->mulss( XMM0, MCP1REG( CTX, ft, fmt ) );
+		g->movss( XMM0, RFPR( fs ) );
+		g->mulss( XMM0, RFPR( ft ) );
 #ifdef CAUTIOUSFPU
 		// This extra code is for handling -0.0 cases
-		g->movss( EAX, XMM0 );
+		g->movd( EAX, XMM0 );
 		g->mov( EBX, 0 );
 		g->cmp( EAX, 0x80000000 );
 		g->cmove( EAX, EBX );
 		PRINTEAX();
-		g->mov( MCP1REG( CTX, fd, fmt ), EAX );
+		context->FpuRegisters->Store( fd, EAX );
 #else
 		ASSERTXMM0VALID();
-		g->movss( MCP1REG( CTX, fd, fmt ), XMM0 );
-#endif
-#endif
-#else
-		g->mov( EAX, MCP1REG( CTX, fs, fmt ) );
-		g->mov( EBX, MCP1REG( CTX, ft, fmt ) );
-		// EAX = EAX * EBX
-		g->mov( MREG( CTX, fd ), EAX );
+		g->movss( WFPR( fd ), XMM0 );
 #endif
 	}
 	return GenerationResult::Success;
@@ -217,32 +165,19 @@ GenerationResult FDIV( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-#ifdef SSE
-#ifdef DEBUGFPU
-		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
-		ASSERTXMM0VALID();
-		g->movss( XMM0, MCP1REG( CTX, ft, fmt ) );
-		ASSERTXMM0VALID();
-#endif
-		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
-		g->divss( XMM0, MCP1REG( CTX, ft, fmt ) );
+		g->movss( XMM0, RFPR( fs ) );
+		g->divss( XMM0, RFPR( ft ) );
 #ifdef CAUTIOUSFPU
 		// This extra code is for handling -0.0 cases
-		g->movss( EAX, XMM0 );
+		g->movd( EAX, XMM0 );
 		g->mov( EBX, 0 );
 		g->cmp( EAX, 0x80000000 );
 		g->cmove( EAX, EBX );
 		PRINTEAX();
-		g->mov( MCP1REG( CTX, fd, fmt ), EAX );
+		context->FpuRegisters->Store( fd, EAX );
 #else
 		ASSERTXMM0VALID();
-		g->movss( MCP1REG( CTX, fd, fmt ), XMM0 );
-#endif
-#else
-		g->mov( EAX, MCP1REG( CTX, fs, fmt ) );
-		g->mov( EBX, MCP1REG( CTX, ft, fmt ) );
-		// EAX = EAX / EBX
-		g->mov( MREG( CTX, fd ), EAX );
+		g->movss( WFPR( fd ), XMM0 );
 #endif
 	}
 	return GenerationResult::Success;
@@ -255,15 +190,9 @@ GenerationResult FSQRT( R4000GenContext^ context, int pass, int address, uint co
 	}
 	else if( pass == 1 )
 	{
-#ifdef SSE
-		g->sqrtss( XMM0, MCP1REG( CTX, fs, fmt ) );
+		g->sqrtss( XMM0, RFPR( fs ) );
 		ASSERTXMM0VALID();
-		g->movss( MCP1REG( CTX, fd, fmt ), XMM0 );
-#else
-		g->mov( EAX, MCP1REG( CTX, fs, fmt ) );
-		// EAX = sqrt( EAX )
-		g->mov( MREG( CTX, fd ), EAX );
-#endif
+		g->movss( WFPR( fd ), XMM0 );
 	}
 	return GenerationResult::Success;
 }
@@ -275,26 +204,10 @@ GenerationResult FABS( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		// TODO: faster fabs
-		g->fld( MCP1REG( CTX, fs, fmt ) );
-		g->fabs();
-		ASSERTX87VALID();
-		g->fstp( MREG( CTX, fd ) );
-
-		//*(((int *) &x) + 1) &= 0x7fffffff;
-
-//#ifdef SSE
-//		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
-//		g->movss( XMM1, 0 );
-//		g->cmpltss( XMM0, XMM1 );
-//		// XMM0 = FFFFFFFF iff XMM0 < 0
-//		//??
-//		g->movss( MCP1REG( CTX, fd, fmt ), XMM0 );
-//#else
-//		g->mov( EAX, MCP1REG( CTX, fs, fmt ) );
-//		// EAX = abs( EAX )
-//		g->mov( MREG( CTX, fd ), EAX );
-//#endif
+		// Just the sign bit, like the hardware
+		context->FpuRegisters->Load( EAX, fs );
+		g->and( EAX, 0x7FFFFFFF );
+		context->FpuRegisters->Store( fd, EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -306,15 +219,12 @@ GenerationResult FMOV( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MCP1REG( CTX, fs, fmt ) );
-		PRINTEAX();
-		g->mov( MCP1REG( CTX, fd, fmt ), EAX );
+		g->movss( XMM0, RFPR( fs ) );
+		g->movss( WFPR( fd ), XMM0 );
 	}
 	return GenerationResult::Success;
 }
 
-SSE_ALIGN float _negative1 = -1.0f;
-
 GenerationResult FNEG( R4000GenContext^ context, int pass, int address, uint code, byte fmt, byte fs, byte ft, byte fd, byte function )
 {
 	if( pass == 0 )
@@ -322,35 +232,19 @@ GenerationResult FNEG( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-#ifndef SSEOPT
+		context->FpuRegisters->Load( EAX, fs );
 #ifdef CAUTIOUSFPU
 		// Safe way (no -0.0)
-		char skip[20];
-		sprintf_s( skip, 20, "neg%0X", address );
-		g->mov( EAX, MCP1REG( CTX, fs, fmt ) );
-		g->movss( XMM0, EAX );
-		g->mov( EBX, 0 );
-		g->cmp( EAX, EBX );
-		g->je( skip );
-		g->movss( XMM1, g->dword_ptr[ &_negative1 ] );
-		g->mulss( XMM0, XMM1 );
-		ASSERTXMM0VALID();
-		g->label( skip );
-		g->movss( MCP1REG( CTX, fd, fmt ), XMM0 );
+		Label* skip = g->DefineLabel();
+		g->test( EAX, EAX );
+		g->jz( skip );
+		g->xor( EAX, 0x80000000 );
+		g->MarkLabel( skip );
 #else
-		// Fast way
-		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
-		g->movss( XMM1, g->dword_ptr[ &_negative1 ] );
-		g->mulss( XMM0, XMM1 );
-		ASSERTXMM0VALID();
-		g->movss( MCP1REG( CTX, fd, fmt ), XMM0 );
-#endif
-#else
-		g->fld( MCP1REG( CTX, fs, fmt ) );
-		g->fchs();
-		ASSERTX87VALID();
-		g->fstp( MCP1REG( CTX, fd, fmt ) );
+		g->xor( EAX, 0x80000000 );
 #endif
+		PRINTEAX();
+		context->FpuRegisters->Store( fd, EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -366,43 +260,18 @@ GenerationResult ROUNDW( R4000GenContext^ context, int pass, int address, uint c
 	}
 	else if( pass == 1 )
 	{
-#ifdef SSE
-		// MXCSR rounding mode to round even
 #ifdef SSE_ENSURERC
-		g->sub( ESP, 8 );
-		g->stmxcsr( dword_ptr[ ESP ] );
-		g->mov( EBX, dword_ptr[ ESP ] );
-		g->and( AH, 0x9F ); // sets RC = 00
-		g->mov( dword_ptr[ ESP + 4 ], EBX );
-		g->ldmxcsr( dword_ptr[ ESP + 4 ] );
-#endif
-
-		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
+		EmitRoundedConversion( context, fs, MXCSRRCNEAREST );
+#else
+		g->movss( XMM0, RFPR( fs ) );
 		g->mov( EBX, 0x3f000000 );
 		g->movd( XMM1, EBX ); // 0.5f
 		g->addss( XMM0, XMM1 );
 		// round even via MXCSR
 		g->cvtss2si( EAX, XMM0 );
-		PRINTEAX();
-		g->mov( MCP1REG( CTX, fd, fmt ), EAX );
-
-		//g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
-		//// round even via MXCSR
-		//g->cvtss2si( EAX, XMM0 );
-		//g->cvtsi2ss( XMM0, EAX );
-		//ASSERTXMM0VALID();
-		//g->movss( MCP1REG( CTX, fd, fmt ), XMM0 );
-
-		// Restore rounding mode
-#ifdef SSE_ENSURERC
-		g->ldmxcsr( dword_ptr[ ESP ] );
-		g->add( ESP, 8 );
-#endif
-#else
-		g->mov( EAX, MCP1REG( CTX, fs, fmt ) );
-		// EAX = round even( EAX )
-		g->mov( MREG( CTX, fd ), EAX );
 #endif
+		PRINTEAX();
+		context->FpuRegisters->Store( fd, EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -414,18 +283,10 @@ GenerationResult TRUNCW( R4000GenContext^ context, int pass, int address, uint c
 	}
 	else if( pass == 1 )
 	{
-#ifdef SSE
-		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
 		// round towards zero
-		ASSERTXMM0VALID();
-		g->cvttss2si( EAX, XMM0 );
+		g->cvttss2si( EAX, RFPR( fs ) );
 		PRINTEAX();
-		g->mov( MCP1REG( CTX, fd, fmt ), EAX );
-#else
-		g->mov( EAX, MCP1REG( CTX, fs, fmt ) );
-		// EAX = trunc( EAX )
-		g->mov( MREG( CTX, fd ), EAX );
-#endif
+		context->FpuRegisters->Store( fd, EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -437,18 +298,9 @@ GenerationResult CEILW( R4000GenContext^ context, int pass, int address, uint co
 	}
 	else if( pass == 1 )
 	{
-//#ifdef SSE
-//		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
-//		g->cvtss2si( EAX, XMM0 );
-//		g->cvtsi2ss( XMM0, EAX );
-//		g->movss( MCP1REG( CTX, fd, fmt ), XMM0 );
-//#else
-		g->push( MCP1REG( CTX, fs, fmt ) );
-		g->call( (int)ceilf );
-		g->add( ESP, 4 );
-		ASSERTX87VALID();
-		g->fistp( MCP1REG( CTX, fd, fmt ) );
-//#endif
+		EmitRoundedConversion( context, fs, MXCSRRCUP );
+		PRINTEAX();
+		context->FpuRegisters->Store( fd, EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -460,18 +312,9 @@ GenerationResult FLOORW( R4000GenContext^ context, int pass, int address, uint c
 	}
 	else if( pass == 1 )
 	{
-//#ifdef SSE
-//		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
-//		g->cvttss2si( EAX, XMM0 );
-//		g->cvtsi2ss( XMM0, EAX );
-//		g->movss( MCP1REG( CTX, fd, fmt ), XMM0 );
-//#else
-		g->push( MCP1REG( CTX, fs, fmt ) );
-		g->call( (int)floorf );
-		g->add( ESP, 4 );
-		ASSERTX87VALID();
-		g->fistp( MCP1REG( CTX, fd, fmt ) );
-//#endif
+		EmitRoundedConversion( context, fs, MXCSRRCDOWN );
+		PRINTEAX();
+		context->FpuRegisters->Store( fd, EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -483,15 +326,11 @@ GenerationResult CVTS( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-#ifdef SSE
-		g->cvtsi2ss( XMM0, MCP1REG( CTX, fs, fmt ) );
+		// fs holds an int (W format)
+		context->FpuRegisters->Load( EAX, fs );
+		g->cvtsi2ss( XMM0, EAX );
 		ASSERTXMM0VALID();
-		g->movss( MCP1REG( CTX, fd, 0 ), XMM0 );
-#else
-		g->fild( MCP1REG( CTX, fs, fmt ) );
-		ASSERTX87VALID();
-		g->fstp( MCP1REG( CTX, fd, 0 ) );
-#endif
+		g->movss( WFPR( fd ), XMM0 );
 	}
 	return GenerationResult::Success;
 }
@@ -504,17 +343,11 @@ GenerationResult CVTW( R4000GenContext^ context, int pass, int address, uint cod
 	}
 	else if( pass == 1 )
 	{
-#ifdef SSE
-		g->cvtss2si( EAX, MCP1REG( CTX, fs, fmt ) );
+		g->cvtss2si( EAX, RFPR( fs ) );
 		PRINTEAX();
 		//g->cmp( EAX, 0x80000000 );
 		//g->cmove( EAX, 0x7FFFFFFF );
-		g->mov( MCP1REG( CTX, fd, 4 ), EAX );
-#else
-		g->fld( MCP1REG( CTX, fs, fmt ) );
-		ASSERTX87VALID();
-		g->fistp( MCP1REG( CTX, fd, fmt ) );
-#endif
+		context->FpuRegisters->Store( fd, EAX );
 	}
 	return GenerationResult::Success;
 }
@@ -527,50 +360,59 @@ GenerationResult FCOMPARE( R4000GenContext^ context, int pass, int address, uint
 	}
 	else if( pass == 1 )
 	{
-		uint fc = ( code >> 4 ) & 0x03;
-		uint cond = code & 0x0F;
-		bool lessBit = ( ( cond >> 2 ) & 0x1 ) == 1 ? true : false;
-		bool equalBit = ( ( cond >> 1 ) & 0x1 ) == 1 ? true : false;
-		bool unorderedBit = ( cond & 0x1 ) == 1 ? true : false;
-		bool un = lessBit && equalBit && unorderedBit;
-
-#ifdef SSE
-		// TODO: support all FPU compare ops (ordered, etc)
-		// NOTE: could do this with COMISS and SETcc instead!
-		g->movss( XMM0, MCP1REG( CTX, fs, fmt ) );
-		if( un == true )
-		{
-			g->cmpunordss( XMM0, MCP1REG( CTX, ft, fmt ) );
-			// XMM0 = FFFFFFFF if unordered, else 0
-		}
-		else if( ( lessBit == true ) && ( equalBit == true ) )
-		{
-			//Debug::Assert( unorderedBit == false );
-			g->cmpless( XMM0, MCP1REG( CTX, ft, fmt ) );
-			// XMM0 = FFFFFFFF if <=, else 0
-		}
-		else if( lessBit == true )
+		// Bit 3 only picks the signaling versions, which give the same results
+		uint cond = code & 0x07;
+
+		// UCOMISS a, b: unordered = ZF PF CF, a < b = CF, a == b = ZF, a > b = none
+		// The ordered less thans compare the other way around so unordered comes out false
+		if( cond == 0 )
 		{
-			//Debug::Assert( unorderedBit == false );
-			g->cmpltss( XMM0, MCP1REG( CTX, ft, fmt ) );
-			// XMM0 = FFFFFFFF if <, else 0
+			// F
+			g->xor( EBX, EBX );
 		}
-		else if( equalBit == true )
+		else if( ( cond == 4 ) || ( cond == 6 ) )
 		{
-			//Debug::Assert( unorderedBit == false );
-			g->cmpeqss( XMM0, MCP1REG( CTX, ft, fmt ) );
-			// XMM0 = FFFFFFFF if ==, else 0
+			g->movss( XMM0, RFPR( ft ) );
+			g->xor( EBX, EBX );
+			g->ucomiss( XMM0, RFPR( fs ) );
+			if( cond == 4 )
+				g->seta( BL );		// OLT
+			else
+				g->setae( BL );		// OLE
 		}
 		else
 		{
-			Debug::Assert( false );
+			g->movss( XMM0, RFPR( fs ) );
+			g->xor( EBX, EBX );
+			g->ucomiss( XMM0, RFPR( ft ) );
+			switch( cond )
+			{
+			case 1:		// UN
+				g->setp( BL );
+				break;
+			case 2:		// EQ
+				g->sete( BL );
+				g->setnp( AL );
+				g->and( BL, AL );
+				break;
+			case 3:		// UEQ
+				g->sete( BL );
+				break;
+			case 5:		// ULT
+				g->setb( BL );
+				break;
+			case 7:		// ULE
+				g->setbe( BL );
+				break;
+			}
 		}
-		g->movd( EAX, XMM0 );
-		g->and( EAX, 0x1 );
-		g->mov( MCP1CONDBIT( CTX ), EAX );
-#else
-		// yuck
-#endif
+		// EBX = 1 if the condition holds, else 0
+		g->mov( MCP1CONDBIT( CTX ), EBX );
+
+		// A BC1* right after us can use EBX instead of reloading the bit - only in optimized blocks, as
+		// the debugger thunks that can be patched in between don't keep EBX
+		if( context->FpuRegisters->IsEnabled() == true )
+			context->Cp1ConditionAddress = address;
 	}
 	return GenerationResult::Success;
 }
@@ -35,6 +35,10 @@ const char* R4000Generator::TableCopA_n[ 64 ];
 const char* R4000Generator::TableCopB_n[ 64 ];
 const char* R4000Generator::TableFpu_n[ 64 ];
 
+bool R4000Generator::TableR_c[ 64 ];
+bool R4000Generator::TableI_c[ 64 ];
+bool R4000Generator::TableSpecial3_c[ 64 ];
+
 GenerationResult UnknownR( R4000GenContext^ context, int pass, int address, uint code, byte opcode, byte rs, byte rt, byte rd, byte shamt, byte function )
 {
 	return GenerationResult::Invalid;
@@ -88,6 +92,10 @@ void R4000Generator::Setup()
 		TableCopA_n[ n ] = NULL;
 		TableCopB_n[ n ] = NULL;
 		TableFpu_n[ n ] = NULL;
+
+		TableR_c[ n ] = false;
+		TableI_c[ n ] = false;
+		TableSpecial3_c[ n ] = false;
 	}
 
 	TableR[ 0 ] = SLL;
@@ -357,4 +365,101 @@ void R4000Generator::Setup()
 	TableFpu_n[ 37 ] = "CVTL";
 	for( int n = 48; n <= 63; n++ )
 		TableFpu_n[ n ] = "FCOMPARE";
-}
\ No newline at end of file
+
+	// Instructions that get their GPRs through the register cache
+	TableR_c[ 0 ] = true;		// SLL
+	TableR_c[ 2 ] = true;		// SRL
+	TableR_c[ 3 ] = true;		// SRA
+	TableR_c[ 4 ] = true;		// SLLV
+	TableR_c[ 6 ] = true;		// SRLV
+	TableR_c[ 7 ] = true;		// SRAV
+	TableR_c[ 10 ] = true;		// MOVZ
+	TableR_c[ 11 ] = true;		// MOVN
+	TableR_c[ 16 ] = true;		// MFHI
+	TableR_c[ 17 ] = true;		// MTHI
+	TableR_c[ 18 ] = true;		// MFLO
+	TableR_c[ 19 ] = true;		// MTLO
+	TableR_c[ 24 ] = true;		// MULT
+	TableR_c[ 25 ] = true;		// MULTU
+	TableR_c[ 26 ] = true;		// DIV
+	TableR_c[ 27 ] = true;		// DIVU
+	TableR_c[ 28 ] = true;		// MADD
+	TableR_c[ 29 ] = true;		// MADDU
+	for( int n = 32; n <= 39; n++ )
+		TableR_c[ n ] = true;	// ADD ... NOR
+	for( int n = 42; n <= 47; n++ )
+		TableR_c[ n ] = true;	// SLT, SLTU, MAX, MIN, MSUB, MSUBU
+
+	for( int n = 8; n <= 15; n++ )
+		TableI_c[ n ] = true;	// ADDI ... LUI
+
+	TableSpecial3_c[ 0 ] = true;	// EXT
+	TableSpecial3_c[ 4 ] = true;	// INS
+	TableSpecial3_c[ 16 ] = true;	// SEB
+	TableSpecial3_c[ 24 ] = true;	// SEH
+}
+
+// Decodes just enough of the instruction to find its entry in the *_c tables
+bool R4000Generator::UsesRegisterCache( uint code )
+{
+	uint opcode = ( code >> 26 ) & 0x3F;
+	switch( opcode )
+	{
+	case 0:
+		return TableR_c[ code & 0x3F ];
+	case 0x1F:
+		{
+			uint bshfl = code & 0x3F;
+			if( ( bshfl == 0x0 ) ||
+				( bshfl == 0x4 ) )
+				return TableSpecial3_c[ bshfl ];
+			else
+				return TableSpecial3_c[ ( code >> 6 ) & 0x1F ];
+		}
+	case 1:
+	case 0x10:
+	case 0x11:
+	case 0x12:
+	case 0x1C:
+		return false;
+	default:
+		return TableI_c[ opcode ];
+	}
+}
+
+bool R4000Generator::KeepsFpuCache( uint code )
+{
+	// Everything in the register cache tables is plain integer work
+	if( UsesRegisterCache( code ) == true )
+		return true;
+
+	uint opcode = ( code >> 26 ) & 0x3F;
+	switch( opcode )
+	{
+	case 0x11:
+		{
+			// COP1 ops, MFC1, MTC1 and BC1* - CFC1/CTC1 go to the ctx
+			uint rs = ( code >> 21 ) & 0x1F;
+			return ( ( ( code >> 25 ) & 0x1 ) == 1 ) ||
+				( rs == 0x00 ) || ( rs == 0x04 ) || ( rs == 0x08 );
+		}
+	case 0x20:		// LB
+	case 0x21:		// LH
+	case 0x22:		// LWL
+	case 0x23:		// LW
+	case 0x24:		// LBU
+	case 0x25:		// LHU
+	case 0x26:		// LWR
+	case 0x28:		// SB
+	case 0x29:		// SH
+	case 0x2A:		// SWL
+	case 0x2B:		// SW
+	case 0x2E:		// SWR
+	case 0x31:		// LWC1
+	case 0x39:		// SWC1
+		// Memory ops only call out on cold paths, and those preserve the cache
+		return true;
+	default:
+		return false;
+	}
+}
@@ -10,6 +10,7 @@
 #include "R4000Core.h"
 #include "R4000Memory.h"
 #include "R4000GenContext.h"
+#include "R4000FastMemory.h"
 
 #include "CodeGenerator.h"
 
@@ -25,9 +26,17 @@ using namespace Noxa::Emulation::Psp::Cpu;
 
 extern R4000Ctx* _cpuCtx;
 
-void EmitAddressTranslation( R4000Generator *gen )
+void EmitAddressTranslation( R4000GenContext^ context )
 {
-	gen->and( gen->eax, 0x3FFFFFFF );
+#ifdef FASTMEMORY
+	// Same mask as the slow path - the window covers all of it, so nothing aliases
+	if( context->FastMemory != NULL )
+	{
+		g->and( EAX, FASTMEMORYMASK );
+		return;
+	}
+#endif
+	g->and( EAX, 0x3FFFFFFF );
 }
 
 // R4000Controller.cpp
@@ -62,8 +71,26 @@ void __writeMemoryThunk( uint pc, uint targetAddress, uint width, uint value )
 	//R4000Cpu::GlobalCpu->Memory->WriteWord( targetAddress, width, value );
 }
 
+#ifdef SMCDETECTION
+// Called when a store hits a page that has compiled code in it
+void __codeWriteThunk( uint targetAddress, uint width )
+{
+	R4000Cpu::GlobalCpu->_codeCache->InvalidateRange( ( int )targetAddress, ( int )width );
+}
+#endif
+
 extern int TriggerMemoryBreakpoint( uint pc, bool isRead, int bpId );
 
+#ifdef FASTMEMORY
+// NOP DWORD [EAX + pc] after each fast access - it does nothing when run, but lets
+// __fastMemoryFaultHandler find the guest instruction that faulted
+void EmitFastMemoryMarker( R4000GenContext^ context, int pc )
+{
+	g->db( 0x0F ); g->db( 0x1F ); g->db( 0x80 );
+	g->dd( pc );
+}
+#endif
+
 #pragma unmanaged
 
 #define MAXIMUM_MEMORY_BREAKPOINTS 128
@@ -132,11 +159,9 @@ void RemoveMemoryBreakpoint( uint address, bool isRead )
 	}
 }
 
-// EAX = address in guest space, result in EAX
-void EmitAddressLookup( R4000GenContext^ context, int address, bool isRead )
+// EAX = address in guest space - preserves all registers
+void EmitMemoryBreakpointCheck( R4000GenContext^ context, int address, bool isRead )
 {
-	g->and( EAX, 0x3FFFFFFF );
-
 #ifdef DEBUGGING
 	Label* noBreakpoints = g->DefineLabel();
 	if( isRead == true )
@@ -144,6 +169,7 @@ void EmitAddressLookup( R4000GenContext^ context, int address, bool isRead )
 	else
 		g->cmp( g->dword_ptr[ &writeBreakpointCount ], ( uint )0 );
 	g->jz( noBreakpoints );
+	context->FpuRegisters->Preserve();
 	g->push( EAX );
 	g->push( EBX );
 	g->push( ECX );
@@ -151,6 +177,7 @@ void EmitAddressLookup( R4000GenContext^ context, int address, bool isRead )
 	g->push( ( uint )isRead );
 	g->push( EAX );
 	g->push( ( uint )( address - 4 ) );
+	g->Pointer();
 	g->mov( EBX, (int)&__memoryBreakpointCheck );
 	g->call( EBX );
 	g->add( ESP, 12 );
@@ -158,9 +185,110 @@ void EmitAddressLookup( R4000GenContext^ context, int address, bool isRead )
 	g->pop( ECX );
 	g->pop( EBX );
 	g->pop( EAX );
+	context->FpuRegisters->Restore();
 	g->MarkLabel( noBreakpoints );
 #endif
+}
+
+// EAX = address in guest space (or targetAddress if constant is true) - trashes ECX
+void EmitCodeWriteCheck( R4000GenContext^ context, int width, bool constant, uint targetAddress )
+{
+#ifdef SMCDETECTION
+	Label* noCode = g->DefineLabel();
+	if( constant == true )
+		g->cmp( g->word_ptr[ &_codePages[ ( targetAddress & 0x0FFFFFFF ) >> CODEPAGESHIFT ] ], ( byte )0 );
+	else
+	{
+		g->mov( ECX, EAX );
+		g->shr( ECX, CODEPAGESHIFT );
+		g->and( ECX, CODEPAGECOUNT - 1 );
+		g->cmp( g->word_ptr[ ECX * 2 + ( int )_codePages ], ( byte )0 );
+	}
+	g->jz( noCode );
+	context->FpuRegisters->Preserve();
+	g->push( EAX );
+	g->push( EBX );
+	g->push( ECX );
+	g->push( EDX );
+	g->push( ( uint )width );
+	if( constant == true )
+		g->push( targetAddress );
+	else
+		g->push( EAX );
+	g->Pointer();
+	g->mov( EBX, (int)&__codeWriteThunk );
+	g->call( EBX );
+	g->add( ESP, 8 );
+	g->pop( EDX );
+	g->pop( ECX );
+	g->pop( EBX );
+	g->pop( EAX );
+	context->FpuRegisters->Restore();
+	g->MarkLabel( noCode );
+#endif
+}
+
+// Maps a guest address to host memory at generation time, or returns NULL if it isn't directly mapped
+byte* GetHostPointer( R4000GenContext^ context, uint targetAddress, int width )
+{
+	targetAddress &= 0x3FFFFFFF;
+
+	if( ( targetAddress >= MainMemoryBase ) &&
+		( targetAddress + width <= MainMemoryBound ) )
+		return context->MainMemory + ( targetAddress - MainMemoryBase );
+
+	uint shadowedAddress = targetAddress & 0x041FFFFF;
+	if( ( targetAddress >= VideoMemoryBase ) &&
+		( shadowedAddress + width <= VideoMemoryBound ) )
+		return context->FrameBuffer + ( shadowedAddress - VideoMemoryBase );
+
+#ifdef SUPPORTSCRATCHPAD
+	if( ( targetAddress >= ScratchPadBase ) &&
+		( targetAddress + width <= ScratchPadBound ) )
+		return context->ScratchPad + ( targetAddress - ScratchPadBase );
+#endif
+
+	return NULL;
+}
+
+// If the analysis pass knows the value of rs, returns the host pointer for rs + offset so
+// that the range checks can be skipped - otherwise NULL and nothing is emitted
+byte* EmitConstantAddress( R4000GenContext^ context, int address, byte rs, int offset, int width, bool isRead )
+{
+	InstructionInfo* info = context->CurrentInfo;
+	if( ( info == NULL ) ||
+		( info->RsKnown == false ) )
+		return NULL;
+
+	uint targetAddress = info->RsValue + offset;
+	byte* ptr = GetHostPointer( context, targetAddress, width );
+	if( ptr == NULL )
+		return NULL;
+
+#ifdef DEBUGGING
+	g->mov( EAX, targetAddress & 0x3FFFFFFF );
+	EmitMemoryBreakpointCheck( context, address, isRead );
+#endif
+
+	if( isRead == false )
+		EmitCodeWriteCheck( context, width, true, targetAddress );
+
+	return ptr;
+}
+
+// EAX = address in guest space, result in EAX
+void EmitAddressLookup( R4000GenContext^ context, int address, bool isRead )
+{
+	EmitAddressTranslation( context );
+
+	EmitMemoryBreakpointCheck( context, address, isRead );
+
+	// Only the VFPU stores come through here, and they are at most a quadword
+	if( isRead == false )
+		EmitCodeWriteCheck( context, 16, false, 0 );
 
+	// The pointer is handed to SSE code the fault handler can't emulate, so even with FASTMEMORY
+	// this takes the checked path below (main memory is still the first thing tested)
 	Label* l1 = g->DefineLabel();
 	Label* l2 = g->DefineLabel();
 	Label* l3 = g->DefineLabel();
@@ -174,6 +302,7 @@ void EmitAddressLookup( R4000GenContext^ context, int address, bool isRead )
 
 	// else, do a direct main memory read
 	g->sub( EAX, MainMemoryBase ); // get to offset in main memory
+	g->Pointer();
 	g->add( EAX, (int)context->MainMemory );
 	g->jmp( l4 );
 
@@ -191,6 +320,7 @@ void EmitAddressLookup( R4000GenContext^ context, int address, bool isRead )
 
 	// else, do a direct fb read
 	g->sub( ECX, VideoMemoryBase );
+	g->Pointer();
 	g->add( ECX, (int)context->FrameBuffer );
 	g->mov( EAX, ECX );
 	g->jmp( l4 );
@@ -206,20 +336,25 @@ void EmitAddressLookup( R4000GenContext^ context, int address, bool isRead )
 
 	// else, do a direct scratch pad read
 	g->sub( EAX, ScratchPadBase ); // get to offset in main memory
+	g->Pointer();
 	g->add( EAX, (int)context->ScratchPad );
 	g->jmp( l4 );
 #endif
 
 	g->MarkLabel( l3 );
 
+	// XMM registers aren't preserved across calls
+	context->FpuRegisters->Preserve();
 	g->push( EAX );
 	g->push( ( uint )( address - 4 ) );
 #ifdef BREAKONINVALIDACCESS
 	g->int3();
 #endif
+	g->Pointer();
 	g->mov( EBX, (int)&__readMemoryThunk );
 	g->call( EBX );
 	g->add( ESP, 8 );
+	context->FpuRegisters->Restore();
 	g->mov( EAX, 0 );
 
 	// done
@@ -229,25 +364,16 @@ void EmitAddressLookup( R4000GenContext^ context, int address, bool isRead )
 // EAX = address, result in EAX
 void EmitDirectMemoryRead( R4000GenContext^ context, int address )
 {
-#ifdef DEBUGGING
-	Label* noBreakpoints = g->DefineLabel();
-	g->cmp( g->dword_ptr[ &readBreakpointCount ], ( uint )0 );
-	g->jz( noBreakpoints );
-	g->push( EAX );
-	g->push( EBX );
-	g->push( ECX );
-	g->push( EDX );
-	g->push( ( uint )1 );
-	g->push( EAX );
-	g->push( ( uint )( address - 4 ) );
-	g->mov( EBX, (int)&__memoryBreakpointCheck );
-	g->call( EBX );
-	g->add( ESP, 12 );
-	g->pop( EDX );
-	g->pop( ECX );
-	g->pop( EBX );
-	g->pop( EAX );
-	g->MarkLabel( noBreakpoints );
+	EmitMemoryBreakpointCheck( context, address, true );
+
+#ifdef FASTMEMORY
+	if( context->FastMemory != NULL )
+	{
+		// Unmapped addresses fault and get handled by __fastMemoryFaultHandler
+		g->mov( EAX, g->dword_ptr[ EAX + ( int )context->FastMemory ] );
+		EmitFastMemoryMarker( context, address - 4 );
+		return;
+	}
 #endif
 
 	Label* l1 = g->DefineLabel();
@@ -300,14 +426,18 @@ void EmitDirectMemoryRead( R4000GenContext^ context, int address )
 
 	g->MarkLabel( l3 );
 
+	// XMM registers aren't preserved across calls
+	context->FpuRegisters->Preserve();
 	g->push( EAX );
 	g->push( ( uint )( address - 4 ) );
 #ifdef BREAKONINVALIDACCESS
 	g->int3();
 #endif
+	g->Pointer();
 	g->mov( EBX, (int)&__readMemoryThunk );
 	g->call( EBX );
 	g->add( ESP, 8 );
+	context->FpuRegisters->Restore();
 
 	// done
 	g->MarkLabel( l4 );
@@ -316,25 +446,27 @@ void EmitDirectMemoryRead( R4000GenContext^ context, int address )
 // EAX = address, EBX = data
 void EmitDirectMemoryWrite( R4000GenContext^ context, int address, int width )
 {
-#ifdef DEBUGGING
-	Label* noBreakpoints = g->DefineLabel();
-	g->cmp( g->dword_ptr[ &writeBreakpointCount ], ( uint )0 );
-	g->jz( noBreakpoints );
-	g->push( EAX );
-	g->push( EBX );
-	g->push( ECX );
-	g->push( EDX );
-	g->push( ( uint )0 );
-	g->push( EAX );
-	g->push( ( uint )( address - 4 ) );
-	g->mov( EBX, (int)&__memoryBreakpointCheck );
-	g->call( EBX );
-	g->add( ESP, 12 );
-	g->pop( EDX );
-	g->pop( ECX );
-	g->pop( EBX );
-	g->pop( EAX );
-	g->MarkLabel( noBreakpoints );
+	EmitMemoryBreakpointCheck( context, address, false );
+	EmitCodeWriteCheck( context, width, false, 0 );
+
+#ifdef FASTMEMORY
+	if( context->FastMemory != NULL )
+	{
+		switch( width )
+		{
+		case 1:
+			g->mov( g->byte_ptr[ EAX + ( int )context->FastMemory ], BL );
+			break;
+		case 2:
+			g->mov( g->word_ptr[ EAX + ( int )context->FastMemory ], BX );
+			break;
+		case 4:
+			g->mov( g->dword_ptr[ EAX + ( int )context->FastMemory ], EBX );
+			break;
+		}
+		EmitFastMemoryMarker( context, address - 4 );
+		return;
+	}
 #endif
 
 	Label* l1 = g->DefineLabel();
@@ -428,6 +560,7 @@ void EmitDirectMemoryWrite( R4000GenContext^ context, int address, int width )
 		g->movzx( EBX, BX );
 		break;
 	}
+	context->FpuRegisters->Preserve();
 	g->push( EBX );
 	g->push( ( uint )width );
 	g->push( EAX );
@@ -435,9 +568,11 @@ void EmitDirectMemoryWrite( R4000GenContext^ context, int address, int width )
 #ifdef BREAKONINVALIDACCESS
 	g->int3();
 #endif
+	g->Pointer();
 	g->mov( EBX, (int)&__writeMemoryThunk );
 	g->call( EBX );
 	g->add( ESP, 16 );
+	context->FpuRegisters->Restore();
 
 	// done
 	g->MarkLabel( l4 );
@@ -450,15 +585,21 @@ GenerationResult LB( R4000GenContext^ context, int pass, int address, uint code,
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		if( imm != 0 )
-			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
+		byte* ptr = EmitConstantAddress( context, address, rs, SE( imm ), 1, true );
+		if( ptr != NULL )
+			g->movsx( EAX, g->byte_ptr[ ptr ] );
+		else
+		{
+			g->mov( EAX, MREG( CTX, rs ) );
+			if( imm != 0 )
+				g->add( EAX, SE( imm ) );
+			EmitAddressTranslation( context );
 
-		EmitDirectMemoryRead( context, address );
+			EmitDirectMemoryRead( context, address );
 
-		// Byte mask & sign extend
-		g->movsx( EAX, AL );
+			// Byte mask & sign extend
+			g->movsx( EAX, AL );
+		}
 
 		g->mov( MREG( CTX, rt ), EAX );
 	}
@@ -472,15 +613,21 @@ GenerationResult LH( R4000GenContext^ context, int pass, int address, uint code,
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		if( imm != 0 )
-			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
+		byte* ptr = EmitConstantAddress( context, address, rs, SE( imm ), 2, true );
+		if( ptr != NULL )
+			g->movsx( EAX, g->word_ptr[ ptr ] );
+		else
+		{
+			g->mov( EAX, MREG( CTX, rs ) );
+			if( imm != 0 )
+				g->add( EAX, SE( imm ) );
+			EmitAddressTranslation( context );
 
-		EmitDirectMemoryRead( context, address );
+			EmitDirectMemoryRead( context, address );
 
-		// Short mask & sign extend
-		g->movsx( EAX, AX );
+			// Short mask & sign extend
+			g->movsx( EAX, AX );
+		}
 
 		g->mov( MREG( CTX, rt ), EAX );
 	}
@@ -498,7 +645,7 @@ GenerationResult LWL( R4000GenContext^ context, int pass, int address, uint code
 		g->mov( EAX, MREG( CTX, rs ) );
 		if( imm != 0 )
 			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
+		EmitAddressTranslation( context );
 		g->mov( ECX, EAX ); // store address in ECX
 
 		// Read existing data in to EAX - dword aligned
@@ -552,12 +699,18 @@ GenerationResult LW( R4000GenContext^ context, int pass, int address, uint code,
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		if( imm != 0 )
-			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
+		byte* ptr = EmitConstantAddress( context, address, rs, SE( imm ), 4, true );
+		if( ptr != NULL )
+			g->mov( EAX, g->dword_ptr[ ptr ] );
+		else
+		{
+			g->mov( EAX, MREG( CTX, rs ) );
+			if( imm != 0 )
+				g->add( EAX, SE( imm ) );
+			EmitAddressTranslation( context );
 
-		EmitDirectMemoryRead( context, address );
+			EmitDirectMemoryRead( context, address );
+		}
 
 		g->mov( MREG( CTX, rt ), EAX );
 	}
@@ -571,15 +724,21 @@ GenerationResult LBU( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		if( imm != 0 )
-			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
+		byte* ptr = EmitConstantAddress( context, address, rs, SE( imm ), 1, true );
+		if( ptr != NULL )
+			g->movzx( EAX, g->byte_ptr[ ptr ] );
+		else
+		{
+			g->mov( EAX, MREG( CTX, rs ) );
+			if( imm != 0 )
+				g->add( EAX, SE( imm ) );
+			EmitAddressTranslation( context );
 
-		EmitDirectMemoryRead( context, address );
+			EmitDirectMemoryRead( context, address );
 
-		// Byte mask
-		g->and( EAX, 0x000000FF );
+			// Byte mask
+			g->and( EAX, 0x000000FF );
+		}
 
 		g->mov( MREG( CTX, rt ), EAX );
 	}
@@ -593,15 +752,21 @@ GenerationResult LHU( R4000GenContext^ context, int pass, int address, uint code
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		if( imm != 0 )
-			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
+		byte* ptr = EmitConstantAddress( context, address, rs, SE( imm ), 2, true );
+		if( ptr != NULL )
+			g->movzx( EAX, g->word_ptr[ ptr ] );
+		else
+		{
+			g->mov( EAX, MREG( CTX, rs ) );
+			if( imm != 0 )
+				g->add( EAX, SE( imm ) );
+			EmitAddressTranslation( context );
 
-		EmitDirectMemoryRead( context, address );
+			EmitDirectMemoryRead( context, address );
 
-		// Short mask
-		g->and( EAX, 0x0000FFFF );
+			// Short mask
+			g->and( EAX, 0x0000FFFF );
+		}
 
 		g->mov( MREG( CTX, rt ), EAX );
 	}
@@ -618,7 +783,7 @@ GenerationResult LWR( R4000GenContext^ context, int pass, int address, uint code
 		g->mov( EAX, MREG( CTX, rs ) );
 		if( imm != 0 )
 			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
+		EmitAddressTranslation( context );
 		g->mov( ECX, EAX ); // store address in ECX
 
 		// Read existing data in to EAX - dword aligned
@@ -670,13 +835,22 @@ GenerationResult SB( R4000GenContext^ context, int pass, int address, uint code,
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		if( imm != 0 )
-			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
-		g->mov( EBX, MREG( CTX, rt ) );
+		byte* ptr = EmitConstantAddress( context, address, rs, SE( imm ), 1, false );
+		if( ptr != NULL )
+		{
+			g->mov( EBX, MREG( CTX, rt ) );
+			g->mov( g->byte_ptr[ ptr ], BL );
+		}
+		else
+		{
+			g->mov( EAX, MREG( CTX, rs ) );
+			if( imm != 0 )
+				g->add( EAX, SE( imm ) );
+			EmitAddressTranslation( context );
+			g->mov( EBX, MREG( CTX, rt ) );
 
-		EmitDirectMemoryWrite( context, address, 1 );
+			EmitDirectMemoryWrite( context, address, 1 );
+		}
 	}
 	return GenerationResult::Success;
 }
@@ -688,13 +862,22 @@ GenerationResult SH( R4000GenContext^ context, int pass, int address, uint code,
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		if( imm != 0 )
-			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
-		g->mov( EBX, MREG( CTX, rt ) );
+		byte* ptr = EmitConstantAddress( context, address, rs, SE( imm ), 2, false );
+		if( ptr != NULL )
+		{
+			g->mov( EBX, MREG( CTX, rt ) );
+			g->mov( g->word_ptr[ ptr ], BX );
+		}
+		else
+		{
+			g->mov( EAX, MREG( CTX, rs ) );
+			if( imm != 0 )
+				g->add( EAX, SE( imm ) );
+			EmitAddressTranslation( context );
+			g->mov( EBX, MREG( CTX, rt ) );
 
-		EmitDirectMemoryWrite( context, address, 2 );
+			EmitDirectMemoryWrite( context, address, 2 );
+		}
 	}
 	return GenerationResult::Success;
 }
@@ -710,7 +893,7 @@ GenerationResult SWL( R4000GenContext^ context, int pass, int address, uint code
 		g->mov( EAX, MREG( CTX, rs ) );
 		if( imm != 0 )
 			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
+		EmitAddressTranslation( context );
 		g->mov( ECX, EAX ); // store address in ECX
 
 		// Read existing data in to EAX - dword aligned
@@ -762,7 +945,7 @@ GenerationResult SWL( R4000GenContext^ context, int pass, int address, uint code
 		g->mov( EAX, MREG( CTX, rs ) );
 		if( imm != 0 )
 			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
+		EmitAddressTranslation( context );
 		g->and( EAX, 0xFFFFFFFC );		// word align
 		// Write EBX to address EAX
 		EmitDirectMemoryWrite( context, address, 4 );
@@ -777,13 +960,22 @@ GenerationResult SW( R4000GenContext^ context, int pass, int address, uint code,
 	}
 	else if( pass == 1 )
 	{
-		g->mov( EAX, MREG( CTX, rs ) );
-		if( imm != 0 )
-			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
-		g->mov( EBX, MREG( CTX, rt ) );
+		byte* ptr = EmitConstantAddress( context, address, rs, SE( imm ), 4, false );
+		if( ptr != NULL )
+		{
+			g->mov( EBX, MREG( CTX, rt ) );
+			g->mov( g->dword_ptr[ ptr ], EBX );
+		}
+		else
+		{
+			g->mov( EAX, MREG( CTX, rs ) );
+			if( imm != 0 )
+				g->add( EAX, SE( imm ) );
+			EmitAddressTranslation( context );
+			g->mov( EBX, MREG( CTX, rt ) );
 
-		EmitDirectMemoryWrite( context, address, 4 );
+			EmitDirectMemoryWrite( context, address, 4 );
+		}
 	}
 	return GenerationResult::Success;
 }
@@ -799,7 +991,7 @@ GenerationResult SWR( R4000GenContext^ context, int pass, int address, uint code
 		g->mov( EAX, MREG( CTX, rs ) );
 		if( imm != 0 )
 			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
+		EmitAddressTranslation( context );
 		g->mov( ECX, EAX ); // store address in ECX
 
 		// Read existing data in to EAX - dword aligned
@@ -849,7 +1041,7 @@ GenerationResult SWR( R4000GenContext^ context, int pass, int address, uint code
 		g->mov( EAX, MREG( CTX, rs ) );
 		if( imm != 0 )
 			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
+		EmitAddressTranslation( context );
 		g->and( EAX, 0xFFFFFFFC );		// word align
 		// Write EBX to address EAX
 		EmitDirectMemoryWrite( context, address, 4 );
@@ -905,7 +1097,7 @@ GenerationResult LWCz( R4000GenContext^ context, int pass, int address, uint cod
 		g->mov( EAX, MREG( CTX, rs ) );
 		if( imm != 0 )
 			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
+		EmitAddressTranslation( context );
 
 		EmitDirectMemoryRead( context, address );
 
@@ -915,7 +1107,7 @@ GenerationResult LWCz( R4000GenContext^ context, int pass, int address, uint cod
 			//g->mov( MCP0REG( rt ), EAX );
 			break;
 		case 1:
-			g->mov( MCP1REG( CTX, rt, 0 ), EAX );
+			context->FpuRegisters->Store( rt, EAX );
 			break;
 		case 2:
 			//g->mov( MCP2REG( rt ), EAX );
@@ -939,14 +1131,14 @@ GenerationResult SWCz( R4000GenContext^ context, int pass, int address, uint cod
 		g->mov( EAX, MREG( CTX, rs ) );
 		if( imm != 0 )
 			g->add( EAX, SE( imm ) );
-		EmitAddressTranslation( g );
+		EmitAddressTranslation( context );
 		
 		switch( cop )
 		{
 		case 0:
 			break;
 		case 1:
-			g->mov( EBX, MCP1REG( CTX, rt, 0 ) );
+			context->FpuRegisters->Load( EBX, rt );
 			break;
 		case 2:
 			break;
@@ -10,6 +10,7 @@
 #include "R4000Core.h"
 #include "R4000Memory.h"
 #include "R4000GenContext.h"
+#include "R4000Vfpu.h"
 #include "R4000BiosStubs.h"
 #include "R4000Hook.h"
 
@@ -246,6 +247,9 @@ GenerationResult SYSCALL( R4000GenContext^ context, int pass, int address, uint
 			//g->mov( MPCVALID( CTX ), 1 );
 		}
 
+		// Whatever the BIOS does (including switching threads) has to see the prefixes in the ctx
+		EmitVfpuPrefixStores( context, false );
+
 		// Override if we can - we do this regardless of whether or not the BIOS implements it
 #ifdef OVERRIDESYSCALLS
 		if( canEmit == true )
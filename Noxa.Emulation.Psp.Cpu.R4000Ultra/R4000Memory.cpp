@@ -8,6 +8,8 @@
 //#include <Windows.h>
 #include "DebugOptions.h"
 #include "R4000Memory.h"
+#include "R4000Cpu.h"
+#include "R4000Cache.h"
 #include <string>
 
 using namespace System::Diagnostics;
@@ -24,13 +26,36 @@ extern uint _managedMemoryWriteCount;
 
 R4000Memory::R4000Memory()
 {
-	MainMemory = ( byte* )_aligned_malloc( MainMemorySize, 16 );
-	ScratchPad = ( byte* )_aligned_malloc( ScratchPadSize, 16 );
-	VideoMemory = ( byte* )_aligned_malloc( VideoMemorySize, 16 );
+	FastMemoryBase = NULL;
+	_fastMemory = NULL;
 
-	memset( MainMemory, 0x0, MainMemorySize );
-	memset( ScratchPad, 0x0, ScratchPadSize );
-	memset( VideoMemory, 0x0, VideoMemorySize );
+#ifdef FASTMEMORY
+	// If we can get the window, all of the regions live inside of it (and start out zeroed)
+	_fastMemory = new FastMemory();
+	if( FastMemoryCreate( _fastMemory ) == true )
+	{
+		FastMemoryBase = _fastMemory->Base;
+		MainMemory = _fastMemory->MainMemory;
+		ScratchPad = _fastMemory->ScratchPad;
+		VideoMemory = _fastMemory->VideoMemory;
+	}
+	else
+	{
+		Log::WriteLine( Verbosity::Normal, Feature::Cpu, "Unable to reserve the fast memory window - falling back to checked accesses" );
+		SAFEDELETE( _fastMemory );
+	}
+#endif
+
+	if( FastMemoryBase == NULL )
+	{
+		MainMemory = ( byte* )_aligned_malloc( MainMemorySize, 16 );
+		ScratchPad = ( byte* )_aligned_malloc( ScratchPadSize, 16 );
+		VideoMemory = ( byte* )_aligned_malloc( VideoMemorySize, 16 );
+
+		memset( MainMemory, 0x0, MainMemorySize );
+		memset( ScratchPad, 0x0, ScratchPadSize );
+		memset( VideoMemory, 0x0, VideoMemorySize );
+	}
 
 	NativeSystem = new Psp::NativeMemorySystem();
 	NativeSystem->MainMemory = MainMemory;
@@ -52,6 +77,16 @@ R4000Memory::!R4000Memory()
 
 void R4000Memory::Clear()
 {
+	if( _fastMemory != NULL )
+	{
+		// The regions are views in the window - don't free them
+		FastMemoryDestroy( _fastMemory );
+		SAFEDELETE( _fastMemory );
+		FastMemoryBase = NULL;
+		MainMemory = NULL;
+		ScratchPad = NULL;
+		VideoMemory = NULL;
+	}
 	if( MainMemory != NULL )
 		_aligned_free( MainMemory );
 	MainMemory = NULL;
@@ -74,7 +109,8 @@ void R4000Memory::RegisterSegment( IMemorySegment^ segment )
 {
 	if( segment->BaseAddress == VideoMemoryBase )
 	{
-		SAFEFREE( VideoMemory );
+		if( _fastMemory == NULL )
+			SAFEFREE( VideoMemory );
 		_frameBuffer = segment;
 		//VideoMemory = ptr?
 		throw gcnew NotImplementedException( "IMemorySegment does not support grabbing of the frame buffer bytes" );
@@ -383,6 +419,10 @@ void R4000Memory::WriteBytes( int address, array<byte>^ bytes )
 	{
 		pin_ptr<byte> ptr = &bytes[ 0 ];
 		memcpy( MainMemory + ( address - MainMemoryBase ), ptr, bytes->Length );
+#ifdef SMCDETECTION
+		// Module loads and file reads come through here - drop anything we had built from the old data
+		R4000Cpu::GlobalCpu->_codeCache->InvalidateRange( address, bytes->Length );
+#endif
 	}
 	else if( ( address >= ScratchPadBase ) && ( address < ScratchPadBound ) )
 	{
@@ -423,6 +463,9 @@ void R4000Memory::WriteStream( int address, Stream^ source, int count )
 		byte* bp = ptr;
 		memcpy( MainMemory + ( address - MainMemoryBase ), bp, count );
 		//source.Position = pos;
+#ifdef SMCDETECTION
+		R4000Cpu::GlobalCpu->_codeCache->InvalidateRange( address, count );
+#endif
 
 #if 0
 		// DEBUG DUMP
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include "R4000FastMemory.h"
+
 using namespace System;
 using namespace System::Collections::Generic;
 using namespace System::IO;
@@ -26,10 +28,14 @@ namespace Noxa {
 					byte*			VideoMemory;
 
 					NativeMemorySystem*	NativeSystem;
+
+					// Base of the fast memory window (guest 0x00000000), or NULL if not in use
+					byte*			FastMemoryBase;
 					MemorySystem^		System;
 
 				protected:
 					IMemorySegment^	_frameBuffer;
+					FastMemory*		_fastMemory;
 
 				protected:
 					!R4000Memory();
@@ -0,0 +1,385 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#include "StdAfx.h"
+#pragma unmanaged
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#pragma managed
+#include "R4000PersistentCache.h"
+#include "R4000Generator.h"
+
+using namespace Noxa::Emulation::Psp;
+using namespace Noxa::Emulation::Psp::CodeGen;
+using namespace Noxa::Emulation::Psp::Cpu;
+
+#define PERSISTENTMAGIC		0x434A584E		// NXJC
+#define PERSISTENTVERSION	8
+
+// Set by the linker to the start of this module
+extern "C" IMAGE_DOS_HEADER __ImageBase;
+
+typedef struct PersistentHeader_t
+{
+	uint		Magic;
+	uint		Version;
+	uint		ImageStamp;
+	uint		ModuleHash;
+} PersistentHeader;
+
+#pragma unmanaged
+
+// Given to loaded code when we are out of return links - its address never matches, so the prediction always misses
+ReturnLink _deadReturnLink = { -1, NULL };
+
+uint PersistentHash( const byte* data, int length )
+{
+	// FNV-1a
+	uint hash = 2166136261;
+	for( int n = 0; n < length; n++ )
+		hash = ( hash ^ data[ n ] ) * 16777619;
+	return hash;
+}
+
+uint PersistentHashCode( PersistentCache* cache, const byte* guestCode, int instructionCount )
+{
+	// Include the delay slot of the last instruction, but don't run off the end of memory
+	const PersistentRange* range = &cache->Ranges[ PERSISTENTRANGEMAINMEMORY ];
+	int length = ( instructionCount + 1 ) << 2;
+	int remaining = ( int )( ( range->Base + range->Size ) - guestCode );
+	if( length > remaining )
+		length = remaining;
+	return PersistentHash( guestCode, length );
+}
+
+int PersistentFindRange( PersistentCache* cache, uint value )
+{
+	for( int n = 0; n < PERSISTENTRANGECOUNT; n++ )
+	{
+		PersistentRange* range = &cache->Ranges[ n ];
+		if( ( range->Base != NULL ) &&
+			( value >= ( uint )range->Base ) &&
+			( value - ( uint )range->Base < range->Size ) )
+			return n;
+	}
+	return -1;
+}
+
+__inline int PersistentEntrySize( const PersistentEntry* entry )
+{
+	return sizeof( PersistentEntry ) + entry->CodeLength + entry->RelocationCount * sizeof( PersistentRelocation );
+}
+
+void PersistentIndexEntries( PersistentCache* cache )
+{
+	for( int n = 0; n < PERSISTENTBUCKETCOUNT; n++ )
+		cache->Buckets[ n ] = -1;
+
+	// Count first so the index can be allocated in one go - anything after a bad entry is dropped
+	int count = 0;
+	int offset = sizeof( PersistentHeader );
+	while( offset + ( int )sizeof( PersistentEntry ) <= cache->DataLength )
+	{
+		PersistentEntry* entry = ( PersistentEntry* )( cache->Data + offset );
+		if( ( entry->CodeLength <= 0 ) ||
+			( entry->RelocationCount < 0 ) ||
+			( entry->InstructionCount <= 0 ) ||
+			( offset + PersistentEntrySize( entry ) > cache->DataLength ) )
+			break;
+		offset += PersistentEntrySize( entry );
+		count++;
+	}
+	cache->DataLength = offset;
+
+	cache->Index = ( PersistentIndex* )calloc( count + 1, sizeof( PersistentIndex ) );
+	cache->IndexCount = 0;
+	offset = sizeof( PersistentHeader );
+	while( cache->IndexCount < count )
+	{
+		PersistentEntry* entry = ( PersistentEntry* )( cache->Data + offset );
+		int bucket = ( ( uint )entry->Address >> 2 ) & ( PERSISTENTBUCKETCOUNT - 1 );
+
+		PersistentIndex* index = &cache->Index[ cache->IndexCount ];
+		index->Entry = entry;
+		index->Next = cache->Buckets[ bucket ];
+		cache->Buckets[ bucket ] = cache->IndexCount++;
+
+		offset += PersistentEntrySize( entry );
+	}
+}
+
+bool Noxa::Emulation::Psp::Cpu::PersistentCacheOpen( PersistentCache* cache, const wchar_t* path, uint moduleHash )
+{
+	cache->Enabled = false;
+	cache->File = NULL;
+	cache->Data = NULL;
+	cache->DataLength = 0;
+	cache->Index = NULL;
+	cache->IndexCount = 0;
+	cache->Stored = NULL;
+	cache->Loads = 0;
+	cache->Stores = 0;
+	for( int n = 0; n < PERSISTENTBUCKETCOUNT; n++ )
+		cache->Buckets[ n ] = -1;
+
+	// Code built by a different build of us would call in to the wrong places
+	IMAGE_NT_HEADERS* ntHeaders = ( IMAGE_NT_HEADERS* )( ( byte* )&__ImageBase + __ImageBase.e_lfanew );
+	cache->Ranges[ PERSISTENTRANGEIMAGE ].Base = ( byte* )&__ImageBase;
+	cache->Ranges[ PERSISTENTRANGEIMAGE ].Size = ntHeaders->OptionalHeader.SizeOfImage;
+	cache->ImageStamp = ntHeaders->FileHeader.TimeDateStamp;
+
+	if( cache->Ranges[ PERSISTENTRANGEMAINMEMORY ].Base == NULL )
+		return false;
+
+	HANDLE file = CreateFileW( path, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( file == INVALID_HANDLE_VALUE )
+		return false;
+	cache->File = file;
+
+	DWORD length = GetFileSize( file, NULL );
+	if( ( length != INVALID_FILE_SIZE ) &&
+		( length >= sizeof( PersistentHeader ) ) )
+	{
+		cache->Data = ( byte* )malloc( length );
+		DWORD read = 0;
+		if( ( ReadFile( file, cache->Data, length, &read, NULL ) == TRUE ) &&
+			( read == length ) )
+		{
+			PersistentHeader* header = ( PersistentHeader* )cache->Data;
+			if( ( header->Magic == PERSISTENTMAGIC ) &&
+				( header->Version == PERSISTENTVERSION ) &&
+				( header->ImageStamp == cache->ImageStamp ) &&
+				( header->ModuleHash == moduleHash ) )
+				cache->DataLength = length;
+		}
+	}
+
+	if( cache->DataLength > 0 )
+		PersistentIndexEntries( cache );
+	else
+	{
+		SAFEFREE( cache->Data );
+
+		PersistentHeader header;
+		header.Magic = PERSISTENTMAGIC;
+		header.Version = PERSISTENTVERSION;
+		header.ImageStamp = cache->ImageStamp;
+		header.ModuleHash = moduleHash;
+
+		DWORD written = 0;
+		SetFilePointer( file, 0, NULL, FILE_BEGIN );
+		SetEndOfFile( file );
+		if( ( WriteFile( file, &header, sizeof( header ), &written, NULL ) == FALSE ) ||
+			( written != sizeof( header ) ) )
+		{
+			PersistentCacheClose( cache );
+			return false;
+		}
+		cache->DataLength = sizeof( header );
+	}
+
+	// New entries go after the last good one
+	SetFilePointer( file, cache->DataLength, NULL, FILE_BEGIN );
+	SetEndOfFile( file );
+
+	cache->Stored = ( byte* )calloc( ( MainMemorySize + 1 ) >> 5, 1 );
+	cache->Enabled = true;
+	return true;
+}
+
+void Noxa::Emulation::Psp::Cpu::PersistentCacheClose( PersistentCache* cache )
+{
+	cache->Enabled = false;
+	if( cache->File != NULL )
+	{
+		FlushFileBuffers( cache->File );
+		CloseHandle( cache->File );
+	}
+	cache->File = NULL;
+
+	SAFEFREE( cache->Data );
+	SAFEFREE( cache->Index );
+	SAFEFREE( cache->Stored );
+	cache->DataLength = 0;
+	cache->IndexCount = 0;
+}
+
+bool Noxa::Emulation::Psp::Cpu::PersistentCacheLoad( PersistentCache* cache, R4000Generator* gen, R4000Cache* codeCache, CodeBlock* block, const byte* guestCode )
+{
+	if( cache->Enabled == false )
+		return false;
+
+	PersistentEntry* entry = NULL;
+	int bucket = ( ( uint )block->Address >> 2 ) & ( PERSISTENTBUCKETCOUNT - 1 );
+	for( int n = cache->Buckets[ bucket ]; n != -1; n = cache->Index[ n ].Next )
+	{
+		PersistentEntry* candidate = cache->Index[ n ].Entry;
+		if( ( candidate->Address == block->Address ) &&
+			( candidate->CodeHash == PersistentHashCode( cache, guestCode, candidate->InstructionCount ) ) )
+		{
+			entry = candidate;
+			break;
+		}
+	}
+	if( entry == NULL )
+		return false;
+
+	byte* code = ( byte* )entry + sizeof( PersistentEntry );
+	PersistentRelocation* relocations = ( PersistentRelocation* )( code + entry->CodeLength );
+
+	// A range we don't have this time around (no fast memory, etc) means the code is no good
+	for( int n = 0; n < entry->RelocationCount; n++ )
+	{
+		PersistentRelocation* r = &relocations[ n ];
+		if( ( r->Offset < 0 ) ||
+			( r->Offset + 4 > entry->CodeLength ) )
+			return false;
+		if( r->Range == PERSISTENTRANGEBLOCK )
+		{
+			if( r->Type != RelocAbsolute )
+				return false;
+		}
+		else if( ( r->Type != RelocCode ) &&
+			( ( r->Range >= PERSISTENTRANGECOUNT ) ||
+			( cache->Ranges[ r->Range ].Base == NULL ) ) )
+			return false;
+	}
+
+	byte* ptr = ( byte* )gen->CopyCode( code, entry->CodeLength );
+	for( int n = 0; n < entry->RelocationCount; n++ )
+	{
+		PersistentRelocation* r = &relocations[ n ];
+		uint* field = ( uint* )( ptr + r->Offset );
+		switch( r->Type )
+		{
+		case RelocAbsolute:
+			if( r->Range == PERSISTENTRANGEBLOCK )
+				*field = ( uint )block + r->Value;
+			else if( r->Range == PERSISTENTRANGERETURNLINKS )
+			{
+				ReturnLink* link = codeCache->AddReturnLink( ( int )r->Value );
+				*field = ( uint )( ( link != NULL ) ? link : &_deadReturnLink );
+			}
+			else
+				*field = ( uint )cache->Ranges[ r->Range ].Base + r->Value;
+			break;
+		case RelocCall:
+			*field = ( ( uint )cache->Ranges[ r->Range ].Base + r->Value ) - ( uint )( ptr + r->Offset + 4 );
+			break;
+		case RelocCode:
+			*field = ( uint )ptr + r->Value;
+			break;
+		}
+	}
+
+	block->Size = entry->CodeLength;
+	block->InstructionCount = entry->InstructionCount;
+	block->EndsOnSyscall = false;
+	codeCache->UpdatePointer( block, ptr );
+
+	cache->Loads++;
+	return true;
+}
+
+void Noxa::Emulation::Psp::Cpu::PersistentCacheStore( PersistentCache* cache, R4000Generator* gen, CodeBlock* block, const byte* guestCode )
+{
+	if( ( cache->Enabled == false ) ||
+		( block->Pointer == NULL ) )
+		return;
+
+	// Rebuilds (after eviction/invalidation) would just pile up duplicates
+	uint word = ( ( uint )block->Address - MainMemoryBase ) >> 2;
+	if( ( cache->Stored[ word >> 3 ] & ( 1 << ( word & 7 ) ) ) != 0 )
+		return;
+	cache->Stored[ word >> 3 ] |= ( 1 << ( word & 7 ) );
+
+	byte* code = ( byte* )block->Pointer;
+	int relocationCount = gen->GetRelocationCount();
+	const Relocation* relocations = gen->GetRelocations();
+
+	int size = sizeof( PersistentEntry ) + block->Size + relocationCount * sizeof( PersistentRelocation );
+	byte* buffer = ( byte* )malloc( size );
+	PersistentEntry* entry = ( PersistentEntry* )buffer;
+	entry->Address = block->Address;
+	entry->InstructionCount = block->InstructionCount;
+	entry->CodeHash = PersistentHashCode( cache, guestCode, block->InstructionCount );
+	entry->CodeLength = block->Size;
+	entry->RelocationCount = 0;
+	memcpy( buffer + sizeof( PersistentEntry ), code, block->Size );
+	PersistentRelocation* out = ( PersistentRelocation* )( buffer + sizeof( PersistentEntry ) + block->Size );
+
+	for( int n = 0; n < relocationCount; n++ )
+	{
+		const Relocation* r = &relocations[ n ];
+		uint value = *( uint* )( code + r->Offset );
+		PersistentRelocation* p = &out[ entry->RelocationCount ];
+		p->Offset = r->Offset;
+		p->Type = ( byte )r->Type;
+		p->Range = 0;
+		p->Reserved = 0;
+
+		if( r->Type == RelocCode )
+		{
+			p->Value = value - ( uint )code;
+			entry->RelocationCount++;
+			continue;
+		}
+
+		if( r->Type == RelocCall )
+			value += ( uint )( code + r->Offset + 4 );
+
+		// Its own counters
+		if( ( r->Type == RelocAbsolute ) &&
+			( value >= ( uint )block ) &&
+			( value < ( uint )( block + 1 ) ) )
+		{
+			p->Range = PERSISTENTRANGEBLOCK;
+			p->Value = value - ( uint )block;
+			entry->RelocationCount++;
+			continue;
+		}
+
+		// Calls out to shims/the CRT and pointers in to other blocks or the heap can't be found next time
+		int range = PersistentFindRange( cache, value );
+		if( range == -1 )
+		{
+			free( buffer );
+			return;
+		}
+
+		p->Range = ( byte )range;
+		if( range == PERSISTENTRANGERETURNLINKS )
+		{
+			if( ( r->Type != RelocAbsolute ) ||
+				( ( ( value - ( uint )cache->Ranges[ range ].Base ) % sizeof( ReturnLink ) ) != 0 ) )
+			{
+				free( buffer );
+				return;
+			}
+			p->Value = ( uint )( ( ReturnLink* )value )->Address;
+		}
+		else
+			p->Value = value - ( uint )cache->Ranges[ range ].Base;
+		entry->RelocationCount++;
+	}
+
+	size = PersistentEntrySize( entry );
+	DWORD written = 0;
+	if( ( WriteFile( cache->File, buffer, size, &written, NULL ) == FALSE ) ||
+		( ( int )written != size ) )
+	{
+		// Leave the file ending on a whole entry if we can, and stop writing to it
+		SetFilePointer( cache->File, -( LONG )written, NULL, FILE_CURRENT );
+		SetEndOfFile( cache->File );
+		cache->Enabled = false;
+	}
+	else
+		cache->Stores++;
+
+	free( buffer );
+}
+
+#pragma managed
@@ -0,0 +1,109 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "R4000Cache.h"
+
+using namespace Noxa::Emulation::Psp;
+
+// Host ranges that generated code can point in to - a relocation says which one a field was in and its offset
+#define PERSISTENTRANGEIMAGE		0		// This module - thunks, helpers, and globals
+#define PERSISTENTRANGECONTEXT		1
+#define PERSISTENTRANGEMAINMEMORY	2
+#define PERSISTENTRANGEFRAMEBUFFER	3
+#define PERSISTENTRANGESCRATCHPAD	4
+#define PERSISTENTRANGEFASTMEMORY	5
+#define PERSISTENTRANGERETURNLINKS	6		// Fixed up by guest return address, as links are handed out in build order
+#define PERSISTENTRANGECOUNT		7
+// Not in Ranges - fields pointing in to the CodeBlock the code was built for, fixed up to the one loading it
+#define PERSISTENTRANGEBLOCK		0xFF
+
+// Number of buckets in the loaded entry table - must be a power of two
+#define PERSISTENTBUCKETCOUNT		4096
+
+namespace Noxa {
+	namespace Emulation {
+		namespace Psp {
+			namespace Cpu {
+
+				class R4000Generator;
+
+				typedef struct PersistentRange_t
+				{
+					byte*		Base;
+					uint		Size;
+				} PersistentRange;
+
+				typedef struct PersistentEntry_t
+				{
+					int			Address;
+					int			InstructionCount;
+					uint		CodeHash;			// Hash of the guest code the block was built from
+					int			CodeLength;
+					int			RelocationCount;
+					// Followed by CodeLength bytes of code and RelocationCount PersistentRelocations
+				} PersistentEntry;
+
+				typedef struct PersistentRelocation_t
+				{
+					int			Offset;				// Offset of the field in the code
+					byte		Type;				// RelocationType
+					byte		Range;				// PERSISTENTRANGE*, unused for RelocCode
+					ushort		Reserved;
+					uint		Value;				// Offset in to the range (or block), or the guest address for return links
+				} PersistentRelocation;
+
+				typedef struct PersistentIndex_t
+				{
+					PersistentEntry*	Entry;
+					int					Next;		// Next index in the same bucket, or -1
+				} PersistentIndex;
+
+				/* Generated code saved across runs. The file is named after a hash of the boot module and is only
+				   used if it was written by the same build of this module. Each entry holds the code for one block
+				   with all of its host addresses turned in to (range, offset) pairs, and is only used if the guest
+				   code at its address still hashes the same. Blocks that call anything outside of the known ranges
+				   (shims, the CRT) or make syscalls are never written out.
+				*/
+				typedef struct PersistentCache_t
+				{
+					bool				Enabled;
+					void*				File;
+					uint				ImageStamp;
+					PersistentRange		Ranges[ PERSISTENTRANGECOUNT ];
+
+					// Everything read from the file - entries point in to Data
+					byte*				Data;
+					int					DataLength;
+					int					Buckets[ PERSISTENTBUCKETCOUNT ];
+					PersistentIndex*	Index;
+					int					IndexCount;
+
+					// One bit per word of main memory - set once a block at that address has been written this run
+					byte*				Stored;
+
+					int					Loads;
+					int					Stores;
+				} PersistentCache;
+
+#pragma unmanaged
+				// Ranges must be filled in (other than the image) before opening
+				bool PersistentCacheOpen( PersistentCache* cache, const wchar_t* path, uint moduleHash );
+				void PersistentCacheClose( PersistentCache* cache );
+
+				// Places the saved code for the block in to storage and updates the cache - returns false if there
+				// isn't any (or it is stale) and the block needs to be built
+				bool PersistentCacheLoad( PersistentCache* cache, R4000Generator* gen, R4000Cache* codeCache, CodeBlock* block, const byte* guestCode );
+
+				// Writes out the block that was just generated - call before the generator is reset
+				void PersistentCacheStore( PersistentCache* cache, R4000Generator* gen, CodeBlock* block, const byte* guestCode );
+#pragma managed
+
+			}
+		}
+	}
+}
@@ -0,0 +1,173 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#include "StdAfx.h"
+#include "R4000RegisterCache.h"
+#include "R4000Generator.h"
+#include "R4000Ctx.h"
+
+using namespace System::Diagnostics;
+using namespace Noxa::Emulation::Psp;
+using namespace Noxa::Emulation::Psp::CodeGen;
+using namespace Noxa::Emulation::Psp::Cpu;
+
+R4000RegisterCache::R4000RegisterCache( R4000Generator* generator )
+{
+	_gen = generator;
+	this->Reset( NULL, false );
+}
+
+void R4000RegisterCache::Reset( void* ctxPointer, bool enabled )
+{
+	_ctx = ( int )ctxPointer;
+	_enabled = enabled;
+	_tick = 0;
+
+	for( int n = 0; n < REGCACHESLOTS; n++ )
+	{
+		_slots[ n ].Register = -1;
+		_slots[ n ].Dirty = false;
+		_slots[ n ].Locked = false;
+		_slots[ n ].LastUse = 0;
+	}
+}
+
+const OperandREG32& R4000RegisterCache::HostRegister( int slot )
+{
+	switch( slot )
+	{
+	default:
+	case 0:
+		return _gen->esi;
+	case 1:
+		return _gen->edi;
+	}
+}
+
+OperandR_M32 R4000RegisterCache::Memory( int reg )
+{
+	return OperandR_M32( _gen->dword_ptr[ _ctx + CTXREGS + ( reg << 2 ) ] );
+}
+
+int R4000RegisterCache::Find( int reg )
+{
+	for( int n = 0; n < REGCACHESLOTS; n++ )
+	{
+		if( _slots[ n ].Register == reg )
+			return n;
+	}
+	return -1;
+}
+
+int R4000RegisterCache::Allocate( int reg )
+{
+	// Prefer a free slot, otherwise evict the least recently used unlocked one
+	int slot = -1;
+	for( int n = 0; n < REGCACHESLOTS; n++ )
+	{
+		if( _slots[ n ].Register == -1 )
+		{
+			slot = n;
+			break;
+		}
+		if( _slots[ n ].Locked == true )
+			continue;
+		if( ( slot == -1 ) ||
+			( _slots[ n ].LastUse < _slots[ slot ].LastUse ) )
+			slot = n;
+	}
+
+	// Three register ops lock both slots with their sources - the caller goes to the ctx instead
+	if( slot == -1 )
+		return -1;
+
+	RegisterCacheSlot* s = &_slots[ slot ];
+	if( ( s->Register != -1 ) &&
+		( s->Dirty == true ) )
+		_gen->mov( Memory( s->Register ), HostRegister( slot ) );
+
+	s->Register = reg;
+	s->Dirty = false;
+	s->Locked = false;
+	return slot;
+}
+
+OperandR_M32 R4000RegisterCache::Read( int reg )
+{
+	if( _enabled == false )
+		return Memory( reg );
+
+	int slot = this->Find( reg );
+	if( slot == -1 )
+	{
+		slot = this->Allocate( reg );
+		if( slot == -1 )
+			return Memory( reg );
+		_gen->mov( HostRegister( slot ), Memory( reg ) );
+	}
+
+	_slots[ slot ].Locked = true;
+	_slots[ slot ].LastUse = ++_tick;
+	return OperandR_M32( HostRegister( slot ) );
+}
+
+OperandR_M32 R4000RegisterCache::Write( int reg )
+{
+	// $0 is never written - callers should have already bailed
+	Debug::Assert( reg != 0 );
+
+	if( _enabled == false )
+		return Memory( reg );
+
+	int slot = this->Find( reg );
+	if( slot == -1 )
+		slot = this->Allocate( reg );
+	if( slot == -1 )
+	{
+		// It isn't cached, so the ctx copy is the only one and can be written directly
+		return Memory( reg );
+	}
+
+	_slots[ slot ].Dirty = true;
+	_slots[ slot ].Locked = true;
+	_slots[ slot ].LastUse = ++_tick;
+	return OperandR_M32( HostRegister( slot ) );
+}
+
+OperandR_M32 R4000RegisterCache::Modify( int reg )
+{
+	Debug::Assert( reg != 0 );
+
+	OperandR_M32 op = this->Read( reg );
+	int slot = ( _enabled == true ) ? this->Find( reg ) : -1;
+	if( slot != -1 )
+		_slots[ slot ].Dirty = true;
+	return op;
+}
+
+void R4000RegisterCache::Unlock()
+{
+	for( int n = 0; n < REGCACHESLOTS; n++ )
+		_slots[ n ].Locked = false;
+}
+
+void R4000RegisterCache::Flush()
+{
+	if( _enabled == false )
+		return;
+
+	for( int n = 0; n < REGCACHESLOTS; n++ )
+	{
+		RegisterCacheSlot* s = &_slots[ n ];
+		if( ( s->Register != -1 ) &&
+			( s->Dirty == true ) )
+			_gen->mov( Memory( s->Register ), HostRegister( n ) );
+
+		s->Register = -1;
+		s->Dirty = false;
+		s->Locked = false;
+	}
+}
@@ -0,0 +1,81 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "CodeGenerator.h"
+
+using namespace Noxa::Emulation::Psp;
+using namespace Noxa::Emulation::Psp::CodeGen;
+
+// Number of host registers (ESI, EDI) that guest GPRs can live in - EBP is left as the frame
+// pointer the bounce set up, so stack walks and the debugger can still get through generated code
+#define REGCACHESLOTS	2
+
+namespace Noxa {
+	namespace Emulation {
+		namespace Psp {
+			namespace Cpu {
+
+				class R4000Generator;
+
+				typedef struct RegisterCacheSlot_t
+				{
+					int			Register;		// Guest register in this slot, or -1 if free
+					bool		Dirty;			// Host copy is newer than the one in the ctx
+					bool		Locked;			// In use by the current instruction - don't evict
+					int			LastUse;		// For LRU eviction
+				} RegisterCacheSlot;
+
+				/* Per-block guest register allocator.
+				   Instructions that know about the cache get their operands from Read/Write/Modify
+				   and can have them live in host registers for the rest of the block. Everything
+				   else still goes through the ctx, so the builder must call Flush before any code
+				   that touches the ctx directly, before any label (control flow merges) and at every
+				   block exit. ESI/EDI are callee-saved, so helper calls don't need a flush unless
+				   they read or write guest registers.
+				*/
+				class R4000RegisterCache
+				{
+				protected:
+					R4000Generator*		_gen;
+					int					_ctx;
+					bool				_enabled;
+
+					RegisterCacheSlot	_slots[ REGCACHESLOTS ];
+					int					_tick;
+
+				public:
+					R4000RegisterCache( R4000Generator* generator );
+
+					void Reset( void* ctxPointer, bool enabled );
+					bool IsEnabled(){ return _enabled; }
+
+					// Operand holding the current value of reg - if every slot is locked by the current
+					// instruction, this and Write/Modify hand back the ctx copy instead
+					OperandR_M32 Read( int reg );
+					// Operand that will receive a new value of reg (old value not loaded)
+					OperandR_M32 Write( int reg );
+					// Operand holding the current value of reg that will also be changed
+					OperandR_M32 Modify( int reg );
+
+					// Called after each instruction so its registers can be evicted again
+					void Unlock();
+
+					// Writes back dirty registers and drops all mappings
+					void Flush();
+
+				protected:
+					int Find( int reg );
+					int Allocate( int reg );
+					const OperandREG32& HostRegister( int slot );
+					OperandR_M32 Memory( int reg );
+				};
+
+			}
+		}
+	}
+}
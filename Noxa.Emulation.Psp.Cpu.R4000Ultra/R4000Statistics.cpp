@@ -21,6 +21,11 @@ uint _codeBlocksGenerated;
 
 uint _codeCacheHits;
 uint _codeCacheMisses;
+uint _codeStorageEvictions;
+uint _backgroundBlocksPublished;
+uint _backgroundBlocksDiscarded;
+uint _hotBlocksRecompiled;
+uint _idleLoopExits;
 
 uint _jumpBlockInlineCount;
 uint _jumpBlockThunkCount;
@@ -32,6 +37,8 @@ uint _jumpBlockThunkBuilds;
 uint _jumpBlockThunkHits;
 uint _jumpBlockInlineHits;
 uint _jumpBlockInlineMisses;
+uint _returnPredictionHits;
+uint _returnPredictionMisses;
 
 uint _managedMemoryReadCount;
 uint _managedMemoryWriteCount;
@@ -52,6 +59,11 @@ R4000Statistics::R4000Statistics() : CounterSource( "CPU" )
 
 	CodeCacheHits = gcnew Counter( "Code Cache Hits", "Number of lookups that resulted in a hit." );
 	CodeCacheMisses = gcnew Counter( "Code Cache Misses", "Number of lookups that resulted in a miss." );
+	CodeStorageEvictions = gcnew Counter( "Code Storage Evictions", "Number of storage blocks thrown away to stay under the code budget." );
+	BackgroundBlocksPublished = gcnew Counter( "Background Blocks Published", "Number of blocks built by the background compiler that made it in to the cache." );
+	BackgroundBlocksDiscarded = gcnew Counter( "Background Blocks Discarded", "Number of blocks built by the background compiler that were stale or never needed." );
+	HotBlocksRecompiled = gcnew Counter( "Hot Blocks Recompiled", "Number of quick blocks that ran often enough to be rebuilt with optimizations." );
+	IdleLoopExits = gcnew Counter( "Idle Loop Exits", "Number of times a block left an idle loop to give up the host thread." );
 	CodeCacheBlockCount = gcnew Counter( "Code Cache Count", "The number of code blocks contained within the cache." );
 	
 	CodeBlockLength = gcnew Counter( "Block Length", "The number of instructions per code block." );
@@ -66,6 +78,8 @@ R4000Statistics::R4000Statistics() : CounterSource( "CPU" )
 	JumpBlockThunkHits = gcnew Counter( "Jump Block Thunk Hits", "Number of hits in __missingBlockThunkM (no build needed)." );
 	JumpBlockInlineHits = gcnew Counter( "Jump Block Inline Hits", "" );
 	JumpBlockInlineMisses = gcnew Counter( "Jump Block Inline Misses", "" );
+	ReturnPredictionHits = gcnew Counter( "Return Prediction Hits", "Number of returns that jumped to the predicted block." );
+	ReturnPredictionMisses = gcnew Counter( "Return Prediction Misses", "Number of returns that had to look up their target." );
 
 	ManagedMemoryReadCount = gcnew Counter( "Managed Memory Reads", "The number of times the managed memory system handled a read." );
 	ManagedMemoryWriteCount = gcnew Counter( "Managed Memory Writes", "The number of times the managed memory system handled a write." );
@@ -86,6 +100,11 @@ R4000Statistics::R4000Statistics() : CounterSource( "CPU" )
 
 	this->RegisterCounter( this->CodeCacheHits );
 	this->RegisterCounter( this->CodeCacheMisses );
+	this->RegisterCounter( this->CodeStorageEvictions );
+	this->RegisterCounter( this->BackgroundBlocksPublished );
+	this->RegisterCounter( this->BackgroundBlocksDiscarded );
+	this->RegisterCounter( this->HotBlocksRecompiled );
+	this->RegisterCounter( this->IdleLoopExits );
 	this->RegisterCounter( this->CodeCacheBlockCount );
 	
 	this->RegisterCounter( this->CodeBlockLength );
@@ -100,6 +119,8 @@ R4000Statistics::R4000Statistics() : CounterSource( "CPU" )
 	this->RegisterCounter( this->JumpBlockThunkHits );
 	this->RegisterCounter( this->JumpBlockInlineHits );
 	this->RegisterCounter( this->JumpBlockInlineMisses );
+	this->RegisterCounter( this->ReturnPredictionHits );
+	this->RegisterCounter( this->ReturnPredictionMisses );
 
 	this->RegisterCounter( this->ManagedMemoryReadCount );
 	this->RegisterCounter( this->ManagedMemoryWriteCount );
@@ -124,6 +145,11 @@ void R4000Statistics::Sample()
 
 	CodeCacheHits->Update( _codeCacheHits );
 	CodeCacheMisses->Update( _codeCacheMisses );
+	CodeStorageEvictions->Update( _codeStorageEvictions );
+	BackgroundBlocksPublished->Update( _backgroundBlocksPublished );
+	BackgroundBlocksDiscarded->Update( _backgroundBlocksDiscarded );
+	HotBlocksRecompiled->Update( _hotBlocksRecompiled );
+	IdleLoopExits->Update( _idleLoopExits );
 	//CodeCacheBlockCount->Update( _
 
 	JumpBlockInlineCount->Update( _jumpBlockInlineCount );
@@ -136,6 +162,8 @@ void R4000Statistics::Sample()
 	JumpBlockThunkHits->Update( _jumpBlockThunkHits );
 	JumpBlockInlineHits->Update( _jumpBlockInlineHits );
 	JumpBlockInlineMisses->Update( _jumpBlockInlineMisses );
+	ReturnPredictionHits->Update( _returnPredictionHits );
+	ReturnPredictionMisses->Update( _returnPredictionMisses );
 
 	ManagedMemoryReadCount->Update( _managedMemoryReadCount );
 	ManagedMemoryWriteCount->Update( _managedMemoryWriteCount );
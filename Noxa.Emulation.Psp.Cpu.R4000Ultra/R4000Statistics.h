@@ -31,6 +31,11 @@ namespace Noxa {
 
 					Counter^	CodeCacheHits;
 					Counter^	CodeCacheMisses;
+					Counter^	CodeStorageEvictions;					// # of storage blocks evicted
+					Counter^	BackgroundBlocksPublished;				// # of blocks built by the background compiler that were used
+					Counter^	BackgroundBlocksDiscarded;				// # of blocks built by the background compiler that were thrown away
+					Counter^	HotBlocksRecompiled;					// # of quick blocks rebuilt with optimizations
+					Counter^	IdleLoopExits;							// # of idle loops that gave the host thread away
 					Counter^	CodeCacheBlockCount;					// # of blocks in the cache
 
 					Counter^	CodeBlockLength;						// # of instructions per code block
@@ -45,6 +50,8 @@ namespace Noxa {
 					Counter^	JumpBlockThunkHits;						// # of times thunks had code cache hits and just did fixups
 					Counter^	JumpBlockInlineHits;					// # of times inline block was able to find target
 					Counter^	JumpBlockInlineMisses;					// # of times inline block had to return from bounce
+					Counter^	ReturnPredictionHits;					// # of JR $ra that used the predicted block
+					Counter^	ReturnPredictionMisses;					// # of JR $ra that had to do a lookup
 
 					Counter^	ManagedMemoryReadCount;					// # of times R4000Memory was used to read instead of the inline code
 					Counter^	ManagedMemoryWriteCount;				// # of times R4000Memory was used to write instead of the inline code
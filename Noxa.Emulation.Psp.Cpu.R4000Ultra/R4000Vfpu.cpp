@@ -142,6 +142,98 @@ int VfpuImplDummy( R4000Ctx* ctx, uint address, uint code );
 // Contains _vfpuInstructions table, with _vfpuNumInstructions entries
 #include "R4000Vfpu_Instructions.h"
 
+// Decode table - indexed by the major opcode and then bits 25-16 of the code, which is enough to get
+// every bucket down to a handful of entries
+#define VFPUDECODEBITS			10
+#define VFPUDECODESIZE			( 1 << VFPUDECODEBITS )
+#define VFPUDECODEFIELD( code )	( ( ( code ) >> 16 ) & ( VFPUDECODESIZE - 1 ) )
+#define VFPUDECODEMASK			0xFFFF0000
+
+typedef struct VfpuDecodeBucket_t
+{
+	int				Start;		// Into _vfpuDecodeEntries
+	int				Count;
+} VfpuDecodeBucket;
+
+// NULL for major opcodes with no VFPU instructions
+static VfpuDecodeBucket* _vfpuDecodeGroups[ 64 ];
+// Indices in to _vfpuInstructions - each bucket has every entry that could match a code landing in it,
+// in table order, so the first match is the same one a scan of the whole table would find
+static ushort* _vfpuDecodeEntries = NULL;
+
+void Noxa::Emulation::Psp::Cpu::VfpuBuildDecoder()
+{
+	if( _vfpuDecodeEntries != NULL )
+		return;
+
+	// Once to size _vfpuDecodeEntries, once to fill it
+	int candidates[ _vfpuNumInstructions ];
+	ushort* entries = NULL;
+	for( int pass = 0; pass < 2; pass++ )
+	{
+		int offset = 0;
+		for( uint op = 0; op < 64; op++ )
+		{
+			int candidateCount = 0;
+			for( int n = 0; n < _vfpuNumInstructions; n++ )
+			{
+				if( ( ( ( op << 26 ) ^ _vfpuInstructions[ n ].Opcode ) & _vfpuInstructions[ n ].Mask & 0xFC000000 ) == 0 )
+					candidates[ candidateCount++ ] = n;
+			}
+			if( candidateCount == 0 )
+				continue;
+
+			VfpuDecodeBucket* group = NULL;
+			if( pass == 1 )
+			{
+				group = new VfpuDecodeBucket[ VFPUDECODESIZE ];
+				_vfpuDecodeGroups[ op ] = group;
+			}
+			for( uint field = 0; field < VFPUDECODESIZE; field++ )
+			{
+				uint code = ( op << 26 ) | ( field << 16 );
+				int start = offset;
+				for( int n = 0; n < candidateCount; n++ )
+				{
+					const VfpuInstruction* instr = &_vfpuInstructions[ candidates[ n ] ];
+					if( ( ( code ^ instr->Opcode ) & instr->Mask & VFPUDECODEMASK ) != 0 )
+						continue;
+					if( pass == 1 )
+						entries[ offset ] = ( ushort )candidates[ n ];
+					offset++;
+				}
+				if( pass == 1 )
+				{
+					group[ field ].Start = start;
+					group[ field ].Count = offset - start;
+				}
+			}
+		}
+		if( pass == 0 )
+			entries = new ushort[ offset ];
+	}
+
+	_vfpuDecodeEntries = entries;
+}
+
+// Returns NULL if the code isn't a VFPU instruction
+const VfpuInstruction* VfpuDecode( uint code )
+{
+	Debug::Assert( _vfpuDecodeEntries != NULL );
+	const VfpuDecodeBucket* group = _vfpuDecodeGroups[ code >> 26 ];
+	if( group == NULL )
+		return NULL;
+	const VfpuDecodeBucket* bucket = &group[ VFPUDECODEFIELD( code ) ];
+	const ushort* entries = _vfpuDecodeEntries + bucket->Start;
+	for( int n = 0; n < bucket->Count; n++ )
+	{
+		const VfpuInstruction* instr = &_vfpuInstructions[ entries[ n ] ];
+		if( ( code & instr->Mask ) == instr->Opcode )
+			return instr;
+	}
+	return NULL;
+}
+
 #pragma unmanaged
 //#define ASSERTVFPUSTATE
 //#define STOPONVFPUADDR 0x0809da44
@@ -159,21 +251,54 @@ void AssertVfpuState( R4000Ctx* ctx, uint address, uint preOrPost )
 }
 #pragma managed
 
-GenerationResult Noxa::Emulation::Psp::Cpu::TryEmitVfpu( R4000GenContext^ context, int pass, int address, uint code )
+// What the ctx holds for each prefix when nothing has been set
+static const int _vfpuPrefixDefaults[ 3 ] = { 0xE4, 0xE4, 0x00 };
+
+// Bit per VfpuPfx for the prefixes an instruction consumes (and resets)
+int VfpuUsedPrefixes( uint attributes )
+{
+	if( ( attributes & VFPU_PFX ) == VFPU_PFX )
+		return 0x7;
+	int used = 0;
+	if( ( attributes & VFPU_PFXS ) == VFPU_PFXS )
+		used |= 1 << VPFXS;
+	if( ( attributes & VFPU_PFXT ) == VFPU_PFXT )
+		used |= 1 << VPFXT;
+	if( ( attributes & VFPU_PFXD ) == VFPU_PFXD )
+		used |= 1 << VPFXD;
+	return used;
+}
+
+void EmitVfpuCall( R4000GenContext^ context, int address, uint code, VfpuInstruction* instr )
 {
-	// Look up instruction - slowly
-	bool foundInstruction = false;
-	VfpuInstruction* instr = ( VfpuInstruction* )&_vfpuInstructions[ 0 ];
-	for( int n = 0; n < _vfpuNumInstructions; n++, instr++ )
+	g->push( code );
+	g->push( ( uint )address );
+	g->Pointer();
+	g->push( ( uint )CTX );
+	g->call( ( uint )instr->Execute );
+	g->add( ESP, 12 );
+}
+
+void EmitVfpuPrefixStore( R4000GenContext^ context, int set, int value )
+{
+	g->mov( g->dword_ptr[ CTX + CTXCP2PFX + ( set << 2 ) ], value );
+}
+
+void Noxa::Emulation::Psp::Cpu::EmitVfpuPrefixStores( R4000GenContext^ context, bool sideExit )
+{
+	for( int set = VPFXS; set <= VPFXD; set++ )
 	{
-		if( ( code & instr->Mask ) == instr->Opcode )
-		{
-			// Found!
-			foundInstruction = true;
-			break;
-		}
+		if( ( context->VfpuPrefixesDirty & ( 1 << set ) ) != 0 )
+			EmitVfpuPrefixStore( context, set, context->VfpuPrefixes[ set ] );
 	}
-	if( foundInstruction == false )
+	if( sideExit == false )
+		context->VfpuPrefixesDirty = 0;
+}
+
+GenerationResult Noxa::Emulation::Psp::Cpu::TryEmitVfpu( R4000GenContext^ context, int pass, int address, uint code )
+{
+	VfpuInstruction* instr = ( VfpuInstruction* )VfpuDecode( code );
+	if( instr == NULL )
 		return GenerationResult::Invalid;
 
 #ifdef _DEBUG
@@ -230,51 +355,101 @@ GenerationResult Noxa::Emulation::Psp::Cpu::TryEmitVfpu( R4000GenContext^ contex
 #ifdef ASSERTVFPUSTATE
 		g->push( ( uint )0 );
 		g->push( ( uint )address );
+		g->Pointer();
 		g->push( ( uint )CTX );
 		g->call( ( uint )AssertVfpuState );
 		g->add( ESP, 12 );
 #endif
 
-		if( instr->Generate != VfpuGenDummy )
+		bool native = ( instr->Generate != VfpuGenDummy );
+#ifndef VFPUSSE
+		// Only instructions without a helper get generated
+		if( instr->Execute != VfpuImplDummy )
+			native = false;
+#endif
+		int usedPrefixes = VfpuUsedPrefixes( instr->Attributes );
+		int unknownPrefixes = usedPrefixes & ~context->VfpuPrefixesKnown;
+		int dirtyPrefixes = context->VfpuPrefixesDirty;
+
+		// Generators fold in the prefixes, so any we don't know are checked for the defaults and the helper
+		// (which reads them from the ctx) is used if they aren't
+		Label* slowLabel = NULL;
+		if( ( native == true ) &&
+			( instr->Execute != VfpuImplDummy ) &&
+			( unknownPrefixes != 0 ) )
+		{
+			slowLabel = g->DefineLabel();
+			for( int set = VPFXS; set <= VPFXD; set++ )
+			{
+				if( ( unknownPrefixes & ( 1 << set ) ) == 0 )
+					continue;
+				g->cmp( g->dword_ptr[ CTX + CTXCP2PFX + ( set << 2 ) ], _vfpuPrefixDefaults[ set ] );
+				g->jne( slowLabel );
+			}
+		}
+
+		// Generators return false (without emitting anything) for the forms they don't handle
+		if( native == true )
+			native = instr->Generate( context, address, code );
+		if( native == false )
 		{
-			// Emit code
-			instr->Generate( context, address, code );
+			// Even instructions that don't reset the prefixes may read them
+			EmitVfpuPrefixStores( context, false );
+			EmitVfpuCall( context, address, code, instr );
 		}
-		else
+
+		if( slowLabel != NULL )
 		{
-			// Call
-			g->push( code );
-			g->push( ( uint )address );
-			g->push( ( uint )CTX );
-			g->call( ( uint )instr->Execute );
-			g->add( ESP, 12 );
+			// Leaves the ctx holding the defaults for everything used, same as the fast path proved it did
+			Label* doneLabel = g->DefineLabel();
+			g->jmp( doneLabel );
+			g->MarkLabel( slowLabel );
+			for( int set = VPFXS; set <= VPFXD; set++ )
+			{
+				if( ( dirtyPrefixes & ( 1 << set ) ) != 0 )
+					EmitVfpuPrefixStore( context, set, context->VfpuPrefixes[ set ] );
+			}
+			EmitVfpuCall( context, address, code, instr );
+			for( int set = VPFXS; set <= VPFXD; set++ )
+			{
+				if( ( usedPrefixes & ( 1 << set ) ) != 0 )
+					EmitVfpuPrefixStore( context, set, _vfpuPrefixDefaults[ set ] );
+			}
+			g->MarkLabel( doneLabel );
 		}
 
 #ifdef ASSERTVFPUSTATE
 		g->push( ( uint )1 );
 		g->push( ( uint )address );
+		g->Pointer();
 		g->push( ( uint )CTX );
 		g->call( ( uint )AssertVfpuState );
 		g->add( ESP, 12 );
 #endif
 
-		// Clear state
-		if( ( instr->Attributes & VFPU_PFX ) == VFPU_PFX )
-		{
-			g->mov( g->dword_ptr[ CTX + CTXCP2PFX ], 0xE4 );
-			g->mov( g->dword_ptr[ CTX + CTXCP2PFX + 4 ], 0xE4 );
-			g->mov( g->dword_ptr[ CTX + CTXCP2PFX + 8 ], 0xE4 );
-			g->mov( g->dword_ptr[ CTX + CTXCP2WM ], 0x0 );
-		}
-		else
+		// Clear state - only in our copy, the ctx gets the defaults when something needs to see them
+		for( int set = VPFXS; set <= VPFXD; set++ )
 		{
-			if( ( instr->Attributes & VFPU_PFXS ) == VFPU_PFXS )
-				g->mov( g->dword_ptr[ CTX + CTXCP2PFX ], 0xE4 );
-			if( ( instr->Attributes & VFPU_PFXT ) == VFPU_PFXT )
-				g->mov( g->dword_ptr[ CTX + CTXCP2PFX + 4 ], 0xE4 );
-			if( ( instr->Attributes & VFPU_PFXD ) == VFPU_PFXD )
-				g->mov( g->dword_ptr[ CTX + CTXCP2PFX + 8 ], 0x00 );
+			int bit = 1 << set;
+			if( ( usedPrefixes & bit ) == 0 )
+				continue;
+
+			// What the ctx has for this set now - on the helper path everything dirty was stored first
+			bool holdsDefault;
+			if( ( unknownPrefixes & bit ) != 0 )
+				holdsDefault = ( slowLabel != NULL );
+			else if( ( ( dirtyPrefixes & bit ) != 0 ) && ( native == true ) )
+				holdsDefault = false;
+			else
+				holdsDefault = ( context->VfpuPrefixes[ set ] == _vfpuPrefixDefaults[ set ] );
+
+			context->VfpuPrefixes[ set ] = _vfpuPrefixDefaults[ set ];
+			if( holdsDefault == true )
+				context->VfpuPrefixesDirty &= ~bit;
+			else
+				context->VfpuPrefixesDirty |= bit;
 		}
+		context->VfpuPrefixesKnown |= usedPrefixes;
 
 		if( isBranch == true )
 		{
@@ -366,7 +541,10 @@ bool VfpuGenVPFX( R4000GenContext^ context, int address, uint code )
 {
 	int set = ( code >> 24 ) & 0x3;
 	int value = ( code & 0xFFFFF );
-	g->mov( g->dword_ptr[ CTX + CTXCP2PFX + ( set << 2 ) ], value );
+	// Nothing is emitted - the instructions using it fold it in, and it is stored if anything else needs it
+	context->VfpuPrefixes[ set ] = value;
+	context->VfpuPrefixesKnown |= 1 << set;
+	context->VfpuPrefixesDirty |= 1 << set;
 	return true;
 }
 
@@ -383,6 +561,7 @@ bool VfpuGenVPFX( R4000GenContext^ context, int address, uint code )
 
 // EAX = address in guest space, result in EAX
 void EmitAddressLookup( R4000GenContext^ context, int address, bool isRead );
+byte* EmitConstantAddress( R4000GenContext^ context, int address, byte rs, int offset, int width, bool isRead );
 
 // EmitVfpuRead and EmitVfpuWrite are taken from ector's code - they are pretty nuts :)
 
@@ -478,11 +657,20 @@ void EmitVfpuWrite( R4000GenContext^ context, VfpuWidth dataWidth, int reg, int
 
 bool VfpuGenLVS( R4000GenContext^ context, int address, uint code )
 {
-	g->mov( EAX, MREG( CTX, RS( code ) ) );
 	int imm = ( int )( ( short )( code & 0x0000FFFC ) );
-	if( imm != 0 )
-		g->add( EAX, imm );
-	EmitAddressLookup( context, address, true );
+	byte* ptr = EmitConstantAddress( context, address, ( byte )RS( code ), imm, 4, true );
+	if( ptr != NULL )
+	{
+		g->Pointer();
+		g->mov( EAX, ( int )ptr );
+	}
+	else
+	{
+		g->mov( EAX, MREG( CTX, RS( code ) ) );
+		if( imm != 0 )
+			g->add( EAX, imm );
+		EmitAddressLookup( context, address, true );
+	}
 	// EAX = address of memory start
 
 	// Perform load
@@ -494,11 +682,20 @@ bool VfpuGenLVS( R4000GenContext^ context, int address, uint code )
 
 bool VfpuGenLVQ( R4000GenContext^ context, int address, uint code )
 {
-	g->mov( EAX, MREG( CTX, RS( code ) ) );
 	int imm = ( int )( ( short )( code & 0x0000FFFC ) );
-	if( imm != 0 )
-		g->add( EAX, imm );
-	EmitAddressLookup( context, address, true );
+	byte* ptr = EmitConstantAddress( context, address, ( byte )RS( code ), imm, 16, true );
+	if( ptr != NULL )
+	{
+		g->Pointer();
+		g->mov( EAX, ( int )ptr );
+	}
+	else
+	{
+		g->mov( EAX, MREG( CTX, RS( code ) ) );
+		if( imm != 0 )
+			g->add( EAX, imm );
+		EmitAddressLookup( context, address, true );
+	}
 	// EAX = address of memory start
 
 	// Perform load
@@ -510,11 +707,20 @@ bool VfpuGenLVQ( R4000GenContext^ context, int address, uint code )
 
 bool VfpuGenSVS( R4000GenContext^ context, int address, uint code )
 {
-	g->mov( EAX, MREG( CTX, RS( code ) ) );
 	int imm = ( int )( ( short )( code & 0x0000FFFC ) );
-	if( imm != 0 )
-		g->add( EAX, imm );
-	EmitAddressLookup( context, address, false );
+	byte* ptr = EmitConstantAddress( context, address, ( byte )RS( code ), imm, 4, false );
+	if( ptr != NULL )
+	{
+		g->Pointer();
+		g->mov( EAX, ( int )ptr );
+	}
+	else
+	{
+		g->mov( EAX, MREG( CTX, RS( code ) ) );
+		if( imm != 0 )
+			g->add( EAX, imm );
+		EmitAddressLookup( context, address, false );
+	}
 	// EAX = address of memory start
 
 	// Perform store
@@ -526,11 +732,20 @@ bool VfpuGenSVS( R4000GenContext^ context, int address, uint code )
 
 bool VfpuGenSVQ( R4000GenContext^ context, int address, uint code )
 {
-	g->mov( EAX, MREG( CTX, RS( code ) ) );
 	int imm = ( int )( ( short )( code & 0x0000FFFC ) );
-	if( imm != 0 )
-		g->add( EAX, imm );
-	EmitAddressLookup( context, address, false );
+	byte* ptr = EmitConstantAddress( context, address, ( byte )RS( code ), imm, 16, false );
+	if( ptr != NULL )
+	{
+		g->Pointer();
+		g->mov( EAX, ( int )ptr );
+	}
+	else
+	{
+		g->mov( EAX, MREG( CTX, RS( code ) ) );
+		if( imm != 0 )
+			g->add( EAX, imm );
+		EmitAddressLookup( context, address, false );
+	}
 	// EAX = address of memory start
 
 	// Perform store
@@ -653,6 +868,7 @@ bool VfpuGenVCST( R4000GenContext^ context, int address, uint code )
 	int elements = _vfpuSizes[ width ];
 	int constant = ( code >> 16 ) & 0x1F;
 	float* p = ( float* )vfpuConstant4x[ constant ];
+	g->Pointer();
 	g->mov( EAX, ( uint )p );
 	EmitVfpuWrite( context, width, VRD( code ), 4 );
 	return true;
@@ -690,6 +906,517 @@ bool VfpuGenVBTFL( R4000GenContext^ context, int address, uint code )
 	return true;
 }
 
+// ------------------------------------ BEGIN SSE -----------------------------------------------------------
+// Operands are gathered in to XMM registers one lane at a time (a VFPU vector is usually a column, so its
+// elements are 128 bytes apart) with the S/T prefixes applied as we go, and scattered back the same way with
+// the D prefix applied. Rows read as a whole quad use movups.
+
+// Scratch registers for gathering - the ops themselves use XMM0-XMM5
+#define VTEMP0	XMM6
+#define VTEMP1	XMM7
+#define VREG128( xr, r ) g->xmmword_ptr[ xr + CTXCP2REGS + ( ( r ) << 2 ) ]
+
+#define VFPUABSMASK( b )	{ ( ( b ) & 1 ) ? 0x7FFFFFFF : 0xFFFFFFFF, ( ( b ) & 2 ) ? 0x7FFFFFFF : 0xFFFFFFFF, ( ( b ) & 4 ) ? 0x7FFFFFFF : 0xFFFFFFFF, ( ( b ) & 8 ) ? 0x7FFFFFFF : 0xFFFFFFFF }
+#define VFPUNEGMASK( b )	{ ( ( b ) & 1 ) ? 0x80000000 : 0, ( ( b ) & 2 ) ? 0x80000000 : 0, ( ( b ) & 4 ) ? 0x80000000 : 0, ( ( b ) & 8 ) ? 0x80000000 : 0 }
+// Indexed by a bit per lane
+__declspec( align( 16 ) ) static const uint _vfpuAbsMasks[ 16 ][ 4 ] = {
+	VFPUABSMASK( 0 ),	VFPUABSMASK( 1 ),	VFPUABSMASK( 2 ),	VFPUABSMASK( 3 ),
+	VFPUABSMASK( 4 ),	VFPUABSMASK( 5 ),	VFPUABSMASK( 6 ),	VFPUABSMASK( 7 ),
+	VFPUABSMASK( 8 ),	VFPUABSMASK( 9 ),	VFPUABSMASK( 10 ),	VFPUABSMASK( 11 ),
+	VFPUABSMASK( 12 ),	VFPUABSMASK( 13 ),	VFPUABSMASK( 14 ),	VFPUABSMASK( 15 ),
+};
+__declspec( align( 16 ) ) static const uint _vfpuNegMasks[ 16 ][ 4 ] = {
+	VFPUNEGMASK( 0 ),	VFPUNEGMASK( 1 ),	VFPUNEGMASK( 2 ),	VFPUNEGMASK( 3 ),
+	VFPUNEGMASK( 4 ),	VFPUNEGMASK( 5 ),	VFPUNEGMASK( 6 ),	VFPUNEGMASK( 7 ),
+	VFPUNEGMASK( 8 ),	VFPUNEGMASK( 9 ),	VFPUNEGMASK( 10 ),	VFPUNEGMASK( 11 ),
+	VFPUNEGMASK( 12 ),	VFPUNEGMASK( 13 ),	VFPUNEGMASK( 14 ),	VFPUNEGMASK( 15 ),
+};
+// Lower bound for each VfpuPfxSat - the upper bound is always 1
+__declspec( align( 16 ) ) static const float _vfpuSatLow[ 4 ][ 4 ] = {
+	{ -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX },
+	{ 0.0f, 0.0f, 0.0f, 0.0f },
+	{ -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX },
+	{ -1.0f, -1.0f, -1.0f, -1.0f },
+};
+__declspec( align( 16 ) ) static const float _vfpuSseOnes[ 4 ] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+// One lane of an S/T operand once its prefix has been applied
+typedef struct VfpuLane_t
+{
+	int			Register;		// Cp2 register, or -1 if the lane is a constant
+	float		Constant;		// Already negated
+	bool		Abs;
+	bool		Negate;
+} VfpuLane;
+
+// Cp2 register holding element i of vector j of reg - the same mapping VfpuGetVector uses
+int VfpuElement( VfpuWidth width, int reg, int i, int j = 0 )
+{
+	int mtx = ( reg >> 2 ) & 0x7;
+	int idx = reg & 0x3;
+	int transpose = ( reg >> 5 ) & 0x1;
+
+	int fsl;
+	switch( width )
+	{
+	case VSingle:	fsl = ( reg >> 5 ) & 3;	break;
+	case VTriple:
+	case V3x3:		fsl = ( reg >> 6 ) & 1;	break;
+	default:		fsl = ( reg >> 5 ) & 2;	break;
+	}
+
+	if( transpose )
+		return ( mtx * 4 + ( ( idx + i ) & 3 ) + ( ( fsl + j ) & 3 ) * 32 );
+	else
+		return ( mtx * 4 + ( ( idx + j ) & 3 ) + ( ( fsl + i ) & 3 ) * 32 );
+}
+
+// The prefix the instruction being emitted will see - TryEmitVfpu has already checked that any
+// we don't know are the defaults
+int VfpuPrefix( R4000GenContext^ context, VfpuPfx set )
+{
+	if( ( context->VfpuPrefixesKnown & ( 1 << set ) ) != 0 )
+		return context->VfpuPrefixes[ set ];
+	else
+		return _vfpuPrefixDefaults[ set ];
+}
+
+// Does what VfpuApplyPrefix would with a VPFXS/VPFXT value, but at compile time
+void VfpuGetLanes( VfpuWidth width, int reg, int pfx, VfpuLane* lanes, int count )
+{
+	for( int n = 0; n < count; n++ )
+	{
+		int swizzle = ( pfx >> ( n * 2 ) ) & 3;
+		int abs = ( pfx >> ( 8 + n ) ) & 1;
+		bool negate = ( ( ( pfx >> ( 16 + n ) ) & 1 ) == 1 );
+		if( ( ( pfx >> ( 12 + n ) ) & 1 ) == 1 )
+		{
+			lanes[ n ].Register = -1;
+			lanes[ n ].Constant = _vfpuConstants[ swizzle + ( abs << 2 ) ];
+			if( negate == true )
+				lanes[ n ].Constant = -lanes[ n ].Constant;
+			lanes[ n ].Abs = false;
+			lanes[ n ].Negate = false;
+		}
+		else
+		{
+			lanes[ n ].Register = VfpuElement( width, reg, swizzle );
+			lanes[ n ].Constant = 0.0f;
+			lanes[ n ].Abs = ( abs == 1 );
+			lanes[ n ].Negate = negate;
+		}
+	}
+}
+
+// Lanes that come straight from registers with no prefix
+void VfpuGetPlainLanes( VfpuLane* lanes, const int* registers, int count )
+{
+	for( int n = 0; n < count; n++ )
+	{
+		lanes[ n ].Register = registers[ n ];
+		lanes[ n ].Constant = 0.0f;
+		lanes[ n ].Abs = false;
+		lanes[ n ].Negate = false;
+	}
+}
+
+// Lane into the bottom of xr, with the rest zeroed
+void EmitVfpuLoadLane( R4000GenContext^ context, OperandXMMREG xr, const VfpuLane* lane )
+{
+	if( lane->Register >= 0 )
+		g->movss( xr, VREG( CTX, lane->Register ) );
+	else if( lane->Constant == 0.0f )
+		g->xorps( xr, xr );
+	else
+	{
+		union imm
+		{
+			int		Integer;
+			float	Float;
+		} imm;
+		imm.Float = lane->Constant;
+		g->mov( EAX, imm.Integer );
+		g->movd( xr, EAX );
+	}
+}
+
+// Gathers count lanes in to xr - lanes past count are 0 unless all 4 were read as a row
+void EmitVfpuLoad( R4000GenContext^ context, OperandXMMREG xr, const VfpuLane* lanes, int count )
+{
+	bool contiguous = ( count == 4 );
+	int absBits = 0;
+	int negBits = 0;
+	for( int n = 0; n < count; n++ )
+	{
+		if( ( lanes[ 0 ].Register < 0 ) ||
+			( lanes[ n ].Register != lanes[ 0 ].Register + n ) )
+			contiguous = false;
+		if( lanes[ n ].Abs == true )
+			absBits |= 1 << n;
+		if( lanes[ n ].Negate == true )
+			negBits |= 1 << n;
+	}
+
+	if( contiguous == true )
+		g->movups( xr, VREG128( CTX, lanes[ 0 ].Register ) );
+	else
+	{
+		EmitVfpuLoadLane( context, xr, &lanes[ 0 ] );
+		if( count >= 2 )
+		{
+			EmitVfpuLoadLane( context, VTEMP0, &lanes[ 1 ] );
+			g->unpcklps( xr, VTEMP0 );
+		}
+		if( count == 3 )
+		{
+			EmitVfpuLoadLane( context, VTEMP0, &lanes[ 2 ] );
+			g->movlhps( xr, VTEMP0 );
+		}
+		else if( count == 4 )
+		{
+			EmitVfpuLoadLane( context, VTEMP0, &lanes[ 2 ] );
+			EmitVfpuLoadLane( context, VTEMP1, &lanes[ 3 ] );
+			g->unpcklps( VTEMP0, VTEMP1 );
+			g->movlhps( xr, VTEMP0 );
+		}
+	}
+
+	if( absBits != 0 )
+		g->andps( xr, g->xmmword_ptr[ _vfpuAbsMasks[ absBits ] ] );
+	if( negBits != 0 )
+		g->xorps( xr, g->xmmword_ptr[ _vfpuNegMasks[ negBits ] ] );
+}
+
+// Loads the S (or T) operand of a vector op with its prefix applied
+void EmitVfpuLoadOperand( R4000GenContext^ context, OperandXMMREG xr, VfpuWidth width, int reg, VfpuPfx set, int count )
+{
+	VfpuLane lanes[ 4 ];
+	VfpuGetLanes( width, reg, VfpuPrefix( context, set ), lanes, count );
+	EmitVfpuLoad( context, xr, lanes, count );
+}
+
+// Scatters count lanes of xr to registers, with the saturation and write mask of pfx (a VPFXD value) - trashes xr
+void EmitVfpuStore( R4000GenContext^ context, OperandXMMREG xr, const int* registers, int count, int pfx )
+{
+	// Saturation can be done on the whole vector when every lane wants the same thing
+	int sat = pfx & 3;
+	bool uniform = true;
+	for( int n = 1; n < count; n++ )
+	{
+		if( ( ( pfx >> ( n * 2 ) ) & 3 ) != sat )
+			uniform = false;
+	}
+	if( ( uniform == true ) &&
+		( ( sat == VFPU_SAT_0_1 ) || ( sat == VFPU_SAT_1_1 ) ) )
+	{
+		g->maxps( xr, g->xmmword_ptr[ _vfpuSatLow[ sat ] ] );
+		g->minps( xr, g->xmmword_ptr[ _vfpuSseOnes ] );
+	}
+
+	bool contiguous = ( count == 4 ) && ( uniform == true ) && ( ( ( pfx >> 8 ) & 0xF ) == 0 );
+	for( int n = 1; n < count; n++ )
+	{
+		if( registers[ n ] != registers[ 0 ] + n )
+			contiguous = false;
+	}
+	if( contiguous == true )
+	{
+		g->movups( VREG128( CTX, registers[ 0 ] ), xr );
+		return;
+	}
+
+	for( int n = 0; n < count; n++ )
+	{
+		// Rotate the next lane down
+		if( n > 0 )
+			g->shufps( xr, xr, 0x39 );
+
+		// Write masked
+		if( ( ( pfx >> ( 8 + n ) ) & 1 ) == 1 )
+			continue;
+
+		int laneSat = ( pfx >> ( n * 2 ) ) & 3;
+		if( ( uniform == false ) &&
+			( ( laneSat == VFPU_SAT_0_1 ) || ( laneSat == VFPU_SAT_1_1 ) ) )
+		{
+			g->maxss( xr, g->dword_ptr[ _vfpuSatLow[ laneSat ] ] );
+			g->minss( xr, g->dword_ptr[ _vfpuSseOnes ] );
+		}
+		g->movss( VREG( CTX, registers[ n ] ), xr );
+	}
+}
+
+// Stores the D operand of a vector op with its prefix applied
+void EmitVfpuStoreOperand( R4000GenContext^ context, OperandXMMREG xr, VfpuWidth width, int reg, int count )
+{
+	int registers[ 4 ];
+	for( int n = 0; n < count; n++ )
+		registers[ n ] = VfpuElement( width, reg, n );
+	EmitVfpuStore( context, xr, registers, count, VfpuPrefix( context, VPFXD ) );
+}
+
+// Stores vector j of a matrix operand (or a vector operand, when j is 0) with no prefix
+void EmitVfpuStoreColumn( R4000GenContext^ context, OperandXMMREG xr, VfpuWidth width, int reg, int j, int count )
+{
+	int registers[ 4 ];
+	for( int n = 0; n < count; n++ )
+		registers[ n ] = VfpuElement( width, reg, n, j );
+	EmitVfpuStore( context, xr, registers, count, 0 );
+}
+
+// Loads reg in to every lane of xr
+void EmitVfpuBroadcast( R4000GenContext^ context, OperandXMMREG xr, int reg )
+{
+	g->movss( xr, VREG( CTX, reg ) );
+	g->shufps( xr, xr, 0x00 );
+}
+
+bool VfpuGenArith( R4000GenContext^ context, int address, uint code )
+{
+	int op = ( code >> 16 ) & 0x1F;
+	switch( op )
+	{
+	case 0: case 1: case 2: case 4: case 5:
+	case 16: case 17: case 22: case 24:
+		break;
+	default:
+		// Transcendentals stay in the helper
+		return false;
+	}
+
+	VfpuWidth width = VWIDTH( code );
+	int count = _vfpuSizes[ width ];
+	EmitVfpuLoadOperand( context, XMM0, width, VRS( code ), VPFXS, count );
+	switch( op )
+	{
+	/* vmov  */ case 0:
+		break;
+	/* vabs  */ case 1:
+		g->andps( XMM0, g->xmmword_ptr[ _vfpuAbsMasks[ 0xF ] ] );
+		break;
+	/* vneg  */ case 2:
+		g->xorps( XMM0, g->xmmword_ptr[ _vfpuNegMasks[ 0xF ] ] );
+		break;
+	/* vsat0 */ case 4:
+		g->maxps( XMM0, g->xmmword_ptr[ _vfpuSatLow[ VFPU_SAT_0_1 ] ] );
+		g->minps( XMM0, g->xmmword_ptr[ _vfpuSseOnes ] );
+		break;
+	/* vsat1 */ case 5:
+		g->maxps( XMM0, g->xmmword_ptr[ _vfpuSatLow[ VFPU_SAT_1_1 ] ] );
+		g->minps( XMM0, g->xmmword_ptr[ _vfpuSseOnes ] );
+		break;
+	/* vrcp  */ case 16:
+	/* vnrcp */ case 24:
+		g->movaps( XMM1, g->xmmword_ptr[ _vfpuSseOnes ] );
+		g->divps( XMM1, XMM0 );
+		if( op == 24 )
+			g->xorps( XMM1, g->xmmword_ptr[ _vfpuNegMasks[ 0xF ] ] );
+		g->movaps( XMM0, XMM1 );
+		break;
+	/* vrsq  */ case 17:
+		// rsqrtps is only good to 12 bits
+		g->sqrtps( XMM0, XMM0 );
+		g->movaps( XMM1, g->xmmword_ptr[ _vfpuSseOnes ] );
+		g->divps( XMM1, XMM0 );
+		g->movaps( XMM0, XMM1 );
+		break;
+	/* vsqrt */ case 22:
+		g->sqrtps( XMM0, XMM0 );
+		break;
+	}
+	EmitVfpuStoreOperand( context, XMM0, width, VRD( code ), count );
+	return true;
+}
+
+bool VfpuGenArith3( R4000GenContext^ context, int address, uint code )
+{
+	VfpuWidth width = VWIDTH( code );
+	int count = _vfpuSizes[ width ];
+	EmitVfpuLoadOperand( context, XMM0, width, VRS( code ), VPFXS, count );
+	EmitVfpuLoadOperand( context, XMM1, width, VRT( code ), VPFXT, count );
+	switch( ( ( code >> 26 ) << 3 ) | ( ( code >> 23 ) & 7 ) )
+	{
+	/* vadd  */ case ( 24 << 3 ) | 0:	g->addps( XMM0, XMM1 );	break;
+	/* vsub  */ case ( 24 << 3 ) | 1:	g->subps( XMM0, XMM1 );	break;
+	/* vdiv  */ case ( 24 << 3 ) | 7:	g->divps( XMM0, XMM1 );	break;
+	/* vmul  */ case ( 25 << 3 ) | 0:	g->mulps( XMM0, XMM1 );	break;
+	default:
+		Debug::Assert( false );
+		break;
+	}
+	EmitVfpuStoreOperand( context, XMM0, width, VRD( code ), count );
+	return true;
+}
+
+bool VfpuGenVMINMAX( R4000GenContext^ context, int address, uint code )
+{
+	VfpuWidth width = VWIDTH( code );
+	int count = _vfpuSizes[ width ];
+	EmitVfpuLoadOperand( context, XMM0, width, VRS( code ), VPFXS, count );
+	EmitVfpuLoadOperand( context, XMM1, width, VRT( code ), VPFXT, count );
+	// Same NaN behavior as the min/max macros - the second operand wins
+	if( ( ( code >> 23 ) & 1 ) == 0 )
+		g->minps( XMM0, XMM1 );
+	else
+		g->maxps( XMM0, XMM1 );
+	EmitVfpuStoreOperand( context, XMM0, width, VRD( code ), count );
+	return true;
+}
+
+bool VfpuGenVDOT( R4000GenContext^ context, int address, uint code )
+{
+	VfpuWidth width = VWIDTH( code );
+	int count = _vfpuSizes[ width ];
+	EmitVfpuLoadOperand( context, XMM0, width, VRS( code ), VPFXS, count );
+	EmitVfpuLoadOperand( context, XMM1, width, VRT( code ), VPFXT, count );
+	g->mulps( XMM0, XMM1 );
+
+	// Fold down in to lane 0 - unused lanes are 0
+	if( count > 2 )
+	{
+		g->movhlps( XMM1, XMM0 );
+		g->addps( XMM0, XMM1 );
+	}
+	g->movaps( XMM1, XMM0 );
+	g->shufps( XMM1, XMM1, 0x55 );
+	g->addss( XMM0, XMM1 );
+
+	EmitVfpuStoreOperand( context, XMM0, VSingle, VRD( code ), 1 );
+	return true;
+}
+
+bool VfpuGenVSCL( R4000GenContext^ context, int address, uint code )
+{
+	VfpuWidth width = VWIDTH( code );
+	int count = _vfpuSizes[ width ];
+	EmitVfpuLoadOperand( context, XMM0, width, VRS( code ), VPFXS, count );
+	// Like the helper, the scale ignores VPFXT
+	EmitVfpuBroadcast( context, XMM1, VRT( code ) );
+	g->mulps( XMM0, XMM1 );
+	EmitVfpuStoreOperand( context, XMM0, width, VRD( code ), count );
+	return true;
+}
+
+bool VfpuGenVCRSP( R4000GenContext^ context, int address, uint code )
+{
+	// vqmul.q stays in the helper
+	VfpuWidth width = VWIDTH( code );
+	if( width != VTriple )
+		return false;
+
+	EmitVfpuLoadOperand( context, XMM0, width, VRS( code ), VPFXS, 3 );
+	EmitVfpuLoadOperand( context, XMM1, width, VRT( code ), VPFXT, 3 );
+
+	// s.yzx * t.zxy - s.zxy * t.yzx
+	g->movaps( XMM2, XMM0 );
+	g->shufps( XMM2, XMM2, 0xC9 );
+	g->movaps( XMM3, XMM1 );
+	g->shufps( XMM3, XMM3, 0xD2 );
+	g->mulps( XMM2, XMM3 );
+	g->shufps( XMM0, XMM0, 0xD2 );
+	g->shufps( XMM1, XMM1, 0xC9 );
+	g->mulps( XMM0, XMM1 );
+	g->subps( XMM2, XMM0 );
+
+	EmitVfpuStoreOperand( context, XMM2, width, VRD( code ), 3 );
+	return true;
+}
+
+bool VfpuGenVTFM( R4000GenContext^ context, int address, uint code )
+{
+	VfpuWidth width = VWIDTH( code );
+	VfpuWidth matrixWidth = VMATRIXWIDTH( code );
+	int count = _vfpuSizes[ width ];
+	int vs = VRS( code );
+	int vt = VRT( code );
+
+	// d = sum over m of t[ m ] * (element m of every vector of S) - nothing is written until the end,
+	// so D can be S or T
+	for( int m = 0; m < count; m++ )
+	{
+		int registers[ 4 ];
+		VfpuLane lanes[ 4 ];
+		for( int n = 0; n < count; n++ )
+			registers[ n ] = VfpuElement( matrixWidth, vs, m, n );
+		VfpuGetPlainLanes( lanes, registers, count );
+
+		OperandXMMREG xr = ( m == 0 ) ? XMM0 : XMM1;
+		EmitVfpuLoad( context, xr, lanes, count );
+		EmitVfpuBroadcast( context, XMM2, VfpuElement( width, vt, m ) );
+		g->mulps( xr, XMM2 );
+		if( m > 0 )
+			g->addps( XMM0, XMM1 );
+	}
+
+	EmitVfpuStoreColumn( context, XMM0, width, VRD( code ), 0, count );
+	return true;
+}
+
+bool VfpuGenVMMUL( R4000GenContext^ context, int address, uint code )
+{
+	VfpuWidth width = VMATRIXWIDTH( code );
+	int count = _vfpuSizes[ VWIDTH( code ) ];
+	int vs = VRS( code );
+	int vt = VRT( code );
+	int vd = VRD( code );
+
+	// Column a of D is the sum over c of T[ a ][ c ] * (element c of every column of S), so S is
+	// loaded transposed in to XMM2+ and T is read as it is needed. For 4x4 there aren't enough registers
+	// to hold D until the end, so each column is stored as soon as it is done - that is only safe if none
+	// of them land on T
+	bool holdResults = ( count < 4 );
+	if( holdResults == false )
+	{
+		for( int a = 0; a < count; a++ )
+		{
+			for( int b = 0; b < count; b++ )
+			{
+				int dr = VfpuElement( width, vd, b, a );
+				for( int c = 0; c < count * count; c++ )
+				{
+					if( dr == VfpuElement( width, vt, c % count, c / count ) )
+						return false;
+				}
+			}
+		}
+	}
+
+	OperandXMMREG sregs[ 4 ] = { XMM2, XMM3, XMM4, XMM5 };
+	for( int c = 0; c < count; c++ )
+	{
+		int registers[ 4 ];
+		VfpuLane lanes[ 4 ];
+		for( int b = 0; b < count; b++ )
+			registers[ b ] = VfpuElement( width, vs, c, b );
+		VfpuGetPlainLanes( lanes, registers, count );
+		EmitVfpuLoad( context, sregs[ c ], lanes, count );
+	}
+
+	// Held results go in the registers after S - the gather temps are free once S is loaded
+	OperandXMMREG dregs[ 3 ] = { XMM5, XMM6, XMM7 };
+	for( int a = 0; a < count; a++ )
+	{
+		OperandXMMREG xr = ( holdResults == true ) ? dregs[ a ] : XMM0;
+		EmitVfpuBroadcast( context, xr, VfpuElement( width, vt, 0, a ) );
+		g->mulps( xr, sregs[ 0 ] );
+		for( int c = 1; c < count; c++ )
+		{
+			EmitVfpuBroadcast( context, XMM1, VfpuElement( width, vt, c, a ) );
+			g->mulps( XMM1, sregs[ c ] );
+			g->addps( xr, XMM1 );
+		}
+
+		if( holdResults == false )
+			EmitVfpuStoreColumn( context, xr, width, vd, a, count );
+	}
+	if( holdResults == true )
+	{
+		for( int a = 0; a < count; a++ )
+			EmitVfpuStoreColumn( context, dregs[ a ], width, vd, a, count );
+	}
+	return true;
+}
+
 // ----------------------------------- BEGIN IMPL -----------------------------------------------------------
 // Everything below here is unmanaged!
 #pragma unmanaged
@@ -786,12 +1513,18 @@ void VfpuApplyPrefix( R4000Ctx* ctx, VfpuPfx pfx, VfpuWidth dataWidth, float* p
 		// A value of E4 indicates a passthrough
 		if( pfxValue == 0xE4 )
 			return;
+		float source[ 4 ];
+		for( int n = 0; n < _vfpuSizes[ dataWidth ]; n++ )
+			source[ n ] = p[ n ];
 		for( int n = 0; n < _vfpuSizes[ dataWidth ]; n++ )
 		{
 			int abs = ( ( pfxValue >> ( 8 + n ) ) & 1 );
 			if( ( ( pfxValue >> ( 12 + n ) ) & 1 ) == 0 )
 			{
-				// Source from input vector - which is already set
+				// Source from input vector - only the lanes we read can be swizzled in
+				int swizzle = ( pfxValue >> ( n * 2 ) ) & 3;
+				if( swizzle < _vfpuSizes[ dataWidth ] )
+					p[ n ] = source[ swizzle ];
 				if( abs == 1 )
 					p[ n ] = fabs( p[ n ] );
 			}
@@ -1121,7 +1854,7 @@ int VfpuImplVDOT( R4000Ctx* ctx, uint address, uint code )
 	VfpuGetVector( ctx, width, VRT( code ), t );
 	VfpuApplyPrefix( ctx, VPFXT, width, t );
 	for( int n = 0; n < _vfpuSizes[ width ]; n++ )
-		d += s[ n ] + t[ n ];
+		d += s[ n ] * t[ n ];
 	VfpuApplyPrefix( ctx, VPFXD, VSingle, &d );
 	VfpuSetVector( ctx, VSingle, VRD( code ), &d );
 	return 0;
@@ -20,9 +20,18 @@ namespace Noxa {
 		namespace Psp {
 			namespace Cpu {
 
+				// Builds the table TryEmitVfpu decodes with - must be called before any blocks are built
+				void VfpuBuildDecoder();
+
 				// Tries to emit a VFPU instruction - if result is Invalid, the instruction was not matched
 				GenerationResult TryEmitVfpu( R4000GenContext^ context, int pass, int address, uint code );
 
+				// Stores the VPFX state the block has built up but not written to the ctx - needed wherever
+				// something other than generated VFPU code could look at it (helpers, labels, syscalls, exits)
+				// If sideExit is set the code is on a path that leaves the block, so the state stays dirty for
+				// the path that carries on
+				void EmitVfpuPrefixStores( R4000GenContext^ context, bool sideExit );
+
 			}
 		}
 	}
@@ -20,6 +20,14 @@ DEFGEN( VfpuGenVFIM );
 DEFGEN( VfpuGenVCST );
 DEFGEN( VfpuGenVBTF );
 DEFGEN( VfpuGenVBTFL );
+DEFGEN( VfpuGenArith );
+DEFGEN( VfpuGenArith3 );
+DEFGEN( VfpuGenVMINMAX );
+DEFGEN( VfpuGenVDOT );
+DEFGEN( VfpuGenVSCL );
+DEFGEN( VfpuGenVCRSP );
+DEFGEN( VfpuGenVTFM );
+DEFGEN( VfpuGenVMMUL );
 DEFIMPL( VfpuImplVSCL );
 DEFIMPL( VfpuImplArith );
 DEFIMPL( VfpuImplArith3 );
@@ -70,16 +78,16 @@ const VfpuInstruction _vfpuInstructions[] = {
 {"mfvc",		"t,?q",				0x48600000, 0xffe0ff00, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vmtvc",		"?q,?s0y",			0xd0510000, 0xffff8000, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vmfvc",		"?d0z,?r",			0xd0500000, 0xffff0080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
-{"vadd.q",		"?d3d,?s3s,?t3t",	0x60008080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vsub.q",		"?d3d,?s3s,?t3t",	0x60808080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vdiv.q",		"?x3z,?s3y,?t3x",	0x63808080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vmul.q",		"?d3d,?s3s,?t3t",	0x64008080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vdot.q",		"?d0d,?s3s,?t3t",	0x64808080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVDOT		},
-{"vscl.q",		"?d3d,?s3s,?t0x",	0x65008080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVSCL		},
+{"vadd.q",		"?d3d,?s3s,?t3t",	0x60008080, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vsub.q",		"?d3d,?s3s,?t3t",	0x60808080, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vdiv.q",		"?x3z,?s3y,?t3x",	0x63808080, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vmul.q",		"?d3d,?s3s,?t3t",	0x64008080, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vdot.q",		"?d0d,?s3s,?t3t",	0x64808080, 0xff808080, VFPU_PFX,		VfpuGenVDOT,		VfpuImplVDOT		},
+{"vscl.q",		"?d3d,?s3s,?t0x",	0x65008080, 0xff808080, VFPU_PFX,		VfpuGenVSCL,		VfpuImplVSCL		},
 {"vhdp.q",		"?d0d,?s3y,?t3t",	0x66008080, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vcmp.q",		"?f2,?s3s,?t3t",	0x6c008080, 0xff8080f0, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVCMP		},
-{"vmin.q",		"?d3d,?s3s,?t3t",	0x6d008080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVMIN		},
-{"vmax.q",		"?d3d,?s3s,?t3t",	0x6d808080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVMAX		},
+{"vmin.q",		"?d3d,?s3s,?t3t",	0x6d008080, 0xff808080, VFPU_PFX,		VfpuGenVMINMAX,		VfpuImplVMIN		},
+{"vmax.q",		"?d3d,?s3s,?t3t",	0x6d808080, 0xff808080, VFPU_PFX,		VfpuGenVMINMAX,		VfpuImplVMAX		},
 {"vsgn.q",		"?d3d,?s3s",		0xd04a8080, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vcst.q",		"?d3d,?a",			0xd0608080, 0xffe0ff80, VFPU_NORMAL,	VfpuGenVCST,		VfpuImplDummy		},
 {"vscmp.q",		"?d3d,?s3s,?t3t",	0x6e808080, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
@@ -89,23 +97,23 @@ const VfpuInstruction _vfpuInstructions[] = {
 {"vi2c.q",		"?d0m,?s3w",		0xd03d8080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVI2X		},
 {"vi2us.q",		"?d1m,?s3w",		0xd03e8080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVI2X		},
 {"vi2s.q",		"?d1m,?s3w",		0xd03f8080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVI2X		},
-{"vmov.q",		"?d3d,?s3s",		0xd0008080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vabs.q",		"?d3d,?s3w",		0xd0018080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vneg.q",		"?d3d,?s3w",		0xd0028080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vmov.q",		"?d3d,?s3s",		0xd0008080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vabs.q",		"?d3d,?s3w",		0xd0018080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vneg.q",		"?d3d,?s3w",		0xd0028080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vidt.q",		"?d3d",				0xd0038080, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVIDT		},
-{"vsat0.q",		"?d3z,?s3s",		0xd0048080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vsat1.q",		"?d3z,?s3s",		0xd0058080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vsat0.q",		"?d3z,?s3s",		0xd0048080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vsat1.q",		"?d3z,?s3s",		0xd0058080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vzero.q",		"?d3d",				0xd0068080, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVectorInit	},
 {"vone.q",		"?d3d",				0xd0078080, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVectorInit	},
-{"vrcp.q",		"?x3z,?s3y",		0xd0108080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vrsq.q",		"?x3z,?s3y",		0xd0118080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vrcp.q",		"?x3z,?s3y",		0xd0108080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vrsq.q",		"?x3z,?s3y",		0xd0118080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vsin.q",		"?x3z,?s3y",		0xd0128080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vcos.q",		"?x3z,?s3y",		0xd0138080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vexp2.q",		"?x3z,?s3y",		0xd0148080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vlog2.q",		"?x3z,?s3y",		0xd0158080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vsqrt.q",		"?x3z,?s3y",		0xd0168080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vsqrt.q",		"?x3z,?s3y",		0xd0168080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vasin.q",		"?x3z,?s3y",		0xd0178080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vnrcp.q",		"?x3z,?s3y",		0xd0188080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vnrcp.q",		"?x3z,?s3y",		0xd0188080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vnsin.q",		"?x3z,?s3y",		0xd01a8080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vrexp2.q",	"?x3z,?s3y",		0xd01c8080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vrndi.q",		"?d3z",				0xd0218080, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
@@ -128,8 +136,8 @@ const VfpuInstruction _vfpuInstructions[] = {
 {"vi2f.q",		"?d3d,?s3w,?b",		0xd2808080, 0xffe08080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVI2F		},
 {"vcmovt.q",	"?d3d,?s3s,?e",		0xd2a08080, 0xfff88080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVCMOV		},
 {"vcmovf.q",	"?d3d,?s3s,?e",		0xd2a88080, 0xfff88080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVCMOV		},
-{"vmmul.q",		"?v7z,?s7y,?t7x",	0xf0008080, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVMMUL		},
-{"vtfm4.q",		"?v3z,?s7y,?t3x",	0xf1808080, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVTFM		},
+{"vmmul.q",		"?v7z,?s7y,?t7x",	0xf0008080, 0xff808080, VFPU_NORMAL,	VfpuGenVMMUL,		VfpuImplVMMUL		},
+{"vtfm4.q",		"?v3z,?s7y,?t3x",	0xf1808080, 0xff808080, VFPU_NORMAL,	VfpuGenVTFM,		VfpuImplVTFM		},
 {"vhtfm4.q",	"?v3z,?s7y,?t3x",	0xf1808000, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVHTFM		},
 {"vmscl.q",		"?x7z,?s7y,?t0x",	0xf2008080, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVMSCL		},
 {"vqmul.q",		"?v3z,?s3y,?t3x",	0xf2808080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVCRSP		},
@@ -141,40 +149,40 @@ const VfpuInstruction _vfpuInstructions[] = {
 {"vt4444.q",	"?d1z,?s3w",		0xd0598080, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vt5551.q",	"?d1z,?s3w",		0xd05a8080, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vt5650.q",	"?d1z,?s3w",		0xd05b8080, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
-{"vadd.t",		"?d2d,?s2s,?t2t",	0x60008000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vsub.t",		"?d2d,?s2s,?t2t",	0x60808000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vdiv.t",		"?x2z,?s2y,?t2x",	0x63808000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vmul.t",		"?d2d,?s2s,?t2t",	0x64008000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vdot.t",		"?d0d,?s2s,?t2t",	0x64808000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVDOT		},
-{"vscl.t",		"?d2d,?s2s,?t0x",	0x65008000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVSCL		},
+{"vadd.t",		"?d2d,?s2s,?t2t",	0x60008000, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vsub.t",		"?d2d,?s2s,?t2t",	0x60808000, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vdiv.t",		"?x2z,?s2y,?t2x",	0x63808000, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vmul.t",		"?d2d,?s2s,?t2t",	0x64008000, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vdot.t",		"?d0d,?s2s,?t2t",	0x64808000, 0xff808080, VFPU_PFX,		VfpuGenVDOT,		VfpuImplVDOT		},
+{"vscl.t",		"?d2d,?s2s,?t0x",	0x65008000, 0xff808080, VFPU_PFX,		VfpuGenVSCL,		VfpuImplVSCL		},
 {"vhdp.t",		"?d0d,?s2y,?t2t",	0x66008000, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vcrs.t",		"?d2d,?s2y,?t2x",	0x66808000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVCRS		},
 {"vcmp.t",		"?f2,?s2s,?t2t",	0x6c008000, 0xff8080f0, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVCMP		},
 {"vcmp.t",		"?f1,?s2s",			0x6c008000, 0xffff80f0, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVCMP		},
 {"vcmp.t",		"?f0",				0x6c008000, 0xfffffff0, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVCMP		},
-{"vmin.t",		"?d2d,?s2s,?t2t",	0x6d008000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVMIN		},
-{"vmax.t",		"?d2d,?s2s,?t2t",	0x6d808000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVMAX		},
+{"vmin.t",		"?d2d,?s2s,?t2t",	0x6d008000, 0xff808080, VFPU_PFX,		VfpuGenVMINMAX,		VfpuImplVMIN		},
+{"vmax.t",		"?d2d,?s2s,?t2t",	0x6d808000, 0xff808080, VFPU_PFX,		VfpuGenVMINMAX,		VfpuImplVMAX		},
 {"vsgn.t",		"?d2d,?s2s",		0xd04a8000, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vcst.t",		"?d2d,?a",			0xd0608000, 0xffe0ff80, VFPU_NORMAL,	VfpuGenVCST,		VfpuImplDummy		},
 {"vscmp.t",		"?d2d,?s2s,?t2t",	0x6e808000, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vsge.t",		"?d2d,?s2s,?t2t",	0x6f008000, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vslt.t",		"?d2d,?s2s,?t2t",	0x6f808000, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
-{"vmov.t",		"?d2d,?s2s",		0xd0008000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vabs.t",		"?d2d,?s2w",		0xd0018000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vneg.t",		"?d2d,?s2w",		0xd0028000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vsat0.t",		"?d2z,?s2s",		0xd0048000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vsat1.t",		"?d2z,?s2s",		0xd0058000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vmov.t",		"?d2d,?s2s",		0xd0008000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vabs.t",		"?d2d,?s2w",		0xd0018000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vneg.t",		"?d2d,?s2w",		0xd0028000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vsat0.t",		"?d2z,?s2s",		0xd0048000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vsat1.t",		"?d2z,?s2s",		0xd0058000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vzero.t",		"?d2d",				0xd0068000, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVectorInit	},
 {"vone.t",		"?d2d",				0xd0078000, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVectorInit	},
-{"vrcp.t",		"?x2z,?s2y",		0xd0108000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vrsq.t",		"?x2z,?s2y",		0xd0118000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vrcp.t",		"?x2z,?s2y",		0xd0108000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vrsq.t",		"?x2z,?s2y",		0xd0118000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vsin.t",		"?x2z,?s2y",		0xd0128000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vcos.t",		"?x2z,?s2y",		0xd0138000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vexp2.t",		"?x2z,?s2y",		0xd0148000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vlog2.t",		"?x2z,?s2y",		0xd0158000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vsqrt.t",		"?x2z,?s2y",		0xd0168000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vsqrt.t",		"?x2z,?s2y",		0xd0168000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vasin.t",		"?x2z,?s2y",		0xd0178000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vnrcp.t",		"?x2z,?s2y",		0xd0188000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vnrcp.t",		"?x2z,?s2y",		0xd0188000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vnsin.t",		"?x2z,?s2y",		0xd01a8000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vrexp2.t",	"?x2z,?s2y",		0xd01c8000, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vrndi.t",		"?d2z",				0xd0218000, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
@@ -190,8 +198,8 @@ const VfpuInstruction _vfpuInstructions[] = {
 {"vi2f.t",		"?d2d,?s2w,?b",		0xd2808000, 0xffe08080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVI2F		},
 {"vcmovt.t",	"?d2d,?s2s,?e",		0xd2a08000, 0xfff88080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVCMOV		},
 {"vcmovf.t",	"?d2d,?s2s,?e",		0xd2a88000, 0xfff88080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVCMOV		},
-{"vmmul.t",		"?v6z,?s6y,?t6x",	0xf0008000, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVMMUL		},
-{"vtfm3.t",		"?v2z,?s6y,?t2x",	0xf1008000, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVTFM		},
+{"vmmul.t",		"?v6z,?s6y,?t6x",	0xf0008000, 0xff808080, VFPU_NORMAL,	VfpuGenVMMUL,		VfpuImplVMMUL		},
+{"vtfm3.t",		"?v2z,?s6y,?t2x",	0xf1008000, 0xff808080, VFPU_NORMAL,	VfpuGenVTFM,		VfpuImplVTFM		},
 {"vhtfm3.t",	"?v2z,?s6y,?t2x",	0xf1000080, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVHTFM		},
 {"vmscl.t",		"?x6z,?s6y,?t0x",	0xf2008000, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVMSCL		},
 {"vmmov.t",		"?x6z,?s6y",		0xf3808000, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVMMOV		},
@@ -199,18 +207,18 @@ const VfpuInstruction _vfpuInstructions[] = {
 {"vmzero.t",	"?d6z",				0xf3868000, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplMatrixInit	},
 {"vmone.t",		"?d6z",				0xf3878000, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplMatrixInit	},
 {"vrot.t",		"?x2z,?s0y,?w",		0xf3a08000, 0xffe08080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVROT		},
-{"vcrsp.t",		"?d2z,?s2y,?t2x",	0xf2808000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVCRSP		},
-{"vadd.p",		"?d1d,?s1s,?t1t",	0x60000080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vsub.p",		"?d1d,?s1s,?t1t",	0x60800080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vdiv.p",		"?x1z,?s1y,?t1x",	0x63800080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vmul.p",		"?d1d,?s1s,?t1t",	0x64000080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vdot.p",		"?d0d,?s1s,?t1t",	0x64800080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVDOT		},
-{"vscl.p",		"?d1d,?s1s,?t0x",	0x65000080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVSCL		},
+{"vcrsp.t",		"?d2z,?s2y,?t2x",	0xf2808000, 0xff808080, VFPU_PFX,		VfpuGenVCRSP,		VfpuImplVCRSP		},
+{"vadd.p",		"?d1d,?s1s,?t1t",	0x60000080, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vsub.p",		"?d1d,?s1s,?t1t",	0x60800080, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vdiv.p",		"?x1z,?s1y,?t1x",	0x63800080, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vmul.p",		"?d1d,?s1s,?t1t",	0x64000080, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vdot.p",		"?d0d,?s1s,?t1t",	0x64800080, 0xff808080, VFPU_PFX,		VfpuGenVDOT,		VfpuImplVDOT		},
+{"vscl.p",		"?d1d,?s1s,?t0x",	0x65000080, 0xff808080, VFPU_PFX,		VfpuGenVSCL,		VfpuImplVSCL		},
 {"vhdp.p",		"?d0d,?s1y,?t1t",	0x66000080, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vdet.p",		"?d0d,?s1s,?t1x",	0x67000080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVDET		},
 {"vcmp.p",		"?f2,?s1s,?t1t",	0x6c000080, 0xff8080f0, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVCMP		},
-{"vmin.p",		"?d1d,?s1s,?t1t",	0x6d000080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVMIN		},
-{"vmax.p",		"?d1d,?s1s,?t1t",	0x6d800080, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVMAX		},
+{"vmin.p",		"?d1d,?s1s,?t1t",	0x6d000080, 0xff808080, VFPU_PFX,		VfpuGenVMINMAX,		VfpuImplVMIN		},
+{"vmax.p",		"?d1d,?s1s,?t1t",	0x6d800080, 0xff808080, VFPU_PFX,		VfpuGenVMINMAX,		VfpuImplVMAX		},
 {"vsgn.p",		"?d1d,?s1s",		0xd04a0080, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vcst.p",		"?d1d,?a",			0xd0600080, 0xffe0ff80, VFPU_NORMAL,	VfpuGenVCST,		VfpuImplDummy		},
 {"vscmp.p",		"?d1d,?s1s,?t1t",	0x6e800080, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
@@ -221,23 +229,23 @@ const VfpuInstruction _vfpuInstructions[] = {
 {"vi2us.p",		"?d0m,?s1w",		0xd03e0080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVI2X		},
 {"vi2s.p",		"?d0m,?s1w",		0xd03f0080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVI2X		},
 {"vuc2ifs.s",	"?d0m,?s1w",		0xd0380000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVUC2IFS		},
-{"vmov.p",		"?d1d,?s1s",		0xd0000080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vabs.p",		"?d1d,?s1w",		0xd0010080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vneg.p",		"?d1d,?s1w",		0xd0020080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vmov.p",		"?d1d,?s1s",		0xd0000080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vabs.p",		"?d1d,?s1w",		0xd0010080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vneg.p",		"?d1d,?s1w",		0xd0020080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vidt.p",		"?d1d",				0xd0030080, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVIDT		},
-{"vsat0.p",		"?d1z,?s1s",		0xd0040080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vsat1.p",		"?d1z,?s1s",		0xd0050080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vsat0.p",		"?d1z,?s1s",		0xd0040080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vsat1.p",		"?d1z,?s1s",		0xd0050080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vzero.p",		"?d1d",				0xd0060080, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVectorInit	},
 {"vone.p",		"?d1d",				0xd0070080, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVectorInit	},
-{"vrcp.p",		"?x1z,?s1y",		0xd0100080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vrsq.p",		"?x1z,?s1y",		0xd0110080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vrcp.p",		"?x1z,?s1y",		0xd0100080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vrsq.p",		"?x1z,?s1y",		0xd0110080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vsin.p",		"?x1z,?s1y",		0xd0120080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vcos.p",		"?x1z,?s1y",		0xd0130080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vexp2.p",		"?x1z,?s1y",		0xd0140080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vlog2.p",		"?x1z,?s1y",		0xd0150080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vsqrt.p",		"?x1z,?s1y",		0xd0160080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vsqrt.p",		"?x1z,?s1y",		0xd0160080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vasin.p",		"?x1z,?s1y",		0xd0170080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vnrcp.p",		"?x1z,?s1y",		0xd0180080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vnrcp.p",		"?x1z,?s1y",		0xd0180080, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vnsin.p",		"?x1z,?s1y",		0xd01a0080, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vrexp2.p",	"?x1z,?s1y",		0xd01c0080, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vrndi.p",		"?d1z",				0xd0210080, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
@@ -257,8 +265,8 @@ const VfpuInstruction _vfpuInstructions[] = {
 {"vi2f.p",		"?d1d,?s1w,?b",		0xd2800080, 0xffe08080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVI2F		},
 {"vcmovt.p",	"?d1d,?s1s,?e",		0xd2a00080, 0xfff88080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVCMOV		},
 {"vcmovf.p",	"?d1d,?s1s,?e",		0xd2a80080, 0xfff88080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVCMOV		},
-{"vmmul.p",		"?v5z,?s5y,?t5x",	0xf0000080, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVMMUL		},
-{"vtfm2.p",		"?v1z,?s5y,?t1x",	0xf0800080, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVTFM		},
+{"vmmul.p",		"?v5z,?s5y,?t5x",	0xf0000080, 0xff808080, VFPU_NORMAL,	VfpuGenVMMUL,		VfpuImplVMMUL		},
+{"vtfm2.p",		"?v1z,?s5y,?t1x",	0xf0800080, 0xff808080, VFPU_NORMAL,	VfpuGenVTFM,		VfpuImplVTFM		},
 {"vhtfm2.p",	"?v1z,?s5y,?t1x",	0xf0800000, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVHTFM		},
 {"vmscl.p",		"?x5z,?s5y,?t0x",	0xf2000080, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVMSCL		},
 {"vmmov.p",		"?x5z,?s5y",		0xf3800080, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVMMOV		},
@@ -266,13 +274,13 @@ const VfpuInstruction _vfpuInstructions[] = {
 {"vmzero.p",	"?d5z",				0xf3860080, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplMatrixInit	},
 {"vmone.p",		"?d5z",				0xf3870080, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplMatrixInit	},
 {"vrot.p",		"?x1z,?s0y,?w",		0xf3a00080, 0xffe08080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVROT		},
-{"vadd.s",		"?d0d,?s0s,?t0t",	0x60000000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vsub.s",		"?d0d,?s0s,?t0t",	0x60800000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vdiv.s",		"?x0d,?s0s,?t0t",	0x63800000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
-{"vmul.s",		"?d0d,?s0s,?t0t",	0x64000000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith3		},
+{"vadd.s",		"?d0d,?s0s,?t0t",	0x60000000, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vsub.s",		"?d0d,?s0s,?t0t",	0x60800000, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vdiv.s",		"?x0d,?s0s,?t0t",	0x63800000, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
+{"vmul.s",		"?d0d,?s0s,?t0t",	0x64000000, 0xff808080, VFPU_PFX,		VfpuGenArith3,		VfpuImplArith3		},
 {"vcmp.s",		"?f2,?s0s,?t0t",	0x6c000000, 0xff8080f0, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVCMP		},
-{"vmin.s",		"?d0d,?s0s,?t0t",	0x6d000000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVMIN		},
-{"vmax.s",		"?d0d,?s0s,?t0t",	0x6d800000, 0xff808080, VFPU_PFX,		VfpuGenDummy,		VfpuImplVMAX		},
+{"vmin.s",		"?d0d,?s0s,?t0t",	0x6d000000, 0xff808080, VFPU_PFX,		VfpuGenVMINMAX,		VfpuImplVMIN		},
+{"vmax.s",		"?d0d,?s0s,?t0t",	0x6d800000, 0xff808080, VFPU_PFX,		VfpuGenVMINMAX,		VfpuImplVMAX		},
 {"vsgn.s",		"?d0d,?s0s",		0xd04a0000, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vcst.s",		"?d0d,?a",			0xd0600000, 0xffe0ff80, VFPU_NORMAL,	VfpuGenVCST,		VfpuImplDummy		},
 {"vscmp.s",		"?d0d,?s0s,?t0t",	0x6e800000, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
@@ -280,22 +288,22 @@ const VfpuInstruction _vfpuInstructions[] = {
 {"vslt.s",		"?d0d,?s0s,?t0t",	0x6f800000, 0xff808080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vus2i.s",		"?d1m,?s0y",		0xd03a0000, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vs2i.s",		"?d1m,?s0y",		0xd03b0000, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
-{"vmov.s",		"?d0d,?s0s",		0xd0000000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vabs.s",		"?d0d,?s0w",		0xd0010000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vneg.s",		"?d0d,?s0w",		0xd0020000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vsat0.s",		"?d0z,?s0s",		0xd0040000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vsat1.s",		"?d0z,?s0s",		0xd0050000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vmov.s",		"?d0d,?s0s",		0xd0000000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vabs.s",		"?d0d,?s0w",		0xd0010000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vneg.s",		"?d0d,?s0w",		0xd0020000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vsat0.s",		"?d0z,?s0s",		0xd0040000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vsat1.s",		"?d0z,?s0s",		0xd0050000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vzero.s",		"?d0d",				0xd0060000, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVectorInit	},
 {"vone.s",		"?d0d",				0xd0070000, 0xffffff80, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplVectorInit	},
-{"vrcp.s",		"?x0d,?s0s",		0xd0100000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vrsq.s",		"?x0d,?s0s",		0xd0110000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vrcp.s",		"?x0d,?s0s",		0xd0100000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
+{"vrsq.s",		"?x0d,?s0s",		0xd0110000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vsin.s",		"?x0d,?s0s",		0xd0120000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vcos.s",		"?x0d,?s0s",		0xd0130000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vexp2.s",		"?x0d,?s0s",		0xd0140000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vlog2.s",		"?x0d,?s0s",		0xd0150000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vsqrt.s",		"?x0d,?s0s",		0xd0160000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vsqrt.s",		"?x0d,?s0s",		0xd0160000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vasin.s",		"?x0d,?s0s",		0xd0170000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
-{"vnrcp.s",		"?x0d,?s0y",		0xd0180000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
+{"vnrcp.s",		"?x0d,?s0y",		0xd0180000, 0xffff8080, VFPU_PFX,		VfpuGenArith,		VfpuImplArith		},
 {"vnsin.s",		"?x0d,?s0y",		0xd01a0000, 0xffff8080, VFPU_PFX,		VfpuGenDummy,		VfpuImplArith		},
 {"vrexp2.s",	"?x0d,?s0y",		0xd01c0000, 0xffff8080, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
 {"vrnds.s",		"?s0y",				0xd0200000, 0xffff80ff, VFPU_NORMAL,	VfpuGenDummy,		VfpuImplDummy		},
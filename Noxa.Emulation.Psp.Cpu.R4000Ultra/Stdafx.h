@@ -18,4 +18,9 @@
 
 #include "Options.h"
 
+// Generated code, the bounce and the thunks all assume 32-bit pointers and the x86 calling convention
+#ifdef _M_X64
+#error R4000Ultra only generates 32-bit code - it must be built for x86
+#endif
+
 #include "NoxaShared.h"
@@ -24,3 +24,8 @@
 #undef TRACEREGISTERS
 #undef TRACEFPUREGS
 #endif
+#ifdef TRACE
+// Traces read registers out of the ctx after every instruction
+#undef REGISTERCACHING
+#undef CONSTANTPROPAGATION
+#endif
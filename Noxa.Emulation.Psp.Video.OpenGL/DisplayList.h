@@ -37,6 +37,36 @@ namespace Noxa {
 					int				StackIndex;
 				} DisplayList;
 
+				// A packet after pre-decoding - see OglDriver_Lists.cpp
+				typedef struct DecodedPacket_t
+				{
+					byte			Command;
+					int				Argument;		// VADDR/IADDR have BASE applied, NOP is the # merged
+					union
+					{
+						float		Float;			// Argument << 8 as a float
+						int			Matrix;			// PMS/VMS/WMS/TMS - offset in to DecodedRun::Matrices
+					};
+					VideoPacket*	Next;			// Where the list is after this packet - the target for JUMP/CALL
+				} DecodedPacket;
+
+				// Packets decoded from one contiguous span of a list - ends at a JUMP/CALL/RET/END, the stall
+				// address, or after LISTRUNLENGTH packets
+				typedef struct DecodedRun_t
+				{
+					VideoPacket*	Start;
+					VideoPacket*	End;			// First packet not in the run
+					int				Base;			// DisplayList::Base it was decoded with
+					uint			Hash;			// Of Start..End
+					uint			CheckedStamp;	// OglContext::TextureStamp when Hash was last checked
+					int				Misses;			// # of times in a row Hash didn't match
+					int				SkipStamps;		// If > 0, # of lists that use it before it is cached again
+
+					int				Count;
+					DecodedPacket*	Packets;
+					float*			Matrices;		// 4x4 - VMS/WMS/TMS are already widened
+				} DecodedRun;
+
 			}
 		}
 	}
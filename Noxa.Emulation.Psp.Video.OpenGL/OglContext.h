@@ -7,6 +7,7 @@
 #pragma once
 
 #include "OglTextures.h"
+#include "DisplayList.h"
 #pragma unmanaged
 #include "LRU.h"
 #pragma managed
@@ -56,10 +57,13 @@ namespace Noxa {
 					float			TextureScale[ 2 ];
 					
 					LRU<TextureEntry*>*	TextureCache;
+					uint			TextureStamp;	// Bumped for each list, stall resume and TFLUSH/TSYNC - cached textures and runs are rehashed once per stamp
+
+					LRU<DecodedRun*>*	ListCache;		// Keyed by list address + BASE
 
 					void*			ClutTable;		// Allocated to CLUTSIZE and pallettes are copied in
 					uint			ClutPointer;
-					uint			ClutChecksum;
+					uint			ClutHash;
 					int				ClutFormat;
 					int				ClutShift;
 					int				ClutMask;
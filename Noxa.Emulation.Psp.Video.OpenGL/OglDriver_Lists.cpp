@@ -0,0 +1,288 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#include "StdAfx.h"
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <assert.h>
+#include <string>
+
+#include "OglDriver.h"
+#include "VideoApi.h"
+#include "DisplayList.h"
+#include "OglContext.h"
+#include "OglTextures.h"
+
+using namespace Noxa::Emulation::Psp;
+using namespace Noxa::Emulation::Psp::Video;
+using namespace Noxa::Emulation::Psp::Video::Native;
+
+extern NativeMemorySystem* _memory;
+
+// Each matrix takes at least 13 packets, and the last one may run past the end
+#define RUNMATRIXCOUNT		( LISTRUNLENGTH / 13 + 1 )
+
+#pragma unmanaged
+
+// Runs are decoded here and then copied out at their real size
+DecodedPacket _runPackets[ LISTRUNLENGTH ];
+float _runMatrices[ RUNMATRIXCOUNT * 16 ];
+// Runs of lists that are rebuilt all the time are used right out of the arrays above
+DecodedRun _scratchRun;
+
+// TODO: a faster widen matrix 3x4->4x4
+__inline void WidenMatrix( float src[ 16 ], float dest[ 16 ] )
+{
+	dest[0] = src[0];
+	dest[1] = src[1];
+	dest[2] = src[2];
+	dest[3] = 0.0f;
+	dest[4] = src[3];
+	dest[5] = src[4];
+	dest[6] = src[5];
+	dest[7] = 0.0f;
+	dest[8] = src[6];
+	dest[9] = src[7];
+	dest[10] = src[8];
+	dest[11] = 0.0f;
+	dest[12] = src[9];
+	dest[13] = src[10];
+	dest[14] = src[11];
+	dest[15] = 1.0f;
+}
+
+__inline float PacketFloat( int argument )
+{
+	int argx = argument << 8;
+	return *reinterpret_cast<float*>( &argx );
+}
+
+// Commands that only overwrite state - if two are next to each other the first can be dropped
+__inline bool IsOverwrite( int command )
+{
+	switch( command )
+	{
+	case VTYPE:
+	case VADDR:
+	case IADDR:
+	case PSUB:
+	case PFACE:
+	case WMS:
+	case VMS:
+	case PMS:
+	case USCALE:
+	case VSCALE:
+	case UOFFSET:
+	case VOFFSET:
+	case TBP0: case TBP1: case TBP2: case TBP3:
+	case TBP4: case TBP5: case TBP6: case TBP7:
+	case TBW0: case TBW1: case TBW2: case TBW3:
+	case TBW4: case TBW5: case TBW6: case TBW7:
+	case CBP:
+	case TMODE:
+	case TPSM:
+	case CMODE:
+	case SFIX:
+	case DFIX:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// If keep is false the run points at the scratch arrays and is only good until the next decode
+void DecodeRun( DecodedRun* run, VideoPacket* start, int base, void* stallAddress, bool keep )
+{
+	run->Start = start;
+	run->Base = base;
+
+	VideoPacket* packet = start;
+	VideoPacket* limit = start + LISTRUNLENGTH;
+	int count = 0;
+	int matrixCount = 0;
+	bool ended = false;
+	while( ( ended == false ) &&
+		( ( void* )packet != stallAddress ) &&
+		( packet < limit ) )
+	{
+		VideoPacket* current = packet++;
+		int command = current->Command;
+		int argi = current->Argument;
+		VideoPacket* target = NULL;
+
+		DecodedPacket* decoded;
+		if( ( count > 0 ) &&
+			( _runPackets[ count - 1 ].Command == command ) &&
+			( ( command == NOP ) || ( IsOverwrite( command ) == true ) ) )
+			decoded = &_runPackets[ count - 1 ];
+		else
+		{
+			decoded = &_runPackets[ count++ ];
+			decoded->Command = command;
+			decoded->Argument = 0;
+			decoded->Matrix = -1;
+		}
+
+		switch( command )
+		{
+		case NOP:
+			// ProcessList counts these to spot dead lists, and gives up after 10 in a row
+			decoded->Argument++;
+			ended = ( decoded->Argument > 10 );
+			break;
+
+		case JUMP:
+		case CALL:
+			target = ( VideoPacket* )_memory->Translate( ( argi | base ) & 0xFFFFFFFC );
+			decoded->Argument = argi;
+			ended = true;
+			break;
+		case RET:
+		case END:
+			decoded->Argument = argi;
+			ended = true;
+			break;
+		case BASE:
+			base = argi << 8;
+			decoded->Argument = argi;
+			break;
+		case VADDR:
+		case IADDR:
+			decoded->Argument = base | argi;
+			break;
+
+		case PMS:
+			// Next 16 packets are 4x4 projection matrix
+			if( decoded->Matrix == -1 )
+				decoded->Matrix = ( matrixCount++ ) * 16;
+			for( int m = 0; m < 16; m++ )
+				_runMatrices[ decoded->Matrix + m ] = PacketFloat( ( packet++ )->Argument );
+			break;
+		case VMS:
+		case WMS:
+		case TMS:
+			// Next 12 packets are 3x4 view/world/texture matrix
+			{
+				float matrixTemp[ 16 ];
+				for( int m = 0; m < 12; m++ )
+					matrixTemp[ m ] = PacketFloat( ( packet++ )->Argument );
+				if( decoded->Matrix == -1 )
+					decoded->Matrix = ( matrixCount++ ) * 16;
+				WidenMatrix( matrixTemp, &_runMatrices[ decoded->Matrix ] );
+			}
+			break;
+
+		default:
+			decoded->Argument = argi;
+			decoded->Float = PacketFloat( argi );
+			break;
+		}
+
+		decoded->Next = ( target != NULL ) ? target : packet;
+	}
+
+	run->End = packet;
+	run->Count = count;
+	if( keep == false )
+	{
+		run->Packets = _runPackets;
+		run->Matrices = _runMatrices;
+		return;
+	}
+
+	run->Hash = HashMemory( ( const byte* )start, ( int )( packet - start ) * sizeof( VideoPacket ), 0 );
+	run->Packets = ( DecodedPacket* )malloc( count * sizeof( DecodedPacket ) );
+	memcpy( run->Packets, _runPackets, count * sizeof( DecodedPacket ) );
+	if( matrixCount > 0 )
+	{
+		run->Matrices = ( float* )malloc( matrixCount * 16 * sizeof( float ) );
+		memcpy( run->Matrices, _runMatrices, matrixCount * 16 * sizeof( float ) );
+	}
+	else
+		run->Matrices = NULL;
+}
+
+DecodedRun* GetDecodedRun( OglContext* context, DisplayList* list )
+{
+	VideoPacket* start = list->Packets;
+
+	uint state[ 2 ];
+	state[ 0 ] = ( uint )start;
+	state[ 1 ] = ( uint )list->Base;
+	uint key = HashMemory( ( const byte* )state, sizeof( state ), 0 );
+
+	// Entries are reused in place, as LRU::Remove would leave them behind to be freed twice
+	DecodedRun* run = context->ListCache->Find( key );
+	if( run == NULL )
+	{
+		run = ( DecodedRun* )malloc( sizeof( DecodedRun ) );
+		memset( run, 0, sizeof( DecodedRun ) );
+		context->ListCache->Add( key, run );
+	}
+	else if( ( run->Start != start ) ||
+		( run->Base != list->Base ) )
+	{
+		// Another run with the same key - it's ours now
+		SAFEFREE( run->Packets );
+		SAFEFREE( run->Matrices );
+		memset( run, 0, sizeof( DecodedRun ) );
+	}
+
+	// Lists are rebuilt in place, so the contents only need checking the first time it is used in each list
+	bool firstUse = ( run->CheckedStamp != context->TextureStamp );
+	run->CheckedStamp = context->TextureStamp;
+
+	if( run->SkipStamps > 0 )
+	{
+		// Rebuilt every time it is used - decoding straight in to the scratch run is cheaper than hashing and
+		// copying something that will never be used again
+		if( firstUse == true )
+			run->SkipStamps--;
+		DecodeRun( &_scratchRun, start, list->Base, list->StallAddress, false );
+		return &_scratchRun;
+	}
+
+	if( run->Packets != NULL )
+	{
+		// If the stall is inside it the rest hasn't been written yet
+		bool match = true;
+		if( ( list->StallAddress > ( void* )start ) &&
+			( list->StallAddress < ( void* )run->End ) )
+			match = false;
+		else if( firstUse == true )
+		{
+			match = run->Hash == HashMemory( ( const byte* )start, ( int )( run->End - start ) * sizeof( VideoPacket ), 0 );
+			run->Misses = ( match == true ) ? 0 : run->Misses + 1;
+		}
+
+		if( match == true )
+			return run;
+
+		SAFEFREE( run->Packets );
+		SAFEFREE( run->Matrices );
+
+		if( run->Misses >= LISTCACHEMISSES )
+		{
+			// Stop caching it for a while - it gets another chance after LISTCACHESKIPSTAMPS more lists use it
+			run->Misses = 0;
+			run->SkipStamps = LISTCACHESKIPSTAMPS;
+			DecodeRun( &_scratchRun, start, list->Base, list->StallAddress, false );
+			return &_scratchRun;
+		}
+	}
+
+	DecodeRun( run, start, list->Base, list->StallAddress, true );
+	return run;
+}
+
+void ListCacheFreeHandler( uint key, DecodedRun* run )
+{
+	SAFEFREE( run->Packets );
+	SAFEFREE( run->Matrices );
+	free( run );
+}
+
+#pragma managed
@@ -23,6 +23,7 @@
 #include "OglContext.h"
 #include "OglTextures.h"
 #include "OglExtensions.h"
+#include "OglTextureDecoder.h"
 
 using namespace System::Diagnostics;
 using namespace System::Threading;
@@ -37,7 +38,6 @@ extern HANDLE _hListSyncEvent;
 
 #define COLORSWIZZLE( bgra ) bgra
 
-__inline void WidenMatrix( float src[ 16 ], float dest[ 16 ] );
 int DetermineVertexSize( int vertexType );
 void DummyTri( bool ortho );
 
@@ -52,6 +52,9 @@ extern void DrawSpriteList( OglContext* context, int vertexType, int vertexCount
 extern void TextureTransfer( OglContext* context );
 extern void SetTexture( OglContext* context, int stage );
 
+// OglDriver_Lists
+extern DecodedRun* GetDecodedRun( OglContext* context, DisplayList* list );
+
 // OglDriver Patches
 extern void DrawBezier( OglContext* context, int vertexType, int vertexSize, byte* iptr, byte* ptr, int ucount, int vcount );
 
@@ -64,10 +67,76 @@ bool printCommands = false;
 
 #pragma unmanaged
 
+// Walks ahead of where the list is and queues decodes for the textures it will set up. Only stage 0 is
+// followed, and as the CLUT isn't simulated indexed textures are only queued if it won't change first
+void PrefetchListTextures( OglContext* context, DisplayList* list )
+{
+	if( IsTextureDecoderRunning() == false )
+		return;
+
+	OglTexture texture = context->Textures[ 0 ];
+	int storageMode = context->TextureStorageMode;
+	bool swizzled = context->TexturesSwizzled;
+	bool clutChanged = false;
+	int base = list->Base;
+
+	VideoPacket* packet = list->Packets;
+	for( int n = 0; n < TEXTUREPREFETCHPACKETS; n++ )
+	{
+		if( ( void* )packet == list->StallAddress )
+			return;
+
+		VideoPacket* current = packet++;
+		int argi = current->Argument;
+		switch( current->Command )
+		{
+		case JUMP:
+			packet = ( VideoPacket* )_memory->Translate( ( argi | base ) & 0xFFFFFFFC );
+			break;
+		case BASE:
+			base = argi << 8;
+			break;
+		case RET:
+		case END:
+		case TRXKICK:
+			// Don't know where we'd go back to, or the transfer may write to the textures
+			return;
+
+		case TMODE:
+			swizzled = ( argi & 0x1 ) == 1 ? true : false;
+			break;
+		case TPSM:
+			storageMode = argi;
+			break;
+		case TBP0:
+			texture.Address = ( texture.Address & 0xFF000000 ) | argi;
+			break;
+		case TBW0:
+			texture.Address = ( ( argi << 8 ) & 0xFF000000 ) | ( texture.Address & 0x00FFFFFF );
+			texture.LineWidth = argi & 0x0000FFFF;
+			break;
+		case TSIZE0:
+			texture.Width = 1 << ( argi & 0x000000FF );
+			texture.Height = 1 << ( ( argi >> 8 ) & 0x000000FF );
+			texture.PixelStorage = storageMode;
+			if( ( clutChanged == false ) ||
+				( ( texture.PixelStorage & 0x4 ) == 0 ) )
+				PrefetchTexture( context, &texture, swizzled );
+			break;
+
+		case CBP:
+		case CBPH:
+		case CLOAD:
+		case CMODE:
+			clutChanged = true;
+			break;
+		}
+	}
+}
+
 void ProcessList( OglContext* context, DisplayList* list )
 {
 	int temp;
-	float matrixTemp[ 16 ];
 	float color3[ 3 ] = { 0.0f, 0.0f, 0.0f };
 	float color4[ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
 
@@ -83,8 +152,11 @@ void ProcessList( OglContext* context, DisplayList* list )
 
 	int nopCount = 0;
 
+	// Packets come from the decoded run that starts at list->Packets
+	DecodedRun* run = NULL;
+	int index = 0;
+
 	int argi;
-	int argx;
 	float argf;
 
 	context->AmbientMaterial[ 0 ] = context->AmbientMaterial[ 1 ] = context->AmbientMaterial[ 2 ] = context->AmbientMaterial[ 3 ] = 1.0f;
@@ -92,25 +164,34 @@ void ProcessList( OglContext* context, DisplayList* list )
 	glDisable( GL_LIGHTING );
 	//glDisable( GL_CULL_FACE );
 
+	PrefetchListTextures( context, list );
+
 	// labels:
 	// - abortList
 
 	while( true )
 	{
-		// Stall check
-		if( ( void* )list->Packets == list->StallAddress )
+		if( ( run == NULL ) ||
+			( index == run->Count ) )
 		{
-			// Stalled
-			//DummyTri( true );
-			list->Stalled = true;
-			PulseEvent( _hListSyncEvent );
-			goto abortList;
+			// Stall check - runs never go past the stall, so it can only be hit between them
+			if( ( void* )list->Packets == list->StallAddress )
+			{
+				// Stalled
+				//DummyTri( true );
+				list->Stalled = true;
+				PulseEvent( _hListSyncEvent );
+				goto abortList;
+			}
+
+			run = GetDecodedRun( context, list );
+			index = 0;
 		}
 
-		VideoPacket* packet = list->Packets;
+		DecodedPacket* packet = &run->Packets[ index++ ];
 
 		// Move to next packet
-		list->Packets++;
+		list->Packets = packet->Next;
 
 #ifdef STATISTICS
 		_commandCounts[ packet->Command ]++;
@@ -119,7 +200,8 @@ void ProcessList( OglContext* context, DisplayList* list )
 		// NOP
 		if( packet->Command == 0 )
 		{
-			nopCount++;
+			// Runs of them are merged, with the count in the argument
+			nopCount += packet->Argument;
 			if( nopCount > 10 )
 			{
 				// Consider this list dead if we have a bunch of nops
@@ -133,8 +215,7 @@ void ProcessList( OglContext* context, DisplayList* list )
 
 		// Extract arguments
 		argi = packet->Argument;
-		argx = argi << 8;
-		argf = *reinterpret_cast<float*>( &argx );
+		argf = packet->Float;
 
 #ifdef _DEBUG
 		if( printCommands == true )
@@ -147,7 +228,7 @@ void ProcessList( OglContext* context, DisplayList* list )
 		{
 			// Control
 		case JUMP:
-			list->Packets = ( VideoPacket* )_memory->Translate( ( argi | list->Base ) & 0xFFFFFFFC );
+			// Already translated in to Next
 			continue;
 		case END:
 			// Stop list processing for now?
@@ -173,8 +254,7 @@ void ProcessList( OglContext* context, DisplayList* list )
 			// Sublists
 		case CALL:
 			//list->ReturnAddress = list->Packets;
-			list->Stack[ list->StackIndex++ ] = list->Packets;
-			list->Packets = ( VideoPacket* )_memory->Translate( ( argi | list->Base ) & 0xFFFFFFFC );
+			list->Stack[ list->StackIndex++ ] = run->End;
 			continue;
 		case RET:
 			//list->Packets = ( VideoPacket* )list->ReturnAddress;
@@ -588,10 +668,11 @@ void ProcessList( OglContext* context, DisplayList* list )
 			vertexType = argi & 0x00801FFF; // so we keep transformed bit
 			break;
 		case VADDR:
-			vertexBufferAddress = list->Base | argi;
+			// BASE already applied by the decoder
+			vertexBufferAddress = argi;
 			break;
 		case IADDR:
-			indexBufferAddress = list->Base | argi;
+			indexBufferAddress = argi;
 			break;
 		case PRIM:
 			vertexCount = argi & 0xFFFF;
@@ -701,6 +782,8 @@ void ProcessList( OglContext* context, DisplayList* list )
 			break;
 		case TSYNC:
 			//SetTexture( context, 0 );
+			context->TextureStamp++;
+			FlushTextureDecoder();
 			break;
 		case TMODE:
 			context->TexturesSwizzled = ( argi & 0x1 ) == 1 ? true : false;
@@ -822,8 +905,9 @@ void ProcessList( OglContext* context, DisplayList* list )
 			glTexEnvfv( GL_TEXTURE_ENV, GL_TEXTURE_ENV_COLOR, color4 );
 			break;
 		case TFLUSH:
-			// texturesvalid = false
-			//context->Textures[ 0 ].TextureID = 0;
+			// Texture memory may have changed - cached textures get rehashed before they are used again
+			context->TextureStamp++;
+			FlushTextureDecoder();
 			break;
 		case USCALE:
 			// (float) should be 1
@@ -878,6 +962,8 @@ void ProcessList( OglContext* context, DisplayList* list )
 			context->Textures[ temp ].Height = 1 << ( ( argi >> 8 ) & 0x000000FF );
 			context->Textures[ temp ].PixelStorage = context->TextureStorageMode;
 			//context->Textures[ temp ].TextureID = 0;
+			if( temp == 0 )
+				PrefetchTexture( context, &context->Textures[ 0 ], context->TexturesSwizzled );
 			break;
 
 		case CBP:
@@ -895,33 +981,10 @@ void ProcessList( OglContext* context, DisplayList* list )
 					int entryWidth = ( ( context->ClutFormat < 3 ) ? 2 : 4 );
 					memcpy( context->ClutTable, tablePointer, entries * entryWidth );
 
-					// Checksum so that we can tell if it changed
-					uint checksum = 0;
-					for( int n = 0; n < ( entries * entryWidth ); n++ )
-						checksum += *( tablePointer++ );
-					if( context->ClutChecksum != checksum )
-					{
-						// Checksums don't match! Invalidate all CLUT textures!
-						/*LLEntry<TextureEntry*>* e = context->TextureCache->GetEnumerator();
-						while( e != NULL )
-						{
-							LLEntry<TextureEntry*>* next = e->Next;
-							if( ( e->Value->PixelStorage & 0x4 ) == 0x4 )
-							{
-								// Check to see if it was from this clut
-								if( e->Value->ClutPointer == context->ClutPointer )
-								{
-									// Kill it!
-									GLuint freeIds[] = { e->Value->TextureID };
-									glDeleteTextures( 1, freeIds );
-									context->TextureCache->Remove( ( uint )e->Value->Address );
-								}
-							}
-							e = next;
-						}*/
-						//context->TextureCache->Clear();
-					}
-					context->ClutChecksum = checksum;
+					// Indexed textures are cached by the CLUT they were decoded with, so a new one just misses
+					context->ClutHash = HashMemory( ( byte* )context->ClutTable, entries * entryWidth, 0 );
+					if( ( context->Textures[ 0 ].PixelStorage & 0x4 ) == 0x4 )
+						PrefetchTexture( context, &context->Textures[ 0 ], context->TexturesSwizzled );
 				}
 			}
 			break;
@@ -938,53 +1001,24 @@ void ProcessList( OglContext* context, DisplayList* list )
 			break;
 
 		case PMS:
-			// Next 16 packets are 4x4 projection matrix
-			// packets points to the first of the 16 elements
-			for( int m = 0; m < 16; m++ )
-			{
-				argx = list->Packets->Argument << 8;
-				list->Packets++;
-				matrixTemp[ m ] = *reinterpret_cast<float*>( &argx );
-			}
+			// The 4x4 projection matrix that followed was read by the decoder
 			glMatrixMode( GL_PROJECTION );
-			glLoadMatrixf( matrixTemp );
+			glLoadMatrixf( &run->Matrices[ packet->Matrix ] );
 			break;
 		case VMS:
-			// Next 12 packets are 3x4 view matrix
-			// packets points to the first of the 12 elements
-			for( int m = 0; m < 12; m++ )
-			{
-				argx = list->Packets->Argument << 8;
-				list->Packets++;
-				matrixTemp[ m ] = *reinterpret_cast<float*>( &argx );
-			}
-			WidenMatrix( matrixTemp, context->ViewMatrix );
+			// The 3x4 view matrix that followed was read and widened by the decoder
+			memcpy( context->ViewMatrix, &run->Matrices[ packet->Matrix ], sizeof( float ) * 16 );
 			glMatrixMode( GL_MODELVIEW );
 			glLoadMatrixf( context->ViewMatrix );
 			break;
 		case WMS:
-			// Next 12 packets are 3x4 world matrix
-			// packets points to the first of the 12 elements
-			for( int m = 0; m < 12; m++ )
-			{
-				argx = list->Packets->Argument << 8;
-				list->Packets++;
-				matrixTemp[ m ] = *reinterpret_cast<float*>( &argx );
-			}
-			WidenMatrix( matrixTemp, context->WorldMatrix );
+			// The 3x4 world matrix that followed was read and widened by the decoder
+			memcpy( context->WorldMatrix, &run->Matrices[ packet->Matrix ], sizeof( float ) * 16 );
 			glMatrixMode( GL_MODELVIEW );
 			glLoadMatrixf( context->ViewMatrix );
 			glMultMatrixf( context->WorldMatrix );
 			break;
 		case TMS:
-			// Next 12 packets are 3x4 texture matrix
-			// packets points to the first of the 12 elements
-			for( int m = 0; m < 12; m++ )
-			{
-				argx = list->Packets->Argument << 8;
-				list->Packets++;
-				matrixTemp[ m ] = *reinterpret_cast<float*>( &argx );
-			}
 			// TODO: texture matrix
 			break;
 		//case PROJ: // handled by PMS
@@ -1023,6 +1057,10 @@ void ProcessList( OglContext* context, DisplayList* list )
 		case TRXKICK: // Transmission Kick
 			context->TextureTx.PixelSize = ( argi & 0x1 );
 			TextureTransfer( context );
+
+			// Anything decoded so far may have been from memory the transfer wrote to
+			FlushTextureDecoder();
+			PrefetchListTextures( context, list );
 			break;
 
 		default:
@@ -1037,27 +1075,6 @@ abortList:
 	glDisableClientState( GL_COLOR_ARRAY );
 }
 
-// TODO: a faster widen matrix 3x4->4x4
-__inline void WidenMatrix( float src[ 16 ], float dest[ 16 ] )
-{
-	dest[0] = src[0];
-	dest[1] = src[1];
-	dest[2] = src[2];
-	dest[3] = 0.0f;
-	dest[4] = src[3];
-	dest[5] = src[4];
-	dest[6] = src[5];
-	dest[7] = 0.0f;
-	dest[8] = src[6];
-	dest[9] = src[7];
-	dest[10] = src[8];
-	dest[11] = 0.0f;
-	dest[12] = src[9];
-	dest[13] = src[10];
-	dest[14] = src[11];
-	dest[15] = 1.0f;
-}
-
 // Kindly yoinked (with permission) from ector's DaSh
 
 int v_positionSizes[]	= { 0, 3, 6, 12 },				v_positionAlign[]	= { 0, 1, 2, 4 };
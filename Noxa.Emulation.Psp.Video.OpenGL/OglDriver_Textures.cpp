@@ -22,6 +22,7 @@
 #include "OglContext.h"
 #include "OglTextures.h"
 #include "OglExtensions.h"
+#include "OglTextureDecoder.h"
 
 using namespace System::Diagnostics;
 using namespace System::Threading;
@@ -176,29 +177,41 @@ void SetTexture( OglContext* context, int stage )
 		return;
 	}
 
+	// Ensure valid
+	bool textureValid = IsTextureValid( texture );
+	if( textureValid == false )
+		return;
+
 	byte* texturePointer = ( byte* )context->Memory->Translate( texture->Address );
-	uint checksum = CalculateTextureChecksum( texturePointer, texture->Width, texture->Height, texture->PixelStorage );
 
 	// Check texture cache
-	TextureEntry* entry = context->TextureCache->Find( texture->Address );
+	uint key = GetTextureKey( context, texture, context->TexturesSwizzled );
+	TextureEntry* entry = context->TextureCache->Find( key );
 	if( entry != NULL )
 	{
-		assert( entry->Address == texture->Address );
-		uint cookie = *( ( uint* )texturePointer );
-
+		// Keys are hashes, so make sure it really is the same texture
 		bool match =
-			( entry->Cookie == cookie ) &&
-			( entry->Checksum == checksum ) &&
+			( entry->Address == texture->Address ) &&
 			( entry->Width == texture->Width ) &&
 			( entry->Height == texture->Height ) &&
 			( entry->LineWidth == texture->LineWidth ) &&
-			( entry->PixelStorage == texture->PixelStorage );
+			( entry->PixelStorage == texture->PixelStorage ) &&
+			( entry->Swizzled == context->TexturesSwizzled );
 		if( ( match == true ) && ( ( entry->PixelStorage & 0x4 ) == 0x4 ) )
-			match = entry->ClutChecksum == context->ClutChecksum;
+			match = entry->ClutKey == GetClutKey( context );
+
+		// The contents only need checking the first time it is used in each list
+		if( ( match == true ) &&
+			( entry->CheckedStamp != context->TextureStamp ) )
+		{
+			match = entry->Hash == CalculateTextureHash( texturePointer, texture->LineWidth, texture->Height, texture->PixelStorage );
+			entry->CheckedStamp = context->TextureStamp;
+		}
+
 		if( match == false )
 		{
 			// Mismatch - free
-			context->TextureCache->Remove( texture->Address );
+			context->TextureCache->Remove( key );
 			entry = NULL;
 		}
 	}
@@ -214,13 +227,14 @@ void SetTexture( OglContext* context, int stage )
 		return;
 	}
 
-	// Ensure valid
-	bool textureValid = IsTextureValid( texture );
-	if( textureValid == false )
-		return;
-	
-	// Grab and decode texture, then create in OGL
-	if( GenerateTexture( context, texture, checksum ) == false )
+	// A decode thread may have it already - otherwise grab and decode texture, then create in OGL
+	TextureJob* job = ClaimTexture( context, texture, key );
+	if( job != NULL )
+	{
+		UploadTexture( context, job );
+		FreeTextureJob( job );
+	}
+	else if( GenerateTexture( context, texture, key ) == false )
 	{
 		// Failed? Not much we can do...
 	}
@@ -21,6 +21,7 @@
 #include "DisplayList.h"
 #include "OglContext.h"
 #include "OglExtensions.h"
+#include "OglTextureDecoder.h"
 
 using namespace System::Diagnostics;
 using namespace System::Drawing;
@@ -52,17 +53,19 @@ DisplayList* GetNextDisplayList();
 // Processing
 void ProcessList( OglContext* context, DisplayList* list );
 
+// Lists
+void ListCacheFreeHandler( uint key, DecodedRun* run );
+
 void WorkerThreadThunk( Object^ object );
 void SetSpeedLock( bool locked );
 
 #pragma unmanaged
 void TextureCacheFreeHandler( uint key, TextureEntry* value )
 {
-	uint* texturePointer = ( uint* )_memory->Translate( value->Address );
-	if( *texturePointer == value->Cookie )
-		*texturePointer = value->CookieOriginal;
+	// Removed entries stay at the tail of the list until they are evicted, and that frees them again
 	GLuint freeIds[] = { value->TextureID };
 	glDeleteTextures( 1, freeIds );
+	value->TextureID = 0;
 	//delete value;
 }
 #pragma managed
@@ -80,6 +83,8 @@ void OglDriver::StartThread()
 	_context->TextureWrapT = GL_REPEAT;
 	_context->TextureCache = new LRU<TextureEntry*>( TEXTURECACHESIZE );
 	_context->TextureCache->SetFreeHandler( TextureCacheFreeHandler );
+	_context->ListCache = new LRU<DecodedRun*>( LISTCACHESIZE );
+	_context->ListCache->SetFreeHandler( ListCacheFreeHandler );
 	_context->TextureOffset[ 0 ] = 0.0f;
 	_context->TextureOffset[ 1 ] = 0.0f;
 	_context->TextureScale[ 0 ] = 1.0f;
@@ -110,6 +115,7 @@ void OglDriver::StopThread()
 			Thread::Sleep( 10 );
 		_thread = nullptr;
 
+		SAFEDELETE( _context->ListCache );
 		SAFEFREE( _context );
 	}
 }
@@ -196,6 +202,10 @@ void NativeWorker( HDC hDC, OglContext* context )
 							}
 						}
 
+						// The CPU may have written to textures or lists since the last list or stall
+						context->TextureStamp++;
+						FlushTextureDecoder();
+
 						// Process
 						ProcessList( context, list );
 
@@ -347,6 +357,9 @@ void OglDriver::SetupOpenGL()
 
 	SetupExtensions();
 
+	SelectTextureKernels();
+	StartTextureDecoder();
+
 //#ifndef VSYNC
 	wglSwapIntervalEXT( 0 );
 //#endif
@@ -356,6 +369,8 @@ void OglDriver::SetupOpenGL()
 
 void OglDriver::DestroyOpenGL()
 {
+	StopTextureDecoder();
+
 	wglMakeCurrent( NULL, NULL );
 	if( _hRC != NULL )
 	    wglDeleteContext( ( HGLRC )_hRC );
@@ -8,6 +8,7 @@
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <assert.h>
+#include <stdlib.h>
 #include <string>
 #include <cmath>
 #pragma unmanaged
@@ -26,9 +27,19 @@ using namespace Noxa::Emulation::Psp::Video;
 PFNGLBLENDEQUATIONPROC Noxa::Emulation::Psp::Video::glBlendEquation = NULL;
 PFNGLBLENDCOLORPROC Noxa::Emulation::Psp::Video::glBlendColor = NULL;
 PFNWGLSWAPINTERVALEXTPROC Noxa::Emulation::Psp::Video::wglSwapIntervalEXT = NULL;
+bool Noxa::Emulation::Psp::Video::HasPackedPixels = false;
 
 bool Noxa::Emulation::Psp::Video::SetupExtensions()
 {
+	// Version string starts with major.minor
+	const char* version = ( const char* )glGetString( GL_VERSION );
+	if( version != NULL )
+	{
+		int major = atoi( version );
+		const char* minor = strchr( version, '.' );
+		HasPackedPixels = ( major > 1 ) || ( ( major == 1 ) && ( minor != NULL ) && ( atoi( minor + 1 ) >= 2 ) );
+	}
+
 	glBlendEquation = (PFNGLBLENDEQUATIONPROC)wglGetProcAddress( "glBlendEquationEXT" );
 	assert( glBlendEquation != NULL );
 	if( glBlendEquation == NULL )
@@ -26,6 +26,9 @@ namespace Noxa {
 				extern PFNGLBLENDCOLORPROC			glBlendColor;
 				extern PFNWGLSWAPINTERVALEXTPROC	wglSwapIntervalEXT;
 
+				// GL 1.2 packed pixel types (GL_UNSIGNED_SHORT_5_6_5_REV/etc) can be used for textures
+				extern bool							HasPackedPixels;
+
 			}
 		}
 	}
@@ -0,0 +1,252 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#include "StdAfx.h"
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <assert.h>
+
+#include "OglDriver.h"
+#include "OglContext.h"
+#include "OglTextures.h"
+#include "OglTextureDecoder.h"
+
+using namespace Noxa::Emulation::Psp;
+using namespace Noxa::Emulation::Psp::Video;
+
+#pragma unmanaged
+
+#ifdef TEXTUREDECODETHREADS
+
+CRITICAL_SECTION _decodeLock;
+HANDLE _decodeSemaphore;			// One count per job queued
+HANDLE _decodeDoneEvent;			// Set whenever a thread finishes a job
+HANDLE _decodeThreads[ TEXTUREDECODETHREADS ];
+int _decodeThreadCount = 0;
+volatile bool _decodeShutdown;
+
+// Queued, decoding and ready jobs - the worker is the only one that adds or removes them
+TextureJob* _decodeJobs[ TEXTUREDECODEQUEUESIZE ];
+uint _decodeSequence;
+
+DWORD WINAPI DecodeThread( LPVOID parameter )
+{
+	while( true )
+	{
+		WaitForSingleObject( _decodeSemaphore, INFINITE );
+		if( _decodeShutdown == true )
+			return 0;
+
+		// Oldest first, as that is the order the list will want them in
+		EnterCriticalSection( &_decodeLock );
+		TextureJob* job = NULL;
+		for( int n = 0; n < TEXTUREDECODEQUEUESIZE; n++ )
+		{
+			TextureJob* candidate = _decodeJobs[ n ];
+			if( ( candidate != NULL ) &&
+				( candidate->State == JobQueued ) &&
+				( ( job == NULL ) || ( candidate->Sequence < job->Sequence ) ) )
+				job = candidate;
+		}
+		if( job != NULL )
+			job->State = JobDecoding;
+		LeaveCriticalSection( &_decodeLock );
+
+		// The worker may have claimed it before we got here
+		if( job == NULL )
+			continue;
+
+		DecodeTexture( job );
+
+		EnterCriticalSection( &_decodeLock );
+		if( job->State == JobAbandoned )
+			FreeTextureJob( job );
+		else
+			job->State = JobReady;
+		LeaveCriticalSection( &_decodeLock );
+		SetEvent( _decodeDoneEvent );
+	}
+}
+
+#endif
+
+void Noxa::Emulation::Psp::Video::StartTextureDecoder()
+{
+#ifdef TEXTUREDECODETHREADS
+	// Leave a core for the CPU - there's no point if it would have to share with the worker
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	int threadCount = min( TEXTUREDECODETHREADS, ( int )info.dwNumberOfProcessors - 1 );
+	if( threadCount <= 0 )
+		return;
+
+	InitializeCriticalSection( &_decodeLock );
+	_decodeSemaphore = CreateSemaphore( NULL, 0, 0x7FFFFFFF, NULL );
+	_decodeDoneEvent = CreateEvent( NULL, FALSE, FALSE, NULL );
+	memset( _decodeJobs, 0, sizeof( _decodeJobs ) );
+	_decodeSequence = 0;
+	_decodeShutdown = false;
+
+	for( int n = 0; n < threadCount; n++ )
+		_decodeThreads[ n ] = CreateThread( NULL, 0, DecodeThread, NULL, 0, NULL );
+	_decodeThreadCount = threadCount;
+#endif
+}
+
+void Noxa::Emulation::Psp::Video::StopTextureDecoder()
+{
+#ifdef TEXTUREDECODETHREADS
+	if( _decodeThreadCount == 0 )
+		return;
+
+	// Whatever they are decoding is finished (and freed, once flushed) before they look at _decodeShutdown
+	FlushTextureDecoder();
+	_decodeShutdown = true;
+	ReleaseSemaphore( _decodeSemaphore, _decodeThreadCount, NULL );
+	WaitForMultipleObjects( _decodeThreadCount, _decodeThreads, TRUE, INFINITE );
+	for( int n = 0; n < _decodeThreadCount; n++ )
+		CloseHandle( _decodeThreads[ n ] );
+	_decodeThreadCount = 0;
+
+	CloseHandle( _decodeSemaphore );
+	CloseHandle( _decodeDoneEvent );
+	DeleteCriticalSection( &_decodeLock );
+#endif
+}
+
+bool Noxa::Emulation::Psp::Video::IsTextureDecoderRunning()
+{
+#ifdef TEXTUREDECODETHREADS
+	return ( _decodeThreadCount > 0 );
+#else
+	return false;
+#endif
+}
+
+void Noxa::Emulation::Psp::Video::PrefetchTexture( OglContext* context, const OglTexture* texture, bool swizzled )
+{
+#ifdef TEXTUREDECODETHREADS
+	if( ( _decodeThreadCount == 0 ) ||
+		( IsTextureValid( texture ) == false ) ||
+		( texture->PixelStorage >= TPSDXT1 ) )
+		return;
+
+	// Peek, so a texture that is only being looked ahead at doesn't get moved up the eviction order
+	uint key = GetTextureKey( context, texture, swizzled );
+	if( context->TextureCache->Peek( key ) != NULL )
+		return;
+
+	EnterCriticalSection( &_decodeLock );
+	int slot = -1;
+	for( int n = 0; n < TEXTUREDECODEQUEUESIZE; n++ )
+	{
+		if( _decodeJobs[ n ] == NULL )
+		{
+			if( slot == -1 )
+				slot = n;
+		}
+		else if( _decodeJobs[ n ]->Key == key )
+		{
+			slot = -1;
+			break;
+		}
+	}
+	if( slot != -1 )
+	{
+		TextureJob* job = CreateTextureJob( context, texture, swizzled, key );
+		job->State = JobQueued;
+		job->Sequence = _decodeSequence++;
+		_decodeJobs[ slot ] = job;
+	}
+	LeaveCriticalSection( &_decodeLock );
+
+	if( slot != -1 )
+		ReleaseSemaphore( _decodeSemaphore, 1, NULL );
+#endif
+}
+
+TextureJob* Noxa::Emulation::Psp::Video::ClaimTexture( OglContext* context, const OglTexture* texture, uint key )
+{
+#ifdef TEXTUREDECODETHREADS
+	if( _decodeThreadCount == 0 )
+		return NULL;
+
+	EnterCriticalSection( &_decodeLock );
+	TextureJob* job = NULL;
+	for( int n = 0; n < TEXTUREDECODEQUEUESIZE; n++ )
+	{
+		if( ( _decodeJobs[ n ] != NULL ) &&
+			( _decodeJobs[ n ]->Key == key ) )
+		{
+			job = _decodeJobs[ n ];
+			_decodeJobs[ n ] = NULL;
+			break;
+		}
+	}
+	bool decodeHere = false;
+	if( ( job != NULL ) &&
+		( job->State == JobQueued ) )
+	{
+		// No point waiting for a thread to pick it up
+		job->State = JobDecoding;
+		decodeHere = true;
+	}
+	LeaveCriticalSection( &_decodeLock );
+
+	if( job == NULL )
+		return NULL;
+
+	if( decodeHere == true )
+		DecodeTexture( job );
+	else
+	{
+		while( job->State != JobReady )
+			WaitForSingleObject( _decodeDoneEvent, INFINITE );
+	}
+
+	// Keys are hashes, so make sure it really is the same texture
+	bool match =
+		( job->Texture.Address == texture->Address ) &&
+		( job->Texture.Width == texture->Width ) &&
+		( job->Texture.Height == texture->Height ) &&
+		( job->Texture.LineWidth == texture->LineWidth ) &&
+		( job->Texture.PixelStorage == texture->PixelStorage ) &&
+		( job->Swizzled == context->TexturesSwizzled );
+
+	if( match == false )
+	{
+		FreeTextureJob( job );
+		return NULL;
+	}
+	return job;
+#else
+	return NULL;
+#endif
+}
+
+void Noxa::Emulation::Psp::Video::FlushTextureDecoder()
+{
+#ifdef TEXTUREDECODETHREADS
+	if( _decodeThreadCount == 0 )
+		return;
+
+	EnterCriticalSection( &_decodeLock );
+	for( int n = 0; n < TEXTUREDECODEQUEUESIZE; n++ )
+	{
+		TextureJob* job = _decodeJobs[ n ];
+		if( job == NULL )
+			continue;
+		if( job->State == JobDecoding )
+			job->State = JobAbandoned;
+		else
+			FreeTextureJob( job );
+		_decodeJobs[ n ] = NULL;
+	}
+	LeaveCriticalSection( &_decodeLock );
+#endif
+}
+
+#pragma managed
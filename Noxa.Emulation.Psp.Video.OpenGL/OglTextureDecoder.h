@@ -0,0 +1,42 @@
+// ----------------------------------------------------------------------------
+// PSP Player Emulation Suite
+// Copyright (C) 2006 Ben Vanik (noxa)
+// Licensed under the LGPL - see License.txt in the project root for details
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "OglTextures.h"
+
+namespace Noxa {
+	namespace Emulation {
+		namespace Psp {
+			namespace Video {
+
+				/* Decodes textures on a pool of threads ahead of the worker.
+				   Texture commands (and a look ahead through the list) queue jobs for textures that aren't
+				   cached, and when SetTexture misses the cache it claims the job instead of decoding - all
+				   that is left for the worker is the upload. Jobs are flushed at the start of every list and
+				   on transfers, as either can change the memory they were decoded from.
+				   With one core (or TEXTUREDECODETHREADS undefined) there are no threads and nothing is queued.
+				*/
+
+				struct OglContext_t;
+
+				void StartTextureDecoder();
+				void StopTextureDecoder();
+				// False if there are no threads, in which case nothing is worth queueing
+				bool IsTextureDecoderRunning();
+
+				// Queues a decode of texture if it isn't cached, queued, or the queue is full
+				void PrefetchTexture( OglContext_t* context, const OglTexture* texture, bool swizzled );
+				// Takes the job for key - if a thread is still decoding it this waits, and if none has
+				// started it is decoded here. NULL if nothing usable was queued
+				TextureJob* ClaimTexture( OglContext_t* context, const OglTexture* texture, uint key );
+				// Drops all queued and finished jobs
+				void FlushTextureDecoder();
+
+			}
+		}
+	}
+}
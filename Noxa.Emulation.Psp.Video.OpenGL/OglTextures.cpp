@@ -17,6 +17,8 @@
 #include <cmath>
 #include <string>
 #include <stdlib.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
 #pragma unmanaged
 #include <gl/gl.h>
 #include <gl/glu.h>
@@ -27,6 +29,7 @@
 #include "OglDriver.h"
 #include "OglContext.h"
 #include "OglTextures.h"
+#include "OglExtensions.h"
 
 using namespace Noxa::Emulation::Psp;
 using namespace Noxa::Emulation::Psp::Video;
@@ -34,7 +37,7 @@ using namespace Noxa::Emulation::Psp::Video;
 
 #pragma unmanaged
 
-bool Noxa::Emulation::Psp::Video::IsTextureValid( OglTexture* texture )
+bool Noxa::Emulation::Psp::Video::IsTextureValid( const OglTexture* texture )
 {
 	if( ( texture->Address == 0x0 ) ||
 		( texture->LineWidth == 0 ) ||
@@ -99,20 +102,30 @@ static void CopyPixelIndexed4( const TextureFormat* format, void* dest, const vo
 }
 
 const TextureFormat __formats[] = {
-	// Format			Size	Copier				Flags			GL format
-	{ TPSBGR5650,		2,		CopyPixel,			0,				GL_UNSIGNED_SHORT_5_6_5_REV,		},
-	{ TPSABGR5551,		2,		CopyPixel,			TFAlpha,		GL_UNSIGNED_SHORT_1_5_5_5_REV,		},
-	{ TPSABGR4444,		2,		CopyPixel,			TFAlpha,		GL_UNSIGNED_SHORT_4_4_4_4_REV,		},
-	{ TPSABGR8888,		4,		CopyPixel,			TFAlpha,		GL_UNSIGNED_BYTE,					},
-	{ TPSIndexed4,		0,		CopyPixelIndexed4,	TFAlpha,		GL_UNSIGNED_BYTE,					},
-	{ TPSIndexed8,		1,		CopyPixel,			TFAlpha,		GL_UNSIGNED_BYTE,					},
-	{ TPSIndexed16,		2,		CopyPixel,			TFAlpha,		GL_UNSIGNED_BYTE,					},
-	{ TPSIndexed32,		4,		CopyPixel,			TFAlpha,		GL_UNSIGNED_BYTE,					},
-	{ TPSDXT1,			4,		CopyPixel,			TFAlpha,		GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,	},
-	{ TPSDXT3,			4,		CopyPixel,			TFAlpha,		GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,	},
-	{ TPSDXT5,			4,		CopyPixel,			TFAlpha,		GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,	},
+	// Format			Size	Copier				Flags			GL format							GL internal format
+	{ TPSBGR5650,		2,		CopyPixel,			0,				GL_UNSIGNED_SHORT_5_6_5_REV,		GL_RGB5,		},
+	{ TPSABGR5551,		2,		CopyPixel,			TFAlpha,		GL_UNSIGNED_SHORT_1_5_5_5_REV,		GL_RGB5_A1,		},
+	{ TPSABGR4444,		2,		CopyPixel,			TFAlpha,		GL_UNSIGNED_SHORT_4_4_4_4_REV,		GL_RGBA4,		},
+	{ TPSABGR8888,		4,		CopyPixel,			TFAlpha,		GL_UNSIGNED_BYTE,					GL_RGBA8,		},
+	{ TPSIndexed4,		0,		CopyPixelIndexed4,	TFAlpha,		GL_UNSIGNED_BYTE,					GL_RGBA8,		},
+	{ TPSIndexed8,		1,		CopyPixel,			TFAlpha,		GL_UNSIGNED_BYTE,					GL_RGBA8,		},
+	{ TPSIndexed16,		2,		CopyPixel,			TFAlpha,		GL_UNSIGNED_BYTE,					GL_RGBA8,		},
+	{ TPSIndexed32,		4,		CopyPixel,			TFAlpha,		GL_UNSIGNED_BYTE,					GL_RGBA8,		},
+	{ TPSDXT1,			4,		CopyPixel,			TFAlpha,		GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,	GL_RGBA8,		},
+	{ TPSDXT3,			4,		CopyPixel,			TFAlpha,		GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,	GL_RGBA8,		},
+	{ TPSDXT5,			4,		CopyPixel,			TFAlpha,		GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,	GL_RGBA8,		},
 };
 
+// Swizzled or not, the texture is lineWidth * height pixels of memory
+static int TextureMemorySize( int lineWidth, int height, int pixelStorage )
+{
+	const TextureFormat* format = &__formats[ pixelStorage ];
+	if( format->Size == 0 )
+		return ( lineWidth / 2 ) * height;
+	else
+		return lineWidth * format->Size * height;
+}
+
 byte* Unswizzle( const TextureFormat* format, const byte* in, byte* out, const uint width, const uint height )
 {
 	int rowWidth;
@@ -147,6 +160,39 @@ byte* Unswizzle( const TextureFormat* format, const byte* in, byte* out, const u
 	return out;
 }
 
+#ifdef SIMDTEXTURES
+byte* UnswizzleSse2( const TextureFormat* format, const byte* in, byte* out, const uint width, const uint height )
+{
+	// Same walk as Unswizzle, but each 16 byte row of a block is a single load/store
+	int rowWidth;
+	if( format->Size == 0 )
+		rowWidth = ( width / 2 );
+	else
+		rowWidth = width * format->Size;
+	int bxc = rowWidth / 16;
+	int byc = height / 8;
+
+	const __m128i* src = ( const __m128i* )in;
+	byte* ydest = out;
+	for( int by = 0; by < byc; by++ )
+	{
+		byte* xdest = ydest;
+		for( int bx = 0; bx < bxc; bx++ )
+		{
+			byte* dest = xdest;
+			for( int n = 0; n < 8; n++ )
+			{
+				_mm_storeu_si128( ( __m128i* )dest, _mm_loadu_si128( src++ ) );
+				dest += rowWidth;
+			}
+			xdest += 16;
+		}
+		ydest += rowWidth * 8;
+	}
+	return out;
+}
+#endif
+
 uint Noxa::Emulation::Psp::Video::Convert5650( ushort source )
 {
 	/*
@@ -189,10 +235,10 @@ uint Noxa::Emulation::Psp::Video::Convert4444( ushort source )
 	/*
 		AAAABBBBGGGGRRRR	<- PSP
 	 */
-	byte r = ( ( source & 0xF000 ) >> 12 );
-	byte g = ( ( source & 0x0F00 ) >> 8 );
-	byte b = ( ( source & 0x00F0 ) >> 4 );
-	byte a = ( source & 0x000F );
+	byte a = ( ( source & 0xF000 ) >> 12 );
+	byte b = ( ( source & 0x0F00 ) >> 8 );
+	byte g = ( ( source & 0x00F0 ) >> 4 );
+	byte r = ( source & 0x000F );
 	
 	if( r > 0 )
 		r = ( ( r + 1 ) * 255 ) / 16;
@@ -203,9 +249,93 @@ uint Noxa::Emulation::Psp::Video::Convert4444( ushort source )
 	if( a > 0 )
 		a = ( ( a + 1 ) * 255 ) / 16;
 		
-	return ( a << 24 ) | ( r << 16 ) | ( g << 8 ) | b;
+	return ( a << 24 ) | ( b << 16 ) | ( g << 8 ) | r;
+}
+
+#ifdef SIMDTEXTURES
+// Scales bits-wide channels in 16-bit lanes to 8 bits exactly like the Convert* functions - 0 stays 0
+static __inline __m128i ExpandChannel( __m128i c, int bits )
+{
+	__m128i scaled = _mm_mullo_epi16( _mm_add_epi16( c, _mm_set1_epi16( 1 ) ), _mm_set1_epi16( 255 ) );
+	scaled = _mm_srl_epi16( scaled, _mm_cvtsi32_si128( bits ) );
+	return _mm_andnot_si128( _mm_cmpeq_epi16( c, _mm_setzero_si128() ), scaled );
+}
+
+// Packs 8 pixels of 16-bit lane channels (all <= 0xFF) as ( b3 << 24 ) | ( b2 << 16 ) | ( b1 << 8 ) | b0
+static __inline void StorePixels( uint* output, __m128i b0, __m128i b1, __m128i b2, __m128i b3 )
+{
+	__m128i low = _mm_or_si128( b0, _mm_slli_epi16( b1, 8 ) );
+	__m128i high = _mm_or_si128( b2, _mm_slli_epi16( b3, 8 ) );
+	_mm_storeu_si128( ( __m128i* )output, _mm_unpacklo_epi16( low, high ) );
+	_mm_storeu_si128( ( __m128i* )( output + 4 ), _mm_unpackhi_epi16( low, high ) );
+}
+
+byte* Widen5650Sse2( const byte* in, byte* out, const uint width, const uint height )
+{
+	const ushort* input = ( const ushort* )in;
+	uint* output = ( uint* )out;
+	uint count = width * height;
+	const __m128i mask5 = _mm_set1_epi16( 0x1F );
+	const __m128i mask6 = _mm_set1_epi16( 0x3F );
+	const __m128i alpha = _mm_set1_epi16( 0xFF );
+	uint n = 0;
+	for( ; n + 8 <= count; n += 8 )
+	{
+		__m128i p = _mm_loadu_si128( ( const __m128i* )( input + n ) );
+		__m128i r = ExpandChannel( _mm_srli_epi16( p, 11 ), 5 );
+		__m128i g = ExpandChannel( _mm_and_si128( _mm_srli_epi16( p, 5 ), mask6 ), 6 );
+		__m128i b = ExpandChannel( _mm_and_si128( p, mask5 ), 5 );
+		StorePixels( output + n, b, g, r, alpha );
+	}
+	for( ; n < count; n++ )
+		output[ n ] = Convert5650( input[ n ] );
+	return out;
 }
 
+byte* Widen5551Sse2( const byte* in, byte* out, const uint width, const uint height )
+{
+	const ushort* input = ( const ushort* )in;
+	uint* output = ( uint* )out;
+	uint count = width * height;
+	const __m128i mask5 = _mm_set1_epi16( 0x1F );
+	const __m128i mask8 = _mm_set1_epi16( 0xFF );
+	uint n = 0;
+	for( ; n + 8 <= count; n += 8 )
+	{
+		__m128i p = _mm_loadu_si128( ( const __m128i* )( input + n ) );
+		__m128i a = _mm_and_si128( _mm_srai_epi16( p, 15 ), mask8 );
+		__m128i r = ExpandChannel( _mm_and_si128( _mm_srli_epi16( p, 10 ), mask5 ), 5 );
+		__m128i g = ExpandChannel( _mm_and_si128( _mm_srli_epi16( p, 5 ), mask5 ), 5 );
+		__m128i b = ExpandChannel( _mm_and_si128( p, mask5 ), 5 );
+		StorePixels( output + n, b, g, r, a );
+	}
+	for( ; n < count; n++ )
+		output[ n ] = Convert5551( input[ n ] );
+	return out;
+}
+
+byte* Widen4444Sse2( const byte* in, byte* out, const uint width, const uint height )
+{
+	const ushort* input = ( const ushort* )in;
+	uint* output = ( uint* )out;
+	uint count = width * height;
+	const __m128i mask4 = _mm_set1_epi16( 0x0F );
+	uint n = 0;
+	for( ; n + 8 <= count; n += 8 )
+	{
+		__m128i p = _mm_loadu_si128( ( const __m128i* )( input + n ) );
+		__m128i a = ExpandChannel( _mm_srli_epi16( p, 12 ), 4 );
+		__m128i b = ExpandChannel( _mm_and_si128( _mm_srli_epi16( p, 8 ), mask4 ), 4 );
+		__m128i g = ExpandChannel( _mm_and_si128( _mm_srli_epi16( p, 4 ), mask4 ), 4 );
+		__m128i r = ExpandChannel( _mm_and_si128( p, mask4 ), 4 );
+		StorePixels( output + n, r, g, b, a );
+	}
+	for( ; n < count; n++ )
+		output[ n ] = Convert4444( input[ n ] );
+	return out;
+}
+#endif
+
 byte* Widen5650( const byte* in, byte* out, const uint width, const uint height )
 {
 	// Copy 0565 to 8888
@@ -248,10 +378,8 @@ byte* Widen4444( const byte* in, byte* out, const uint width, const uint height
 	return out;
 }
 
-__inline uint ClutLookup( const OglContext* context, uint index )
+__inline uint ClutEntry( const OglContext* context, int finalIndex )
 {
-	int finalIndex = ( ( context->ClutStart + index ) >> context->ClutShift ) & context->ClutMask;
-
 	if( context->ClutFormat == 0x3 )
 	{
 		// 32-bit ABGR 8888
@@ -284,6 +412,29 @@ __inline uint ClutLookup( const OglContext* context, uint index )
 	return 0;
 }
 
+// The mask keeps every lookup in the first 256 entries, so only those are converted
+static void ConvertClut( const OglContext* context, TextureClut* clut )
+{
+	clut->Shift = context->ClutShift;
+	clut->Mask = context->ClutMask;
+	clut->Start = context->ClutStart;
+	for( int n = 0; n <= context->ClutMask; n++ )
+		clut->Colors[ n ] = ClutEntry( context, n );
+}
+
+__inline uint ClutLookup( const TextureClut* clut, uint index )
+{
+	return clut->Colors[ ( ( clut->Start + index ) >> clut->Shift ) & clut->Mask ];
+}
+
+// 4 and 8 bit textures can only index the first 16/256 entries, so those are looked up front and
+// decoding becomes a plain table lookup
+static void BuildPalette( const TextureClut* clut, uint* palette, const uint count )
+{
+	for( uint n = 0; n < count; n++ )
+		palette[ n ] = ClutLookup( clut, n );
+}
+
 
 #pragma pack(1)
 struct TGAHEADER
@@ -303,7 +454,7 @@ struct TGAHEADER
 };
 #pragma pack()
 
-byte* Decode4( const OglContext* context, const byte* in, byte* out, const uint width, const uint height, const uint lineWidth )
+byte* Decode4( const uint* palette, const byte* in, byte* out, const uint width, const uint height, const uint lineWidth )
 {
 	// Tricky, as each byte contains 2 indices (4 bits each)
 	byte* input = ( byte* )in;
@@ -323,7 +474,7 @@ byte* Decode4( const OglContext* context, const byte* in, byte* out, const uint
 			}
 			else
 				index &= 0x0F;
-			output[ x ] = ClutLookup( context, index );
+			output[ x ] = palette[ index ];
 		}
 		input -= width / 2;
 		input += lineWidth / 2;
@@ -333,7 +484,64 @@ byte* Decode4( const OglContext* context, const byte* in, byte* out, const uint
 	return out;
 }
 
-byte* Decode8( const OglContext* context, const byte* in, byte* out, const uint width, const uint height, const uint lineWidth )
+#ifdef SIMDTEXTURES
+byte* Decode4Ssse3( const uint* palette, const byte* in, byte* out, const uint width, const uint height, const uint lineWidth )
+{
+	// Split the 16 colors in to byte planes - each plane is then a pshufb table indexed by 16 texels at once
+	__declspec( align( 16 ) ) byte planes[ 4 ][ 16 ];
+	for( int n = 0; n < 16; n++ )
+	{
+		planes[ 0 ][ n ] = ( byte )( palette[ n ] );
+		planes[ 1 ][ n ] = ( byte )( palette[ n ] >> 8 );
+		planes[ 2 ][ n ] = ( byte )( palette[ n ] >> 16 );
+		planes[ 3 ][ n ] = ( byte )( palette[ n ] >> 24 );
+	}
+	const __m128i plane0 = _mm_load_si128( ( const __m128i* )planes[ 0 ] );
+	const __m128i plane1 = _mm_load_si128( ( const __m128i* )planes[ 1 ] );
+	const __m128i plane2 = _mm_load_si128( ( const __m128i* )planes[ 2 ] );
+	const __m128i plane3 = _mm_load_si128( ( const __m128i* )planes[ 3 ] );
+	const __m128i mask4 = _mm_set1_epi8( 0x0F );
+
+	const byte* input = in;
+	uint* output = ( uint* )out;
+	for( uint y = 0; y < height; y++ )
+	{
+		uint x = 0;
+		for( ; x + 16 <= width; x += 16 )
+		{
+			// 8 bytes = 16 texels, low nibble first
+			__m128i packed = _mm_loadl_epi64( ( const __m128i* )( input + x / 2 ) );
+			__m128i indices = _mm_unpacklo_epi8( _mm_and_si128( packed, mask4 ), _mm_and_si128( _mm_srli_epi16( packed, 4 ), mask4 ) );
+
+			__m128i p0 = _mm_shuffle_epi8( plane0, indices );
+			__m128i p1 = _mm_shuffle_epi8( plane1, indices );
+			__m128i p2 = _mm_shuffle_epi8( plane2, indices );
+			__m128i p3 = _mm_shuffle_epi8( plane3, indices );
+
+			// Interleave the planes back in to pixels
+			__m128i p01 = _mm_unpacklo_epi8( p0, p1 );
+			__m128i p23 = _mm_unpacklo_epi8( p2, p3 );
+			_mm_storeu_si128( ( __m128i* )( output + x ), _mm_unpacklo_epi16( p01, p23 ) );
+			_mm_storeu_si128( ( __m128i* )( output + x + 4 ), _mm_unpackhi_epi16( p01, p23 ) );
+			p01 = _mm_unpackhi_epi8( p0, p1 );
+			p23 = _mm_unpackhi_epi8( p2, p3 );
+			_mm_storeu_si128( ( __m128i* )( output + x + 8 ), _mm_unpacklo_epi16( p01, p23 ) );
+			_mm_storeu_si128( ( __m128i* )( output + x + 12 ), _mm_unpackhi_epi16( p01, p23 ) );
+		}
+		for( ; x < width; x++ )
+		{
+			byte index = input[ x / 2 ];
+			output[ x ] = palette[ ( x & 0x1 ) ? ( index >> 4 ) : ( index & 0x0F ) ];
+		}
+		input += lineWidth / 2;
+		output += width;
+	}
+
+	return out;
+}
+#endif
+
+byte* Decode8( const uint* palette, const byte* in, byte* out, const uint width, const uint height, const uint lineWidth )
 {
 	byte* input = ( byte* )in;
 	uint* output = ( uint* )out;
@@ -343,7 +551,7 @@ byte* Decode8( const OglContext* context, const byte* in, byte* out, const uint
 		for( uint x = 0; x < width; x++ )
 		{
 			byte index = input[ x ];
-			output[ x ] = ClutLookup( context, index );
+			output[ x ] = palette[ index ];
 		}
 		input += lineWidth;
 		output += width;
@@ -351,7 +559,7 @@ byte* Decode8( const OglContext* context, const byte* in, byte* out, const uint
 	return out;
 }
 
-byte* Decode16( const OglContext* context, const byte* in, byte* out, const uint width, const uint height, const uint lineWidth )
+byte* Decode16( const TextureClut* clut, const byte* in, byte* out, const uint width, const uint height, const uint lineWidth )
 {
 	ushort* input = ( ushort* )in;
 	uint* output = ( uint* )out;
@@ -360,7 +568,7 @@ byte* Decode16( const OglContext* context, const byte* in, byte* out, const uint
 		for( uint x = 0; x < width; x++ )
 		{
 			ushort index = input[ x ];
-			output[ x ] = ClutLookup( context, index );
+			output[ x ] = ClutLookup( clut, index );
 		}
 		input += lineWidth;
 		output += width;
@@ -368,7 +576,7 @@ byte* Decode16( const OglContext* context, const byte* in, byte* out, const uint
 	return out;
 }
 
-byte* Decode32( const OglContext* context, const byte* in, byte* out, const uint width, const uint height, const uint lineWidth )
+byte* Decode32( const TextureClut* clut, const byte* in, byte* out, const uint width, const uint height, const uint lineWidth )
 {
 	uint* input = ( uint* )in;
 	uint* output = ( uint* )out;
@@ -377,7 +585,7 @@ byte* Decode32( const OglContext* context, const byte* in, byte* out, const uint
 		for( uint x = 0; x < width; x++ )
 		{
 			uint index = input[ x ];
-			output[ x ] = ClutLookup( context, index );
+			output[ x ] = ClutLookup( clut, index );
 		}
 		input += lineWidth;
 		output += width;
@@ -385,49 +593,84 @@ byte* Decode32( const OglContext* context, const byte* in, byte* out, const uint
 	return out;
 }
 
-// TODO: Free texture buffers
-byte* _unswizzleBuffer = NULL;
-byte* _decodeBuffer = NULL;
+typedef byte* (*UnswizzleFunction)( const TextureFormat* format, const byte* in, byte* out, const uint width, const uint height );
+typedef byte* (*WidenFunction)( const byte* in, byte* out, const uint width, const uint height );
+typedef byte* (*PaletteFunction)( const uint* palette, const byte* in, byte* out, const uint width, const uint height, const uint lineWidth );
 
-extern void __break();
-bool Noxa::Emulation::Psp::Video::GenerateTexture( OglContext* context, OglTexture* texture, uint checksum )
+// Picked by SelectTextureKernels when the worker starts
+UnswizzleFunction _unswizzle = Unswizzle;
+WidenFunction _widen5650 = Widen5650;
+WidenFunction _widen5551 = Widen5551;
+WidenFunction _widen4444 = Widen4444;
+PaletteFunction _decode4 = Decode4;
+
+void Noxa::Emulation::Psp::Video::SelectTextureKernels()
 {
-	uint textureId;
-	glGenTextures( 1, &textureId );
-	glBindTexture( GL_TEXTURE_2D, textureId );
+#ifdef SIMDTEXTURES
+	uint features;
+	uint extendedFeatures;
+	__asm
+	{
+		mov eax, 1
+		cpuid
+		mov [features], edx
+		mov [extendedFeatures], ecx
+	}
 
-	TextureEntry* entry = new TextureEntry();
-	entry->Address = texture->Address;
-	entry->Width = texture->Width;
-	entry->Height = texture->Height;
-	entry->LineWidth = texture->LineWidth;
-	entry->PixelStorage = texture->PixelStorage;
-	entry->TextureID = textureId;
-	entry->Checksum = checksum;
-	entry->ClutPointer = context->ClutPointer;
-	entry->ClutChecksum = context->ClutChecksum;
-	context->TextureCache->Add( texture->Address, entry );
+	// EDX bit 26 = SSE2
+	if( ( features & 0x4000000 ) != 0 )
+	{
+		_unswizzle = UnswizzleSse2;
+		_widen5650 = Widen5650Sse2;
+		_widen5551 = Widen5551Sse2;
+		_widen4444 = Widen4444Sse2;
+	}
+	// ECX bit 9 = SSSE3 (pshufb)
+	if( ( extendedFeatures & 0x200 ) != 0 )
+		_decode4 = Decode4Ssse3;
+#endif
+}
 
-	if( _unswizzleBuffer == NULL )
-		_unswizzleBuffer = ( byte* )malloc( 1024 * 1024 * 4 );
-	if( _decodeBuffer == NULL )
-		_decodeBuffer = ( byte* )malloc( 1024 * 1024 * 4 );
+TextureJob* Noxa::Emulation::Psp::Video::CreateTextureJob( const OglContext* context, const OglTexture* texture, bool swizzled, uint key )
+{
+	TextureJob* job = ( TextureJob* )malloc( sizeof( TextureJob ) );
+	memset( job, 0, sizeof( TextureJob ) );
+	job->Texture = *texture;
+	job->Swizzled = swizzled;
+	job->Key = key;
+	job->Source = context->Memory->Translate( texture->Address );
+	job->ClutPointer = context->ClutPointer;
+	if( ( texture->PixelStorage & 0x4 ) == 0x4 )
+	{
+		job->ClutKey = GetClutKey( context );
+		ConvertClut( context, &job->Clut );
+	}
+	return job;
+}
 
-	//memset( _unswizzleBuffer, 0xCC, 1024 * 1024 * 4 );
-	//memset( _decodeBuffer, 0xCC, 1024 * 1024 * 4 );
+void Noxa::Emulation::Psp::Video::FreeTextureJob( TextureJob* job )
+{
+	SAFEFREE( job->UnswizzleBuffer );
+	SAFEFREE( job->DecodeBuffer );
+	free( job );
+}
 
-	byte* address = context->Memory->Translate( texture->Address );
+void Noxa::Emulation::Psp::Video::DecodeTexture( TextureJob* job )
+{
+	const OglTexture* texture = &job->Texture;
 	TextureFormat* format = ( TextureFormat* )&__formats[ texture->PixelStorage ];
-	int size = texture->LineWidth * texture->Height * format->Size;
-
-	int width = texture->Width;
 	int lineWidth = texture->LineWidth;
-	bool needRowLength = false;
+	uint palette[ 256 ];
+
+	job->Hash = CalculateTextureHash( job->Source, texture->LineWidth, texture->Height, texture->PixelStorage );
+	job->Format = texture->PixelStorage;
+	job->RowLength = 0;
 
-	byte* buffer = address;
-	if( context->TexturesSwizzled == true )
+	byte* buffer = job->Source;
+	if( job->Swizzled == true )
 	{
-		buffer = Unswizzle( format, buffer, _unswizzleBuffer, texture->LineWidth, texture->Height );
+		job->UnswizzleBuffer = ( byte* )malloc( TextureMemorySize( texture->LineWidth, texture->Height, texture->PixelStorage ) );
+		buffer = _unswizzle( format, buffer, job->UnswizzleBuffer, texture->LineWidth, texture->Height );
 	}
 
 	// buffer now contains an unswizzled texture - may need to un-CLUT it, or convert colors
@@ -435,39 +678,61 @@ bool Noxa::Emulation::Psp::Video::GenerateTexture( OglContext* context, OglTextu
 	switch( format->Format )
 	{
 	case TPSBGR5650:
-		buffer = Widen5650( buffer, _decodeBuffer, lineWidth, texture->Height );
-		format = ( TextureFormat* )&__formats[ 3 ];
-		//needRowLength = true;
+		// The PSP 16-bit layouts are the same as the GL *_REV packed types, so they can go up as-is
+		if( HasPackedPixels == true )
+		{
+			job->RowLength = lineWidth;
+			break;
+		}
+		job->DecodeBuffer = ( byte* )malloc( lineWidth * texture->Height * 4 );
+		buffer = _widen5650( buffer, job->DecodeBuffer, lineWidth, texture->Height );
+		job->Format = TPSABGR8888;
 		break;
 	case TPSABGR5551:
-		buffer = Widen5551( buffer, _decodeBuffer, lineWidth, texture->Height );
-		format = ( TextureFormat* )&__formats[ 3 ];
-		//needRowLength = true;
+		if( HasPackedPixels == true )
+		{
+			job->RowLength = lineWidth;
+			break;
+		}
+		job->DecodeBuffer = ( byte* )malloc( lineWidth * texture->Height * 4 );
+		buffer = _widen5551( buffer, job->DecodeBuffer, lineWidth, texture->Height );
+		job->Format = TPSABGR8888;
 		break;
 	case TPSABGR4444:
-		buffer = Widen4444( buffer, _decodeBuffer, lineWidth, texture->Height );
-		format = ( TextureFormat* )&__formats[ 3 ];
-		//needRowLength = true;
+		if( HasPackedPixels == true )
+		{
+			job->RowLength = lineWidth;
+			break;
+		}
+		job->DecodeBuffer = ( byte* )malloc( lineWidth * texture->Height * 4 );
+		buffer = _widen4444( buffer, job->DecodeBuffer, lineWidth, texture->Height );
+		job->Format = TPSABGR8888;
 		break;
 	case TPSABGR8888:
 		// Pass through
-		needRowLength = true;
+		job->RowLength = lineWidth;
 		break;
 	case TPSIndexed4:
-		buffer = Decode4( context, buffer, _decodeBuffer, texture->Width, texture->Height, texture->LineWidth );
-		format = ( TextureFormat* )&__formats[ 3 ];
+		BuildPalette( &job->Clut, palette, 16 );
+		job->DecodeBuffer = ( byte* )malloc( texture->Width * texture->Height * 4 );
+		buffer = _decode4( palette, buffer, job->DecodeBuffer, texture->Width, texture->Height, texture->LineWidth );
+		job->Format = TPSABGR8888;
 		break;
 	case TPSIndexed8:
-		buffer = Decode8( context, buffer, _decodeBuffer, texture->Width, texture->Height, texture->LineWidth );
-		format = ( TextureFormat* )&__formats[ 3 ];
+		BuildPalette( &job->Clut, palette, 256 );
+		job->DecodeBuffer = ( byte* )malloc( texture->Width * texture->Height * 4 );
+		buffer = Decode8( palette, buffer, job->DecodeBuffer, texture->Width, texture->Height, texture->LineWidth );
+		job->Format = TPSABGR8888;
 		break;
 	case TPSIndexed16:
-		buffer = Decode16( context, buffer, _decodeBuffer, texture->Width, texture->Height, texture->LineWidth );
-		format = ( TextureFormat* )&__formats[ 3 ];
+		job->DecodeBuffer = ( byte* )malloc( texture->Width * texture->Height * 4 );
+		buffer = Decode16( &job->Clut, buffer, job->DecodeBuffer, texture->Width, texture->Height, texture->LineWidth );
+		job->Format = TPSABGR8888;
 		break;
 	case TPSIndexed32:
-		buffer = Decode32( context, buffer, _decodeBuffer, texture->Width, texture->Height, texture->LineWidth );
-		format = ( TextureFormat* )&__formats[ 3 ];
+		job->DecodeBuffer = ( byte* )malloc( texture->Width * texture->Height * 4 );
+		buffer = Decode32( &job->Clut, buffer, job->DecodeBuffer, texture->Width, texture->Height, texture->LineWidth );
+		job->Format = TPSABGR8888;
 		break;
 	case TPSDXT1:
 	case TPSDXT3:
@@ -477,84 +742,154 @@ bool Noxa::Emulation::Psp::Video::GenerateTexture( OglContext* context, OglTextu
 		break;
 	}
 
+	job->Pixels = buffer;
+}
+
+extern void __break();
+bool Noxa::Emulation::Psp::Video::UploadTexture( OglContext* context, const TextureJob* job )
+{
+	const OglTexture* texture = &job->Texture;
+
+	uint textureId;
+	glGenTextures( 1, &textureId );
+	glBindTexture( GL_TEXTURE_2D, textureId );
+
+	TextureEntry* entry = new TextureEntry();
+	entry->Address = texture->Address;
+	entry->Width = texture->Width;
+	entry->Height = texture->Height;
+	entry->LineWidth = texture->LineWidth;
+	entry->PixelStorage = texture->PixelStorage;
+	entry->Swizzled = job->Swizzled;
+	entry->TextureID = textureId;
+	entry->Hash = job->Hash;
+	entry->CheckedStamp = context->TextureStamp;
+	entry->ClutPointer = job->ClutPointer;
+	entry->ClutKey = job->ClutKey;
+	context->TextureCache->Add( job->Key, entry );
+
+	TextureFormat* format = ( TextureFormat* )&__formats[ job->Format ];
+
 	glPixelStorei( GL_UNPACK_ALIGNMENT, format->Size );
-	if( needRowLength == true )
-		glPixelStorei( GL_UNPACK_ROW_LENGTH, lineWidth );
+	// Always set, as the last upload may have left a row length behind
+	glPixelStorei( GL_UNPACK_ROW_LENGTH, job->RowLength );
 
 #ifdef _DEBUG
 	static bool write = false;
 	if( write == true )
 	{
-		size = texture->Width * texture->Height * format->Size;
+		int size = texture->Width * texture->Height * format->Size;
 		HANDLE f = CreateFileA( "test.raw", GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, NULL );
 		int dummy1;
-		WriteFile( f, ( void* )buffer, size, ( LPDWORD )&dummy1, NULL );
+		WriteFile( f, ( void* )job->Pixels, size, ( LPDWORD )&dummy1, NULL );
 		CloseHandle( f );
 	}
 #endif
 
-	glTexImage2D( GL_TEXTURE_2D, 0, ( format->Flags & TFAlpha ) ? GL_RGBA8 : GL_RGB8,
-		width, texture->Height,
+	glTexImage2D( GL_TEXTURE_2D, 0, format->GLInternalFormat,
+		texture->Width, texture->Height,
 		0,
 		( format->Flags & TFAlpha ) ? GL_RGBA : GL_RGB,
 		format->GLFormat,
-		( void* )buffer );
-
-	entry->CookieOriginal = *( ( uint* )address );
-	entry->Cookie = entry->TextureID;
-	*( ( uint* )address ) = entry->Cookie;
+		( void* )job->Pixels );
 
 	return true;
 }
 
-#define CHECKSUMSPACING 4
-uint Noxa::Emulation::Psp::Video::CalculateTextureChecksum( byte* address, int width, int height, int pixelStorage )
+bool Noxa::Emulation::Psp::Video::GenerateTexture( OglContext* context, OglTexture* texture, uint key )
 {
-	//uint checksum = *( uint* )address;
-	//return checksum;
-
-	TextureFormat* format = ( TextureFormat* )&__formats[ pixelStorage ];
-	int size = format->Size;
-	if( size == 0 )
-	{
-		size = 1;
-		width /= 2;
-	}
+	TextureJob* job = CreateTextureJob( context, texture, context->TexturesSwizzled, key );
+	DecodeTexture( job );
+	bool result = UploadTexture( context, job );
+	FreeTextureJob( job );
+	return result;
+}
 
-	uint checksum = 0;
-	int stride = width * size;
+#define PRIME32_1	2654435761U
+#define PRIME32_2	2246822519U
+#define PRIME32_3	3266489917U
+#define PRIME32_4	668265263U
+#define PRIME32_5	374761393U
 
-	// Offset a bit
-	address += stride / 2;
+// SSE2 has no 32-bit multiply that keeps the low halves, so do the even and odd lanes separately
+static __inline __m128i MultiplyLow32( __m128i a, __m128i b )
+{
+	__m128i even = _mm_mul_epu32( a, b );
+	__m128i odd = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) );
+	return _mm_unpacklo_epi32(
+		_mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+		_mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+}
 
-	stride = stride * CHECKSUMSPACING;
+uint Noxa::Emulation::Psp::Video::HashMemory( const byte* address, int length, uint seed )
+{
+	const byte* p = address;
+	const byte* end = address + length;
 
-	switch( size )
+	uint hash;
+	if( length >= 16 )
 	{
-	default:
-	case 1:
-		for( int n = 0; n < ( height / CHECKSUMSPACING ); n++ )
-		{
-			checksum += *address;
-			address += stride;
-		}
-		break;
-	case 2:
-		for( int n = 0; n < ( height / CHECKSUMSPACING ); n++ )
+		// Each of the 4 accumulators takes one word of every 16 bytes, so they can all go in one register
+		__m128i acc = _mm_setr_epi32( ( int )( seed + PRIME32_1 + PRIME32_2 ), ( int )( seed + PRIME32_2 ), ( int )seed, ( int )( seed - PRIME32_1 ) );
+		const __m128i prime1 = _mm_set1_epi32( ( int )PRIME32_1 );
+		const __m128i prime2 = _mm_set1_epi32( ( int )PRIME32_2 );
+		const byte* limit = end - 16;
+		do
 		{
-			checksum += *( ( ushort* )address );
-			address += stride;
-		}
-		break;
-	case 4:
-		for( int n = 0; n < ( height / CHECKSUMSPACING ); n++ )
-		{
-			checksum += *( ( uint* )address );
-			address += stride;
-		}
-		break;
+			__m128i input = _mm_loadu_si128( ( const __m128i* )p );
+			acc = _mm_add_epi32( acc, MultiplyLow32( input, prime2 ) );
+			acc = _mm_or_si128( _mm_slli_epi32( acc, 13 ), _mm_srli_epi32( acc, 19 ) );
+			acc = MultiplyLow32( acc, prime1 );
+			p += 16;
+		} while( p <= limit );
+
+		uint v[ 4 ];
+		_mm_storeu_si128( ( __m128i* )v, acc );
+		hash = _rotl( v[ 0 ], 1 ) + _rotl( v[ 1 ], 7 ) + _rotl( v[ 2 ], 12 ) + _rotl( v[ 3 ], 18 );
 	}
-	return checksum;
+	else
+		hash = seed + PRIME32_5;
+
+	hash += ( uint )length;
+	for( ; p + 4 <= end; p += 4 )
+		hash = _rotl( hash + *( ( const uint* )p ) * PRIME32_3, 17 ) * PRIME32_4;
+	for( ; p < end; p++ )
+		hash = _rotl( hash + *p * PRIME32_5, 11 ) * PRIME32_1;
+
+	hash ^= hash >> 15;
+	hash *= PRIME32_2;
+	hash ^= hash >> 13;
+	hash *= PRIME32_3;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+uint Noxa::Emulation::Psp::Video::CalculateTextureHash( const byte* address, int lineWidth, int height, int pixelStorage )
+{
+	return HashMemory( address, TextureMemorySize( lineWidth, height, pixelStorage ), 0 );
+}
+
+uint Noxa::Emulation::Psp::Video::GetClutKey( const OglContext* context )
+{
+	uint state[ 5 ];
+	state[ 0 ] = context->ClutHash;
+	state[ 1 ] = context->ClutFormat;
+	state[ 2 ] = context->ClutShift;
+	state[ 3 ] = context->ClutMask;
+	state[ 4 ] = context->ClutStart;
+	return HashMemory( ( const byte* )state, sizeof( state ), 0 );
+}
+
+uint Noxa::Emulation::Psp::Video::GetTextureKey( const OglContext* context, const OglTexture* texture, bool swizzled )
+{
+	uint state[ 6 ];
+	state[ 0 ] = texture->Address;
+	state[ 1 ] = texture->PixelStorage | ( swizzled ? 0x100 : 0 );
+	state[ 2 ] = texture->LineWidth;
+	state[ 3 ] = texture->Width;
+	state[ 4 ] = texture->Height;
+	state[ 5 ] = ( ( texture->PixelStorage & 0x4 ) == 0x4 ) ? GetClutKey( context ) : 0;
+	return HashMemory( ( const byte* )state, sizeof( state ), 0 );
 }
 
 #pragma managed
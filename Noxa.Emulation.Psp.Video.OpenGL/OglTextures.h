@@ -19,15 +19,16 @@ namespace Noxa {
 					int				Width;
 					int				Height;
 
+					bool			Swizzled;
+
 					int				TextureID;
 
-					uint			Checksum;
-					uint			Cookie;
-					uint			CookieOriginal;
+					uint			Hash;			// Of the texture memory it was decoded from
+					uint			CheckedStamp;	// OglContext::TextureStamp when Hash was last checked against memory
 
 					// If PixelStorage & 0x4, these are valid
 					uint			ClutPointer;
-					uint			ClutChecksum;
+					uint			ClutKey;		// CLUT contents and lookup state it was decoded with
 
 				} TextureEntry;
 
@@ -47,14 +48,73 @@ namespace Noxa {
 					void		(*Copy)( const TextureFormat_t* format, void* dest, const void* source, const uint width );
 					uint		Flags;
 					uint		GLFormat;
+					uint		GLInternalFormat;
 				} TextureFormat;
 				#define TFAlpha		1
 
+				// The CLUT as an indexed texture sees it, taken from the context when the job is made
+				typedef struct TextureClut_t
+				{
+					uint			Colors[ 256 ];	// Converted to 8888 - indexed after the start/shift/mask
+					int				Shift;
+					int				Mask;
+					int				Start;
+				} TextureClut;
+
+				enum TextureJobState
+				{
+					JobQueued,
+					JobDecoding,
+					JobReady,
+					JobAbandoned,		// Flushed while decoding - the decoder frees it when done
+				};
+
+				// Everything needed to decode a texture without the context, so it can be done on another thread
+				typedef struct TextureJob_t
+				{
+					OglTexture		Texture;
+					bool			Swizzled;
+					uint			Key;
+					uint			ClutPointer;
+					uint			ClutKey;
+					TextureClut		Clut;			// Only if Texture.PixelStorage & 0x4
+					byte*			Source;
+
+					// Filled in by DecodeTexture
+					uint			Hash;
+					byte*			Pixels;			// What gets uploaded - Source or one of the buffers
+					int				Format;			// Index in to the formats table of what Pixels holds
+					int				RowLength;		// GL_UNPACK_ROW_LENGTH, or 0
+					byte*			UnswizzleBuffer;
+					byte*			DecodeBuffer;
+
+					// Owned by the decoder
+					volatile int	State;			// TextureJobState
+					uint			Sequence;
+				} TextureJob;
+
 				struct OglContext_t;
 
-				bool IsTextureValid( OglTexture* texture );
-				bool GenerateTexture( OglContext_t* context, OglTexture* texture, uint checksum );
-				uint CalculateTextureChecksum( byte* address, int width, int height, int pixelStorage );
+				bool IsTextureValid( const OglTexture* texture );
+				bool GenerateTexture( OglContext_t* context, OglTexture* texture, uint key );
+
+				// Picks the SIMD/scalar decoders for this CPU - must be called before any decoding
+				void SelectTextureKernels();
+
+				TextureJob* CreateTextureJob( const OglContext_t* context, const OglTexture* texture, bool swizzled, uint key );
+				// Hashes and decodes the source - touches nothing but the job, so any thread can run it
+				void DecodeTexture( TextureJob* job );
+				// Creates the GL texture and adds it to the cache - worker thread only
+				bool UploadTexture( OglContext_t* context, const TextureJob* job );
+				void FreeTextureJob( TextureJob* job );
+
+				// xxHash32 of length bytes at address
+				uint HashMemory( const byte* address, int length, uint seed );
+				// Hash of all of the memory the texture is decoded from
+				uint CalculateTextureHash( const byte* address, int lineWidth, int height, int pixelStorage );
+				// Texture cache key - address, format, size, swizzling and (for indexed formats) the CLUT
+				uint GetTextureKey( const OglContext_t* context, const OglTexture* texture, bool swizzled );
+				uint GetClutKey( const OglContext_t* context );
 
 				uint Convert5650(ushort source);
 				uint Convert5551(ushort source);
@@ -22,6 +22,26 @@
 // Number of textures to hold on to
 #define TEXTURECACHESIZE	1500
 
+// Number of pre-decoded display list runs to hold on to
+#define LISTCACHESIZE		512
+// Most packets decoded in to a single run
+#define LISTRUNLENGTH		4096
+// A run that has changed this many lists in a row isn't cached again until LISTCACHESKIPSTAMPS more lists have used it
+#define LISTCACHEMISSES		3
+#define LISTCACHESKIPSTAMPS	60
+
+// Unswizzle, widen and expand palettes with SSE2/SSSE3 when the CPU has them - the scalar
+// decoders are kept and used when it doesn't
+#define SIMDTEXTURES
+
+// Decode textures on this many threads ahead of the worker (capped at # of cores - 1) - undefine
+// to decode everything on the worker when it is used
+#define TEXTUREDECODETHREADS	2
+// Number of decodes that can be waiting to be used
+#define TEXTUREDECODEQUEUESIZE	16
+// How many packets ahead of the current one to look for textures to decode
+#define TEXTUREPREFETCHPACKETS	4096
+
 // ---------------------- Debug options -------------------------------------
 #ifdef _DEBUG
 
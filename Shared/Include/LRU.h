@@ -41,6 +41,8 @@ namespace Noxa {
 				void Add( uint key, T value );
 				void Remove( uint key );
 				T Find( uint key );
+				// Same as Find, but doesn't count as a use - the entry keeps its place in the list
+				T Peek( uint key );
 				LLEntry<T>* GetEnumerator();
 
 				int GetCount(){ return _count; }
@@ -131,6 +133,17 @@ namespace Noxa {
 				return entry->Value;
 			}
 
+			template<typename T>
+			T LRU<T>::Peek( uint key )
+			{
+				typename stdext::hash_map<uint, LLEntry<T>*>::iterator it = _lookup.find( key );
+				if( ( it == _lookup.end() ) ||
+					( it->second == NULL ) )
+					return NULL;
+
+				return it->second->Value;
+			}
+
 			template<typename T>
 			LLEntry<T>* LRU<T>::GetEnumerator()
 			{